@@ -0,0 +1,101 @@
+#ifndef BXALIGNMENT_H
+#define BXALIGNMENT_H
+
+// system include files
+#include <memory>
+#include <string>
+#include <vector>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/EDAnalyzer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+#include "CTP7Tests/CTP7DQM/interface/BxCentroids.h"
+#include "CTP7Tests/RegionSummary/interface/RegionSummary.h"
+
+//
+// BX alignment from multi-BC captures (nBCs 3 or 5). Every region with
+// E_T > 0 adds its E_T and its BX in the readout window to the centroid
+// of its RCT card (crate, card 0-6, HF as card 7) and of its crate; EM
+// candidates add their rank to the crate. The offset of a channel is its
+// centroid minus the central BX, with the uncertainty of BxCentroids.
+// Every checkEvery events the offset table is rewritten to offsetFile and
+// the BxAlignment* histograms are updated. Once every crate and every card
+// with minEvents events is within targetError, the table is final and,
+// with stopWhenConverged, the job ends after the current event.
+//
+
+class BxAlignment : public edm::EDAnalyzer {
+
+public:
+
+// Constructor
+  BxAlignment(const edm::ParameterSet& ps);
+
+// Destructor
+ virtual ~BxAlignment();
+
+protected:
+// Analyze
+ void analyze(const edm::Event& e, const edm::EventSetup& c);
+
+// BeginRun
+  void beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup);
+
+// EndJob
+void endJob(void);
+
+private:
+
+  static const unsigned int NCRATES = 18;
+  static const unsigned int NCARDS = 8;
+
+  /// updates the histograms and the table; true once converged
+  bool publish();
+  bool converged() const;
+
+  // ----------member data ---------------------------
+  DQMStore * dbe;
+
+  MonitorElement* etVsBx_;
+  MonitorElement* cardOffset_;
+  MonitorElement* cardError_;
+  MonitorElement* crateOffset_;
+
+  edm::EDGetTokenT<RegionSummary> regionSummary_;
+
+  int centralBx_;
+  double targetError_;
+  unsigned int minEvents_;
+  unsigned int checkEvery_;
+  std::string offsetFile_;
+  bool stopWhenConverged_;
+
+  /// readout window of the first multi-BC event, later events must match
+  int firstBx_;
+  unsigned int nBx_;
+  unsigned int central_;
+
+  BxCentroids cards_;
+  BxCentroids crates_;
+
+  unsigned int nev_;
+  unsigned int used_;
+  bool converged_;
+  bool warned_;
+
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef BXCENTROIDS_H
+#define BXCENTROIDS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//
+// Running E_T-weighted BX centroids of a set of channels. Every deposit
+// adds its E_T and its position in the readout window to four sums, so
+// the centroid and its uncertainty are available at any time in O(1):
+//
+//   centroid = sum(w x) / sum(w)
+//   error    = sqrt((var + 1/12) / nEff),  nEff = sum(w)^2 / sum(w^2)
+//
+// The 1/12 is the variance of the BX quantization, so a channel that is
+// always in one BX still gets a finite error that shrinks with the data.
+//
+
+class BxCentroids {
+
+public:
+
+  explicit BxCentroids(unsigned int channels) : sums_(channels) { }
+
+  unsigned int size() const { return sums_.size(); }
+
+  void add(unsigned int channel, unsigned int position, double et) {
+    Sums& s = sums_[channel];
+    s.w += et;
+    s.w2 += et*et;
+    s.wx += et*position;
+    s.wx2 += et*position*position;
+    if (!s.touched) touched_.push_back(channel);
+    s.touched = true;
+  }
+
+  // counts one event for every channel that had a deposit in it
+  void endEvent() {
+    for (std::vector<unsigned int>::const_iterator c = touched_.begin(); c != touched_.end(); c++) {
+      sums_[*c].events++;
+      sums_[*c].touched = false;
+    }
+    touched_.clear();
+  }
+
+  unsigned int events(unsigned int channel) const { return sums_[channel].events; }
+  double et(unsigned int channel) const { return sums_[channel].w; }
+
+  double centroid(unsigned int channel) const {
+    const Sums& s = sums_[channel];
+    return s.w > 0 ? s.wx/s.w : 0.;
+  }
+
+  double error(unsigned int channel) const {
+    const Sums& s = sums_[channel];
+    if (s.w <= 0 || s.w2 <= 0) return -1.;
+    const double mean = s.wx/s.w;
+    const double var = std::max(0., s.wx2/s.w - mean*mean);
+    return std::sqrt((var + 1./12.)*s.w2/(s.w*s.w));
+  }
+
+private:
+
+  struct Sums {
+    Sums() : w(0.), w2(0.), wx(0.), wx2(0.), events(0), touched(false) { }
+    double w, w2, wx, wx2;
+    unsigned int events;
+    bool touched;
+  };
+
+  std::vector<Sums> sums_;
+  std::vector<unsigned int> touched_;
+
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CAPTUREBUFFERCHECK_H
+#define CAPTUREBUFFERCHECK_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+//
+// DAQ buffer validation of the capture an analyzer runs on. The files of
+// the daqBuffers parameter (as given to RCTToDigi) are checked with the
+// CaptureTools buffer validator at beginRun, and RctBufferCheck counts
+// them by reason code (Ok, BadMagic, BadTrailer, ...); the merged file
+// then shows how many captures were corrupted. With rejectCorruptBuffers
+// (default true) a corrupted capture fills nothing else, so it does not
+// end up in the merged histograms.
+//
+
+class CaptureBufferCheck {
+
+public:
+
+  CaptureBufferCheck(const std::string& module, const edm::ParameterSet& ps);
+
+  // books RctBufferCheck in the current folder and validates the buffers
+  void book(DQMStore* dbe);
+
+  // true if the events of this capture must be skipped
+  bool reject() {
+    if (!rejected_) return false;
+    skipped_++;
+    return true;
+  }
+
+  void endJob();
+
+private:
+
+  std::string module_;
+  std::vector<std::string> files_;
+  bool rejectCorrupt_;
+  bool rejected_;
+  unsigned int skipped_;
+  MonitorElement* check_;
+
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CAPTURELATENCY_H
+#define CAPTURELATENCY_H
+
+#include <ctime>
+#include <string>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+#include "CTP7Tests/LiveExport/interface/MetricsRegistry.h"
+#include "CTP7Tests/TimeMonitor/interface/TimeMonitor.h"
+
+//
+// Capture-to-DQM latency of one analyzer. The capture time comes from the
+// TimeMonitor product (ddmm + hhmmss, local time, year of the job). Every
+// event fills RctCaptureLatency with the seconds since the capture; at
+// endJob the capture time and the completion time of the module are
+// appended to latencyFile as
+//
+//   capture <unix time>
+//   dqm:<module> <unix time>
+//
+// ctp7Supervisor adds the merge, plot and publish stamps to the same file
+// and summarises the whole chain. An empty latencyFile writes nothing.
+// The latency of the last event is also the ctp7_dqm_capture_latency_seconds
+// gauge of the module (ModuleMetrics).
+//
+
+class CaptureLatency {
+
+public:
+
+  CaptureLatency(const std::string& module, const edm::ParameterSet& ps);
+
+  // books RctCaptureLatency in the current folder
+  void book(DQMStore* dbe);
+
+  void fill(const TimeMonitorCollection& time);
+
+  // call after the output file is saved
+  void endJob();
+
+  // unix time of a TimeMonitor stamp; the year is the one of now, or the
+  // previous one if that would put the capture more than a day ahead
+  static time_t captureTime(const TimeMonitor& t, time_t now);
+
+private:
+
+  std::string module_;
+  std::string file_;
+  time_t capture_;
+  MonitorElement* latency_;
+  ctp7metrics::Gauge metric_;
+
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef CARDSOURCES_H
+#define CARDSOURCES_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/InputTag.h"
+
+//
+// The CTP7 cards an analyzer monitors, in place of a single ctp7Source:
+//
+//   ctp7Sources = cms.untracked.VInputTag("ctp7ToDigiA", "ctp7ToDigiB")
+//
+// Every card reads its own unpacker and its own RegionSummary instance
+// (RegionSummary::cardName, from a regionSummary producer given the same
+// list). With more than one card, each card fills its own views in the
+// subfolder <module folder>/<card>[/<trigger view>], and the module
+// folder keeps the same histograms as the sum over the cards, refreshed
+// when they are read (lumi boundaries, live export, end of job). The
+// monitors that are not split (quality tests, PUM calibration, capture
+// latency...) follow the first card. Without ctp7Sources the module reads
+// ctp7Source and fills the module folder directly, as before.
+//
+// Views are numbered card*routes + route, the sum being card size().
+//
+
+class CardSources {
+
+public:
+
+  CardSources(const std::string& module, const edm::ParameterSet& ps);
+
+  unsigned int size() const { return sources_.size(); }
+  // per-card subfolders and a summed view
+  bool multi() const { return sources_.size() > 1; }
+
+  const edm::InputTag& source(unsigned int card) const { return sources_[card]; }
+  const std::string& name(unsigned int card) const { return names_[card]; }
+
+  // RegionSummary of the card, the per-card instance of the producer
+  edm::InputTag summary(const edm::InputTag& regionSummary, unsigned int card) const;
+
+  // cards plus the sum, the number of view sets to book
+  unsigned int views() const { return multi() ? size() + 1 : 1; }
+  unsigned int sum() const { return size(); }
+
+  // folder of the card (or sum) for the view folder of the module, base/card/view
+  std::string folder(const std::string& base, const std::string& view, unsigned int card) const;
+
+private:
+
+  bool listed_;
+  std::vector<edm::InputTag> sources_;
+  std::vector<std::string> names_;
+
+};
+
+#endif
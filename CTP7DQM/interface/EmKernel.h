@@ -0,0 +1,92 @@
+#ifndef EMKERNEL_H
+#define EMKERNEL_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+#include "CTP7Tests/RegionSummary/interface/RegionSummary.h"
+
+//
+// One pass over the EM candidates of the RegionSummary of an event, shared
+// by L1TCTP7 and RCTL1A:
+//  - every candidate with rank > 0 goes into a flat list, with separate
+//    iso and non-iso index lists
+//  - the rank is summed per (ieta, iphi) cell by direct indexing, and the
+//    touched cells are listed, so the E_T maps take one fill per cell
+//  - each crate keeps its topN highest ranks, by insertion into a
+//    fixed-size descending list (no sort)
+// The per-crate view is published as RctEmCrateLeadRank (highest rank per
+// crate and event) and RctEmCrateTopRank (all topN ranks).
+//
+
+class EmKernel {
+
+public:
+
+  static const unsigned int NETA = 22;
+  static const unsigned int NPHI = 18;
+  static const unsigned int NCELLS = NETA*NPHI;
+  static const unsigned int NCRATES = 18;
+  // 4 iso + 4 non-iso candidates per crate
+  static const unsigned int MAXTOPN = 8;
+
+  struct Candidate {
+    uint16_t rank;
+    int16_t bx;
+    uint8_t ieta;
+    uint8_t iphi;
+    uint8_t crate;
+    bool iso;
+    unsigned int cell() const { return ieta*NPHI + iphi; }
+  };
+
+  explicit EmKernel(unsigned int topN);
+
+  void process(const RegionSummary& summary);
+
+  // candidates with rank > 0, and the indices of the iso and non-iso ones
+  const std::vector<Candidate>& candidates() const { return candidates_; }
+  const std::vector<uint16_t>& isolated() const { return iso_; }
+  const std::vector<uint16_t>& nonIsolated() const { return nonIso_; }
+
+  // summed rank of the event per cell, non-zero only for touched(iso)
+  const std::vector<uint16_t>& touched(bool iso) const { return touched_[iso]; }
+  unsigned int cellEt(bool iso, unsigned int cell) const { return cellEt_[iso][cell]; }
+
+
+  // topN ranks of the crate in this event, descending, zero padded
+  const uint16_t* top(unsigned int crate) const { return &top_[crate*MAXTOPN]; }
+  unsigned int topN() const { return topN_; }
+
+  // books RctEmCrateLeadRank and RctEmCrateTopRank in the current folder
+  void book(DQMStore* dbe);
+  void fillSummary();
+
+private:
+
+  void insertTop(unsigned int crate, uint16_t rank);
+
+  unsigned int topN_;
+
+  std::vector<Candidate> candidates_;
+  std::vector<uint16_t> iso_;
+  std::vector<uint16_t> nonIso_;
+
+  // [iso][cell]
+  std::vector<uint16_t> cellEt_[2];
+  std::vector<uint16_t> touched_[2];
+
+  // [crate*MAXTOPN + i]
+  std::vector<uint16_t> top_;
+
+  MonitorElement* leadRank_;
+  MonitorElement* topRank_;
+
+};
+
+#endif
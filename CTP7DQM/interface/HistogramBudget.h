@@ -0,0 +1,58 @@
+#ifndef HISTOGRAMBUDGET_H
+#define HISTOGRAMBUDGET_H
+
+#include <string>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+//
+// Memory accounting of the histograms booked by one analyzer. After
+// booking, every MonitorElement of the module folder is reported with its
+// bin count and byte footprint (bin contents plus sum of weights squared),
+// followed by the module total. The memoryBudget PSet of the analyzer sets
+// a limit in MB and what to do when the module goes over it:
+//  - report:  log a warning only
+//  - coarsen: rebin the largest histogram by 2 on each even axis with at
+//             least minBins bins, and repeat until the module fits or
+//             nothing can be merged
+//  - refuse:  stop the job with a cms::Exception before any event is read
+// Every rebinning is logged with the old and new bin counts.
+//
+
+class HistogramBudget {
+
+public:
+
+  HistogramBudget(const std::string& module, const edm::ParameterSet& ps);
+
+  // account for (and enforce the budget on) everything booked in folder
+  // and its subfolders; returns the total footprint in bytes
+  size_t audit(DQMStore* dbe, const std::string& folder);
+
+  size_t bytes() const { return bytes_; }
+
+  // true if a limit is set
+  bool limited() const { return maxBytes_ != 0; }
+
+  // bin count and footprint in bytes of one booked histogram
+  static size_t cells(const TH1* h);
+  static size_t footprint(const TH1* h);
+
+private:
+
+  enum Action { Report, Coarsen, Refuse };
+
+  std::string module_;
+  size_t maxBytes_;
+  Action action_;
+  bool reportElements_;
+  unsigned int minBins_;
+  size_t bytes_;
+
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "FWCore/Framework/interface/EDAnalyzer.h"
 
 #include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
@@ -27,9 +28,26 @@
 #include "DQMServices/Core/interface/DQMStore.h"
 #include "DQMServices/Core/interface/MonitorElement.h"
 
+// live export
+#include "CTP7Tests/LiveExport/interface/ShmHistogramWriter.h"
+#include "CTP7Tests/EventColumns/interface/ColumnFile.h"
+
+#include "CTP7Tests/CTP7DQM/interface/CardSources.h"
+#include "CTP7Tests/CTP7DQM/interface/EmKernel.h"
+#include "CTP7Tests/CTP7DQM/interface/HistogramBudget.h"
+#include "CTP7Tests/CTP7DQM/interface/MapHistoryRecorder.h"
+#include "CTP7Tests/CTP7DQM/interface/OnlineQualityTests.h"
+#include "CTP7Tests/CTP7DQM/interface/ModuleMetrics.h"
+#include "CTP7Tests/CTP7DQM/interface/OutputCoordinator.h"
+#include "CTP7Tests/CTP7DQM/interface/PumCalibration.h"
+#include "CTP7Tests/CTP7DQM/interface/RegionAnomalyDetector.h"
+#include "CTP7Tests/CTP7DQM/interface/TriggerRouting.h"
+
 
 // GCT and RCT data formats
 #include "DataFormats/L1CaloTrigger/interface/L1CaloCollections.h"
+#include "CTP7Tests/RegionSummary/interface/RegionSummary.h"
+#include "CTP7Tests/TimeMonitor/interface/TimeMonitor.h"
 
 //
 // class declaration
@@ -52,12 +70,47 @@ protected:
 // BeginRun
   void beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup);
 
+// EndLuminosityBlock, evaluates the quality tests
+  void endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const& iSetup);
+
 // BeginJob
  void beginJob(void);
 
 // EndJob
 void endJob(void);
 
+// run, event, time and link columns of the event summary row
+  void fillEventSummaryHeader(const edm::Event& e, const RegionSummary* summary);
+
+// fills the current view from one card; false if it has no EM candidates
+  bool fillCard(const RegionSummary* summary, bool shared, bool first);
+
+private:
+  // histogram groups, selected with histogramProfile and booked on first use
+  enum HistogramGroup { RegionMaps = 1, RegionBits = 2, RegionTotals = 4, RegionVsEvt = 8,
+                        Pum = 16, EmMaps = 32, EmVsEvt = 64, AllGroups = 127 };
+
+  static unsigned int profileGroups(const std::string& profile);
+  // books the group only; the memory audit and the shared-memory
+  // registration run once, in beginRun
+  void bookGroup(HistogramGroup group);
+  void registerShm(DQMStore* dbe);
+
+  // makes the histograms of a view (card and trigger type) the current ones
+  void selectView(unsigned int view);
+  unsigned int view(unsigned int card, unsigned int route) const { return card*routing_.size() + route; }
+  std::string viewFolder(unsigned int view) const;
+
+  // refreshes the module folder views with the sum over the cards
+  void sumCards();
+
+  // true if the group is selected, booking it the first time it is asked for
+  bool use(HistogramGroup group) {
+    if (!(groups_ & group)) return false;
+    if (!(booked_ & group)) bookGroup(group);
+    return true;
+  }
+
 private:
   // ----------member data ---------------------------
   DQMStore * dbe;
@@ -104,29 +157,6 @@ private:
   MonitorElement* ctp7RegionsEtMapVsEvt_;
   MonitorElement* ctp7RegionsOccVsEvt_;
 
-  MonitorElement* ctp7RegionsPumEta0_;
-  MonitorElement* ctp7RegionsPumEta1_;
-  MonitorElement* ctp7RegionsPumEta2_;
-  MonitorElement* ctp7RegionsPumEta3_;
-  MonitorElement* ctp7RegionsPumEta4_;
-  MonitorElement* ctp7RegionsPumEta5_;
-  MonitorElement* ctp7RegionsPumEta6_;
-  MonitorElement* ctp7RegionsPumEta7_;
-  MonitorElement* ctp7RegionsPumEta8_;
-  MonitorElement* ctp7RegionsPumEta9_;
-  MonitorElement* ctp7RegionsPumEta10_;
-  MonitorElement* ctp7RegionsPumEta11_;
-  MonitorElement* ctp7RegionsPumEta12_;
-  MonitorElement* ctp7RegionsPumEta13_;
-  MonitorElement* ctp7RegionsPumEta14_;
-  MonitorElement* ctp7RegionsPumEta15_;
-  MonitorElement* ctp7RegionsPumEta16_;
-  MonitorElement* ctp7RegionsPumEta17_;
-  MonitorElement* ctp7RegionsPumEta18_;
-  MonitorElement* ctp7RegionsPumEta19_;
-  MonitorElement* ctp7RegionsPumEta20_;
-  MonitorElement* ctp7RegionsPumEta21_;
-
 
   MonitorElement* ctp7OverFlowEtaPhi_;
   MonitorElement* ctp7TauVetoEtaPhi_;
@@ -156,13 +186,66 @@ private:
   bool verbose_;
   bool monitorDaemon_;
   std::ofstream logFile_;
+
+  // selected and already booked HistogramGroup bits
+  unsigned int groups_;
+  unsigned int booked_;
+
+  // shared-memory mirror of the booked histograms, off if shmSegment is empty
+  std::string shmSegment_;
+  unsigned int shmUpdateEvery_;
+  std::unique_ptr<ShmHistogramWriter> shm_;
+
+  // one row per event in the eventSummaryFile column file, off if empty
+  enum SummaryColumn { colRun, colLumi, colEvent, colDate, colTime, colTriggerType,
+                       colNonZero, colNonZeroBarrel, colNonZeroHF,
+                       colTotalEt, colMaxEt, colMaxEtBarrel, colMaxEtHF,
+                       colEmNonZero, colEmTotalEt, colEmMaxEt,
+                       colLinkMask, colBadLinks, NSUMMARYCOLUMNS };
+  std::string eventSummaryFile_;
+  std::unique_ptr<ColumnFileWriter> eventSummary_;
   
-  edm::EDGetTokenT<L1CaloRegionCollection> ctp7Source_L1CRCollection_;
-  edm::EDGetTokenT<L1CaloEmCollection> ctp7Source_L1CEMCollection_;
+  /// the CTP7 cards, ctp7Sources (or ctp7Source)
+  CardSources cards_;
+
+  // regions, EM and links decoded once by RegionSummaryProducer, per card
+  std::vector<edm::EDGetTokenT<RegionSummary> > regionSummaries_;
+  edm::EDGetTokenT<TimeMonitorCollection> ctp7Source_TCollection_;
   
   /// filter TriggerType
   int filterTriggerType_;
 
+  /// one histogram view per trigger type, triggerRouting PSet
+  TriggerRouting routing_;
+  static const HistogramViews<L1TCTP7>::Member VIEWHISTOGRAMS[];
+  HistogramViews<L1TCTP7> views_;
+  std::vector<unsigned int> viewBooked_;
+
+  /// lumi-boundary quality tests on the region and iso EM maps
+  OnlineQualityTests regionQuality_;
+  OnlineQualityTests isoEmQuality_;
+
+  /// region rank vs PUM bin and eta, replaces the RctRegionsPumEta* histograms
+  PumCalibration pum_;
+
+  /// hot/dead/stuck regions against their eta ring
+  RegionAnomalyDetector anomalies_;
+
+  /// bin and byte accounting of the booked histograms, memoryBudget PSet
+  HistogramBudget budget_;
+
+  /// one pass over the EM candidates, per-crate top-N ranks
+  EmKernel emKernel_;
+
+  /// per-lumi history of the eta-phi maps, mapHistory PSet
+  MapHistoryRecorder mapHistory_;
+
+  /// outputFile, written once with the other modules of the same file
+  OutputCoordinator output_;
+
+  /// event, rejection and timing counters, metrics PSet
+  ModuleMetrics metrics_;
+
 };
 
 #endif
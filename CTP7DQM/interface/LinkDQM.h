@@ -16,6 +16,7 @@
 #include "FWCore/Framework/interface/EDAnalyzer.h"
 
 #include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
@@ -27,6 +28,16 @@
 #include "DQMServices/Core/interface/DQMStore.h"
 #include "DQMServices/Core/interface/MonitorElement.h"
 
+// live export
+#include "CTP7Tests/LiveExport/interface/ShmHistogramWriter.h"
+
+#include "CTP7Tests/CTP7DQM/interface/CaptureLatency.h"
+#include "CTP7Tests/CTP7DQM/interface/CardSources.h"
+#include "CTP7Tests/CTP7DQM/interface/HistogramBudget.h"
+#include "CTP7Tests/CTP7DQM/interface/ModuleMetrics.h"
+#include "CTP7Tests/CTP7DQM/interface/OutputCoordinator.h"
+#include "CTP7Tests/CTP7DQM/interface/TriggerRouting.h"
+
 //Include LinkDQM class
 #include "CTP7Tests/LinkMonitor/interface/LinkMonitor.h"
 #include "CTP7Tests/TimeMonitor/interface/TimeMonitor.h"
@@ -54,6 +65,9 @@ protected:
 // BeginJob
  void beginJob(void);
 
+// EndLuminosityBlock, snapshots of the output file
+  void endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const& iSetup);
+
 // EndJob
 void endJob(void);
 
@@ -68,15 +82,53 @@ private:
   MonitorElement* ctp7LinkMonitorNot15_2D_;
   MonitorElement* ctp7LinkMonitorVsTime_;
 
+  // read by the capture index (CaptureTools): the capture, event and bad
+  // link event counts, which hadd adds, and the run and CTP7 date/time of
+  // the first event as scalars, which hadd does not add
+  MonitorElement* ctp7CaptureInfo_;
+  MonitorElement* ctp7CaptureRun_;
+  MonitorElement* ctp7CaptureDate_;
+  MonitorElement* ctp7CaptureTime_;
+
   int nev_; // Number of events processed
   std::string outputFile_; //file name for ROOT ouput
   bool verbose_;
   bool monitorDaemon_;
   std::ofstream logFile_;
+
+  // shared-memory mirror of the booked histograms, off if shmSegment is empty
+  std::string shmSegment_;
+  unsigned int shmUpdateEvery_;
+  std::unique_ptr<ShmHistogramWriter> shm_;
   
-  edm::EDGetTokenT<LinkMonitorCollection> ctp7Source_LMCollection_;
+  /// the CTP7 cards, ctp7Sources (or ctp7Source)
+  CardSources cards_;
+
+  // links per card, capture time of the first card
+  std::vector<edm::EDGetTokenT<LinkMonitorCollection> > ctp7Source_LMCollection_;
   edm::EDGetTokenT<TimeMonitorCollection> ctp7Source_TCollection_;
 
+  /// one set of link histograms per card, the sum in L1T/LinkDQM
+  static const HistogramViews<LinkDQM>::Member VIEWHISTOGRAMS[];
+  HistogramViews<LinkDQM> views_;
+
+  /// refreshes L1T/LinkDQM with the sum over the cards
+  void sumCards();
+
+  /// bin and byte accounting of the booked histograms, memoryBudget PSet
+  HistogramBudget budget_;
+
+  /// seconds from the capture to the DQM fill, latencyFile stamps
+  CaptureLatency latency_;
+
+  /// outputFile, written once with the other modules of the same file
+  OutputCoordinator output_;
+
+  /// event, rejection and timing counters, metrics PSet
+  ModuleMetrics metrics_;
+  std::vector<ctp7metrics::Counter> badLinkEventsMetric_;
+  std::vector<ctp7metrics::Gauge> badLinksMetric_;
+
 };
 
 #endif
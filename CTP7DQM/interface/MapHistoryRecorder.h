@@ -0,0 +1,58 @@
+#ifndef MAPHISTORYRECORDER_H
+#define MAPHISTORYRECORDER_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+#include "CTP7Tests/CTP7DQM/interface/TriggerRouting.h"
+#include "CTP7Tests/MapHistory/interface/MapHistory.h"
+
+//
+// Per-lumi history of the 22x18 eta-phi maps of one analyzer. At every
+// lumi boundary the cumulative contents of each map are added to a
+// MapHistory, which keeps only the change since the previous lumi, and
+// the file is written at endJob. ctp7MapHistory rebuilds any lumi window
+// or steps through the lumis. The mapHistory PSet of the analyzer sets
+//  - file:  output file, nothing is recorded when empty
+//  - maps:  histogram names relative to the module folder; by default the
+//           region and EM E_T/occupancy maps of the shared routing view
+//  - scale: contents are multiplied by it before rounding (default 1)
+// A map that is not booked or does not have 22x18 bins (coarsened by the
+// memoryBudget) is skipped with one warning.
+//
+
+class MapHistoryRecorder {
+
+public:
+
+  MapHistoryRecorder(const std::string& module, const TriggerRouting& routing, const edm::ParameterSet& ps);
+
+  bool enabled() const { return !file_.empty(); }
+
+  void endLumi(DQMStore* dbe, unsigned int lumi);
+
+  // writes the file
+  void endJob();
+
+private:
+
+  static const unsigned int NETA = 22;
+  static const unsigned int NPHI = 18;
+
+  std::string module_;
+  std::string base_;
+  std::string file_;
+  MapHistory history_;
+  std::vector<std::string> maps_;
+  std::vector<bool> warned_;
+  std::vector<double> contents_;
+
+};
+
+#endif
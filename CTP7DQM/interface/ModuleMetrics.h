@@ -0,0 +1,72 @@
+#ifndef MODULEMETRICS_H
+#define MODULEMETRICS_H
+
+#include <chrono>
+#include <string>
+#include <stdint.h>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "CTP7Tests/LiveExport/interface/MetricsRegistry.h"
+
+//
+// Counters of an analyzer for the monitoring dashboards, kept in the
+// LiveExport MetricsRegistry with the label module="<module>":
+//
+//   ctp7_dqm_events_total                   events seen by analyze
+//   ctp7_dqm_rejected_events_total{reason}  trigger (not monitored type),
+//                                           buffer (corrupted capture)
+//   ctp7_dqm_analyze_nanoseconds_total      time spent in analyze
+//
+// plus those a module registers with counter()/gauge(). The metrics PSet
+// starts the exporter of the job (the first module's settings are used):
+//
+//   metrics = cms.untracked.PSet(
+//       socket = cms.untracked.string('/tmp/ctp7_metrics.sock'),
+//       file = cms.untracked.string(''),   # node_exporter textfile
+//       period = cms.untracked.double(10.) # seconds between file writes
+//   )
+//
+// The counters are always kept; without socket and file nobody reads them.
+//
+
+class ModuleMetrics {
+
+public:
+
+  ModuleMetrics(const std::string& module, const edm::ParameterSet& ps);
+
+  void event() { events_.inc(); }
+  void rejectedTrigger() { rejectedTrigger_.inc(); }
+  void rejectedBuffer() { rejectedBuffer_.inc(); }
+
+  // more metrics of the module, with one more label
+  ctp7metrics::Counter counter(const std::string& name, const std::string& help,
+                               const std::string& label = "", const std::string& value = "") const;
+  ctp7metrics::Gauge gauge(const std::string& name, const std::string& help,
+                           const std::string& label = "", const std::string& value = "") const;
+
+  // adds the time until the end of the scope to the analyze time
+  class Timer {
+  public:
+    explicit Timer(ModuleMetrics& m) : m_(m), start_(std::chrono::steady_clock::now()) { }
+    ~Timer() {
+      m_.analyze_.inc(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start_).count());
+    }
+  private:
+    ModuleMetrics& m_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+private:
+
+  std::string module_;
+  ctp7metrics::Counter events_;
+  ctp7metrics::Counter rejectedTrigger_;
+  ctp7metrics::Counter rejectedBuffer_;
+  ctp7metrics::Counter analyze_;
+
+};
+
+#endif
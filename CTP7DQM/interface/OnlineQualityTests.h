@@ -0,0 +1,104 @@
+#ifndef ONLINEQUALITYTESTS_H
+#define ONLINEQUALITYTESTS_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+//
+// Quality tests on one 22x18 (gctEta x gctPhi) map, evaluated at every
+// lumi boundary from running per-cell sums:
+//  - chi2/ndf of the lumi E_T map against a reference shape
+//  - dead cells (occupancy fraction <= deadOccupancy)
+//  - hot cells (occupancy > hotFactor x mean of the eta ring)
+// Thresholds come from a PSet of the analyzer (qualityTests for the
+// regions, emQualityTests for the EM candidates). Only the eta rings
+// [firstEta, lastEta] are tested: the EM candidates never reach the HF
+// rings 0-3 and 18-21, which would otherwise all count as dead. Filling
+// is one indexed add per cell, evaluation is a fixed loop over 396 cells.
+// The booked elements only hold counts and sums, so that hadd of the
+// capture files adds them; fastplotter.C turns them into fractions.
+//
+
+class OnlineQualityTests {
+
+public:
+
+  // moduleFolder (the analyzer's L1T/<module>) is where the reference
+  // file holds referenceHisto, unless referenceFolder is set
+  OnlineQualityTests(const std::string& name, const std::string& referenceHisto,
+                     const std::string& moduleFolder, const edm::ParameterSet& ps,
+                     unsigned int firstEta = 0, unsigned int lastEta = NETA - 1);
+
+  bool enabled() const { return enabled_; }
+
+  // books in the current folder
+  //   <name>QualitySummary  evaluated, good and bad lumis, chi2 and ndf
+  //                         sums, dead and hot cell sums
+  //   <name>QualityVsLumi   lumi x verdict (0 bad, 1 good) counts
+  //   <name>DeadEtaPhi      lumis in which each cell was dead
+  //   <name>HotEtaPhi       lumis in which each cell was hot
+  void book(DQMStore* dbe);
+
+  void countEvent() { lumiEvents_++; }
+  void fill(unsigned int ieta, unsigned int iphi, unsigned int et) {
+    const unsigned int c = ieta*NPHI + iphi;
+    if (c >= NCELLS) return;
+    lumiEt_[c] += et;
+    if (et > 0) lumiOcc_[c]++;
+  }
+
+  // evaluate the tests on the lumi section that just ended and reset
+  void endLumi(unsigned int lumi);
+
+  enum Verdict { Bad = 0, Good = 1 };
+
+  static const unsigned int NETA = 22;
+  static const unsigned int NPHI = 18;
+
+  // the rings of the barrel and endcaps, without HF
+  static const unsigned int FIRST_EM_ETA = 4;
+  static const unsigned int LAST_EM_ETA = 17;
+
+private:
+
+  static const unsigned int NCELLS = NETA*NPHI;
+
+  void loadReference(const std::string& file, const std::string& folder);
+  void reset();
+
+  std::string name_;
+  std::string referenceHisto_;
+  bool enabled_;
+  unsigned int firstEta_;
+  unsigned int lastEta_;
+
+  unsigned int minEvents_;
+  double maxChi2PerNdf_;
+  double deadOccupancy_;
+  double hotFactor_;
+  unsigned int maxDead_;
+  unsigned int maxHot_;
+
+  // per-lumi accumulators, [ieta*NPHI + iphi]
+  std::vector<double> lumiEt_;
+  std::vector<unsigned int> lumiOcc_;
+  unsigned int lumiEvents_;
+
+  // unit-normalised reference E_T map and its integral, empty if none
+  std::vector<double> reference_;
+  double referenceIntegral_;
+
+  MonitorElement* summary_;
+  MonitorElement* verdictVsLumi_;
+  MonitorElement* deadEtaPhi_;
+  MonitorElement* hotEtaPhi_;
+
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef OUTPUTCOORDINATOR_H
+#define OUTPUTCOORDINATOR_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+
+//
+// ROOT output of an analyzer, in place of dbe->save(outputFile). The
+// modules of a job that name the same outputFile share one file: each
+// registers its folder (and the outputFolders of its PSet), and the file
+// holds those folders only, written once when the last of them reaches
+// endJob instead of once per module. The histograms are copied on the
+// framework thread and compressed and written by a single background
+// writer, to outputFile.tmp and then renamed, so a reader never sees a
+// partial file. Parameters of the analyzer:
+//  - outputCompression:  ROOT compression level (default 1, as DQMStore)
+//  - snapshotEveryLumis: also write the file every N lumis, once all its
+//                        modules have ended the lumi (default 0, only at
+//                        endJob); the event loop does not wait for these
+//  - outputFolders:      more DQMStore folders to write, e.g. the folder
+//                        of a module that has no outputFile
+// The first module of a file sets its compression and snapshots. The
+// end-of-job write is logged as "<modules> saved <file> in <s> s".
+//
+
+class OutputCoordinator {
+
+public:
+
+  OutputCoordinator(const std::string& module, const edm::ParameterSet& ps);
+  ~OutputCoordinator();
+
+  // registers folder for file; nothing is written if never called
+  void open(const std::string& file, const std::string& folder);
+  bool enabled() const { return !file_.empty(); }
+
+  const std::string& module() const { return module_; }
+  const std::string& file() const { return file_; }
+
+  void endLumi(DQMStore* dbe, unsigned int lumi);
+
+  // the last module of the file writes it and waits for the writer
+  void endJob(DQMStore* dbe);
+
+private:
+
+  std::string module_;
+  std::string file_;
+  std::vector<std::string> folders_;
+  int compression_;
+  unsigned int snapshotEvery_;
+
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PUMCALIBRATION_H
+#define PUMCALIBRATION_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+//
+// Pile-up (PUM) calibration table: entries, sum and sum of squares of
+// the region E_T for every gctEta and PUM bin, PUM bin being the
+// number of non-zero regions / 22. Replaces the 22 RctRegionsPumEta*
+// histograms of 22 x 1024 bins; those can still be booked with a coarse
+// rank axis (pumCoarseHistograms) for pumplotter.C.
+//
+// The table is published as RctRegionsPumLutEntries, RctRegionsPumLutSum
+// and RctRegionsPumLutSum2, which hadd adds; pumplotter.C takes the mean
+// and rms from them. The mean/rms LUT is written as text/binary to
+// pumLutFile(.txt/.bin) at the end of the job.
+//
+
+class PumCalibration {
+
+public:
+
+  static const unsigned int NETA = 22;
+  static const unsigned int NPUM = 22;
+
+  explicit PumCalibration(const edm::ParameterSet& ps);
+
+  // books in the current folder
+  void book(DQMStore* dbe);
+
+  static unsigned int pumBin(double nonZeroRegions);
+
+  void fill(unsigned int pum, unsigned int ieta, double et) {
+    if (pum >= NPUM || ieta >= NETA) return;
+    Cell& c = table_[pum*NETA + ieta];
+    c.n++;
+    c.sum += et;
+    c.sum2 += et*et;
+    if (coarse_[ieta]) coarse_[ieta]->Fill(pum, et);
+  }
+
+  // copy the table into the MonitorElements
+  void publish();
+
+  // pumLutFile.txt and pumLutFile.bin, if pumLutFile is set
+  void writeLut() const;
+
+  // the MEs publish() writes with setBinContent, whose entry count stays 0
+  bool writesContents(const MonitorElement* me) const {
+    return me && (me == lutEntries_ || me == lutSum_ || me == lutSum2_);
+  }
+
+  double mean(unsigned int pum, unsigned int ieta) const {
+    const Cell& c = table_[pum*NETA + ieta];
+    return c.n > 0 ? c.sum/c.n : 0.;
+  }
+  double rms(unsigned int pum, unsigned int ieta) const;
+  uint64_t entries(unsigned int pum, unsigned int ieta) const { return table_[pum*NETA + ieta].n; }
+
+private:
+
+  // ranks are below 1024, so the sums stay exact in a double
+  struct Cell {
+    uint64_t n;
+    double sum;
+    double sum2;
+    Cell() : n(0), sum(0.), sum2(0.) { }
+  };
+
+  bool writeText(const std::string& file) const;
+  bool writeBinary(const std::string& file) const;
+
+  std::vector<Cell> table_;   // [pum*NETA + ieta]
+
+  bool coarseHistograms_;
+  unsigned int coarseRankBins_;
+  std::string lutFile_;
+
+  std::vector<MonitorElement*> coarse_;
+  MonitorElement* lutEntries_;
+  MonitorElement* lutSum_;
+  MonitorElement* lutSum2_;
+
+};
+
+#endif
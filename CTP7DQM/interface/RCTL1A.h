@@ -16,6 +16,7 @@
 #include "FWCore/Framework/interface/EDAnalyzer.h"
 
 #include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
@@ -27,9 +28,24 @@
 #include "DQMServices/Core/interface/DQMStore.h"
 #include "DQMServices/Core/interface/MonitorElement.h"
 
+// live export
+#include "CTP7Tests/LiveExport/interface/ShmHistogramWriter.h"
+
+#include "CTP7Tests/CTP7DQM/interface/CaptureBufferCheck.h"
+#include "CTP7Tests/CTP7DQM/interface/CaptureLatency.h"
+#include "CTP7Tests/CTP7DQM/interface/CardSources.h"
+#include "CTP7Tests/CTP7DQM/interface/EmKernel.h"
+#include "CTP7Tests/CTP7DQM/interface/HistogramBudget.h"
+#include "CTP7Tests/CTP7DQM/interface/MapHistoryRecorder.h"
+#include "CTP7Tests/CTP7DQM/interface/OnlineQualityTests.h"
+#include "CTP7Tests/CTP7DQM/interface/ModuleMetrics.h"
+#include "CTP7Tests/CTP7DQM/interface/OutputCoordinator.h"
+#include "CTP7Tests/CTP7DQM/interface/TriggerRouting.h"
+
 
 // GCT and RCT data formats
 #include "DataFormats/L1CaloTrigger/interface/L1CaloCollections.h"
+#include "CTP7Tests/RegionSummary/interface/RegionSummary.h"
 
 //
 // class declaration
@@ -52,6 +68,9 @@ protected:
 // BeginRun
   void beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup);
 
+// EndLuminosityBlock, evaluates the quality tests
+  void endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const& iSetup);
+
 // BeginJob
  void beginJob(void);
 
@@ -84,6 +103,18 @@ private:
   MonitorElement *ctp7RegionBx_;
   MonitorElement *ctp7EmBx_;
 
+  // BX-resolved copies of the maps: all BXs live in one element,
+  // x = bxIndex*ETABINS + eta (resp. y = bx for the rank plots)
+  MonitorElement* ctp7RegionsEtEtaPhiBx_;
+  MonitorElement* ctp7RegionsOccEtaPhiBx_;
+  MonitorElement* ctp7IsoEmEtEtaPhiBx_;
+  MonitorElement* ctp7NonIsoEmEtEtaPhiBx_;
+  MonitorElement* ctp7RegionRankBx_;
+  MonitorElement* ctp7EmRankBx_;
+  // total E_T per BX, plotted relative to the central BX
+  MonitorElement* ctp7RegionBxEt_;
+  MonitorElement* ctp7EmBxEt_;
+
   // em
   // HW coordinates
   //MonitorElement *ctp7EmCardRegion_;
@@ -94,13 +125,72 @@ private:
   bool verbose_;
   bool monitorDaemon_;
   std::ofstream logFile_;
+
+  // shared-memory mirror of the booked histograms, off if shmSegment is empty
+  std::string shmSegment_;
+  unsigned int shmUpdateEvery_;
+  std::unique_ptr<ShmHistogramWriter> shm_;
   
-  edm::EDGetTokenT<L1CaloRegionCollection> ctp7Source_L1CRCollection_;
-  edm::EDGetTokenT<L1CaloEmCollection> ctp7Source_L1CEMCollection_;
+  /// the CTP7 cards, ctp7Sources (or ctp7Source)
+  CardSources cards_;
+
+  // regions and EM decoded once by RegionSummaryProducer, per card
+  std::vector<edm::EDGetTokenT<RegionSummary> > regionSummaries_;
+  edm::EDGetTokenT<TimeMonitorCollection> ctp7Source_TCollection_;
   
   /// filter TriggerType
   int filterTriggerType_;
 
+  /// BX window of the capture (nBCs) and the BX holding the L1A
+  int nBx_;
+  int centralBx_;
+
+  /// one histogram view per trigger type, triggerRouting PSet
+  TriggerRouting routing_;
+  static const HistogramViews<RCTL1A>::Member VIEWHISTOGRAMS[];
+  HistogramViews<RCTL1A> views_;
+
+  /// books the histograms of the current view in folder
+  void bookView(DQMStore* dbe, const std::string& folder);
+
+  /// view of a card and trigger type
+  unsigned int view(unsigned int card, unsigned int route) const { return card*routing_.size() + route; }
+  void selectView(unsigned int view);
+
+  /// fills the current view from one card
+  void fillCard(const RegionSummary* summary, bool shared);
+
+  /// refreshes the module folder views with the sum over the cards
+  void sumCards();
+
+  /// index in the BX window, -1 if outside
+  int bxIndex(int bx) const;
+
+  /// lumi-boundary quality tests on the region and iso EM maps
+  OnlineQualityTests regionQuality_;
+  OnlineQualityTests isoEmQuality_;
+
+  /// bin and byte accounting of the booked histograms, memoryBudget PSet
+  HistogramBudget budget_;
+
+  /// seconds from the capture to the DQM fill, latencyFile stamps
+  CaptureLatency latency_;
+
+  /// validation of the capture's DAQ buffers, daqBuffers
+  CaptureBufferCheck bufferCheck_;
+
+  /// one pass over the EM candidates, per-crate top-N ranks
+  EmKernel emKernel_;
+
+  /// per-lumi history of the eta-phi maps, mapHistory PSet
+  MapHistoryRecorder mapHistory_;
+
+  /// outputFile, written once with the other modules of the same file
+  OutputCoordinator output_;
+
+  /// event, rejection and timing counters, metrics PSet
+  ModuleMetrics metrics_;
+
 };
 
 #endif
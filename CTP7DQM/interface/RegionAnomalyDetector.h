@@ -0,0 +1,105 @@
+#ifndef REGIONANOMALYDETECTOR_H
+#define REGIONANOMALYDETECTOR_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+//
+// Hot/dead/stuck region detector for L1TCTP7. Keeps exponentially
+// weighted (EWMA) occupancy, mean E_T and mean E_T^2 for the 396 regions
+// in flat float arrays ([ieta*18 + iphi], padded to a multiple of 8) so
+// that the per-event update is one branch-free loop the compiler
+// vectorises. Every checkEvery events each region is compared with the
+// other regions of its eta ring:
+//  - dead:  occupancy < deadFactor x ring occupancy
+//  - hot:   occupancy or mean E_T > hotFactor x ring value
+//  - stuck: always non-zero with an E_T rms below stuckRms
+// Results go to RctRegionsAnomalyEtaPhi (1 dead, 2 hot, 3 stuck),
+// RctRegionsAnomaliesVsEvt and the flagged() list; changes are logged.
+// Only one BX of a multi-BC capture is followed: centralBx, the position
+// in the readout window (default the middle one).
+//
+
+class RegionAnomalyDetector {
+
+public:
+
+  enum Flag { None = 0, Dead = 1, Hot = 2, Stuck = 3 };
+
+  struct Anomaly {
+    unsigned int ieta;
+    unsigned int iphi;
+    Flag flag;
+    float occupancy;
+    float meanEt;
+  };
+
+  explicit RegionAnomalyDetector(const edm::ParameterSet& ps);
+
+  bool enabled() const { return enabled_; }
+
+  // books in the current folder
+  void book(DQMStore* dbe);
+
+  // position in a readout window of nBx crossings of the BX to fill
+  unsigned int slot(unsigned int nBx) const {
+    return (centralBx_ >= 0 && centralBx_ < int(nBx)) ? centralBx_ : (nBx > 0 ? (nBx - 1)/2 : 0);
+  }
+
+  void fill(unsigned int ieta, unsigned int iphi, unsigned int et) {
+    const unsigned int c = ieta*NPHI + iphi;
+    if (c < NCELLS) et_[c] = et;
+  }
+
+  // fold the event into the running statistics, evaluate every checkEvery
+  void endEvent(unsigned int event);
+
+  const std::vector<Anomaly>& flagged() const { return flagged_; }
+
+  // the MEs written with setBinContent, whose entry count stays 0
+  bool writesContents(const MonitorElement* me) const {
+    return me && (me == anomalyEtaPhi_ || me == anomaliesVsEvt_);
+  }
+
+private:
+
+  static const unsigned int NETA = 22;
+  static const unsigned int NPHI = 18;
+  static const unsigned int NCELLS = NETA*NPHI;
+  static const unsigned int NPAD = (NCELLS + 7)/8*8;
+
+  void evaluate(unsigned int event);
+
+  bool enabled_;
+  int centralBx_;
+  float alpha_;
+  unsigned int checkEvery_;
+  unsigned int minEvents_;
+  float hotFactor_;
+  float deadFactor_;
+  float minRingOccupancy_;
+  float stuckRms_;
+
+  unsigned int nEvents_;
+
+  // this event's E_T and the running statistics, [ieta*NPHI + iphi]
+  alignas(32) float et_[NPAD];
+  alignas(32) float occ_[NPAD];
+  alignas(32) float meanEt_[NPAD];
+  alignas(32) float meanEt2_[NPAD];
+
+  unsigned char state_[NCELLS];
+  std::vector<Anomaly> flagged_;
+
+  MonitorElement* anomalyEtaPhi_;
+  MonitorElement* anomaliesVsEvt_;
+
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef TRIGGERROUTING_H
+#define TRIGGERROUTING_H
+
+#include <string>
+#include <vector>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+// DQM
+#include "DQMServices/Core/interface/DQMStore.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+//
+// Trigger-type routing of an analyzer, in place of a single
+// filterTriggerType. The triggerRouting PSet names one subfolder of the
+// module folder per view and lists the experimentType values it monitors:
+//
+//   triggerRouting = cms.untracked.PSet(
+//       Physics = cms.untracked.vint32(1),
+//       Calibration = cms.untracked.vint32(2),
+//       Random = cms.untracked.vint32(3)
+//   )
+//
+// Every event goes through a lookup table indexed by experimentType to
+// the view of its type, and types that are not listed are skipped. The
+// monitors that are not split by type (quality tests, PUM calibration,
+// anomaly detector, per-crate EM ranks) see the events of the shared
+// route: the one holding PhysicsTrigger, or else the first by name.
+// Simulated events have no trigger type and go to the shared route.
+// An empty PSet turns routing off (one view, the module folder).
+//
+
+class TriggerRouting {
+
+public:
+
+  TriggerRouting(const std::string& module, const std::string& folder, const edm::ParameterSet& ps);
+
+  bool enabled() const { return !names_.empty(); }
+
+  // number of views, 1 without routing
+  unsigned int size() const { return enabled() ? names_.size() : 1; }
+
+  // view of the trigger type, -1 if it is not monitored
+  int route(int experimentType) const {
+    if (!enabled()) return 0;
+    return (experimentType >= 0 && experimentType < NTYPES) ? table_[experimentType] : -1;
+  }
+
+  // folder of the view, the module folder itself without routing
+  const std::string& folder(unsigned int route) const { return folders_[route]; }
+  unsigned int shared() const { return shared_; }
+
+  // the module folder and every view subfolder
+  const std::string& base() const { return base_; }
+
+  // histogram name as seen from the module folder, "Physics/RctRegionRank"
+  std::string relativeName(const MonitorElement* me) const;
+
+private:
+
+  static const int NTYPES = 16;
+
+  std::string base_;
+  std::vector<std::string> names_;
+  std::vector<std::string> folders_;
+  int table_[NTYPES];
+  unsigned int shared_;
+
+};
+
+//
+// Per-view copies of a fixed list of MonitorElement* members of an
+// analyzer. The fill code keeps using the members; select() stores them
+// as the copies of the current view and loads those of the next one.
+// The views may also be per card (CardSources), added up with sum().
+//
+
+template <class T>
+class HistogramViews {
+
+public:
+
+  typedef MonitorElement* T::* Member;
+
+  HistogramViews(const Member* members, unsigned int n) :
+    members_(members, members + n), current_(0) { }
+
+  void resize(unsigned int views) {
+    me_.assign(views*members_.size(), static_cast<MonitorElement*>(0));
+    current_ = 0;
+  }
+
+  unsigned int current() const { return current_; }
+
+  void select(T& owner, unsigned int view) {
+    if (view == current_ || me_.empty()) return;
+    const unsigned int n = members_.size();
+    for (unsigned int i = 0; i < n; i++) me_[current_*n + i] = owner.*members_[i];
+    for (unsigned int i = 0; i < n; i++) owner.*members_[i] = me_[view*n + i];
+    current_ = view;
+  }
+
+  // the histograms of view to become the sum of those of the views from,
+  // members not booked in view to are skipped
+  void sum(T& owner, unsigned int to, const std::vector<unsigned int>& from) {
+    if (me_.empty()) return;
+    const unsigned int n = members_.size();
+    for (unsigned int i = 0; i < n; i++) me_[current_*n + i] = owner.*members_[i];
+    for (unsigned int i = 0; i < n; i++) {
+      MonitorElement* total = me_[to*n + i];
+      if (!total) continue;
+      total->Reset();
+      for (std::vector<unsigned int>::const_iterator v = from.begin(); v != from.end(); v++)
+        if (me_[*v*n + i]) total->getTH1()->Add(me_[*v*n + i]->getTH1());
+    }
+  }
+
+private:
+
+  std::vector<Member> members_;
+  std::vector<MonitorElement*> me_;
+  unsigned int current_;
+
+};
+
+#endif
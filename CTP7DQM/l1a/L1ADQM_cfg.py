@@ -37,7 +37,41 @@ process.l1tctp7 = cms.EDAnalyzer("RCTL1A",
     outputFile = cms.untracked.string('./L1ADQM.root'),
     ctp7Source = cms.InputTag("rctToDigi"),
     verbose = cms.untracked.bool(True),
-    filterTriggerType  = cms.int32(-1)
+    filterTriggerType  = cms.int32(-1),
+    latencyFile = cms.untracked.string('latency.txt'),
+    # buffers unpacked by RCTToDigi (testFile), checked at beginRun
+    #daqBuffers = cms.untracked.vstring('daqBuffers/daqBuffer-L1A-3359-nBCs-5.txt'),
+    # evaluated at every lumi boundary, see OnlineQualityTests.h
+    qualityTests = cms.untracked.PSet(
+        enable = cms.untracked.bool(True),
+        referenceFile = cms.untracked.string(''),   # e.g. CTP7DQMMC.root for the chi2 test
+        minEvents = cms.untracked.uint32(100),
+        maxChi2PerNdf = cms.untracked.double(3.),
+        deadOccupancy = cms.untracked.double(0.),
+        hotFactor = cms.untracked.double(5.),
+        maxDead = cms.untracked.uint32(0),
+        maxHot = cms.untracked.uint32(0)
+    ),
+    # the same tests on the iso-EM map, barrel and endcaps only: EM
+    # candidates are rarer than regions, so a cell may stay empty in a lumi
+    emQualityTests = cms.untracked.PSet(
+        enable = cms.untracked.bool(True),
+        referenceFile = cms.untracked.string(''),
+        minEvents = cms.untracked.uint32(1000),
+        maxChi2PerNdf = cms.untracked.double(3.),
+        deadOccupancy = cms.untracked.double(0.),
+        hotFactor = cms.untracked.double(5.),
+        maxDead = cms.untracked.uint32(10),
+        maxHot = cms.untracked.uint32(0)
+    ),
+    # per-lumi eta-phi maps, read with ctp7MapHistory
+    mapHistory = cms.untracked.PSet(
+        file = cms.untracked.string('./L1ADQM_maps.bin')
+    ),
+    # counters for the monitoring agent, one exporter for the whole job
+    metrics = cms.untracked.PSet(
+        socket = cms.untracked.string('/tmp/ctp7_metrics.sock')
+    )
 )
 
 
@@ -46,12 +80,17 @@ process.ctp7link = cms.EDAnalyzer("LinkDQM",
     disableROOToutput = cms.untracked.bool(False),
     outputFile = cms.untracked.string('./L1ADQM.root'),
     ctp7Source = cms.InputTag("rctToDigi"),
+    latencyFile = cms.untracked.string('latency.txt'),
     verbose = cms.untracked.bool(False)
 )
 
 
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+process.regionSummary.ctp7Source = cms.InputTag("rctToDigi")
+
 #This creates DQM-compatible plots
-process.p = cms.Path(process.l1tctp7+process.ctp7link+process.dqmSaver)
+process.p = cms.Path(process.regionSummary+process.l1tctp7+process.ctp7link+process.dqmSaver)
 
 # For faster debugging & extra couts we can also work with a standard analyzer
 #process.ctp7protodqm = cms.EDAnalyzer('CTP7DQM')
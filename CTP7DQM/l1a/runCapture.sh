@@ -43,8 +43,12 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
 
 	mv *.root "$NAME/$foldername"
 	mv *.log "$NAME/$foldername"
+	# capture and dqm stamps of this capture, see CaptureLatency.h
+	[ -f latency.txt ] && mv latency.txt "$NAME/$foldername"
 
 	echo -e $NAME/$COUNTER"_Capture_"$timestamp"/L1ADQM.root" >> "$NAME"/archiveList.txt 
+	ctp7CaptureIndex add "$NAME"/captureIndex.bin "$NAME/$foldername" >> "$NAME"/logIndex.txt 2>&1
+	ctp7Archive store "$NAME" "$NAME/$foldername" >> "$NAME"/logIndex.txt 2>&1
 
 	let COUNTER+=1
 
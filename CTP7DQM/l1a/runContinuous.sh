@@ -17,6 +17,11 @@ fi
 
 echo "Checking TimingTests "$N_ITERATIONS" time"$MAYBE_AN_S"..."
 
+# the timestamped folders, and the objects of ctp7Archive, live here and
+# not next to the configs and macros
+ARCHIVE="continuousL1A"
+mkdir -p "$ARCHIVE"
+
 
 COUNTER=1
 until [  $COUNTER -gt "$N_ITERATIONS" ]; do
@@ -44,14 +49,15 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
 	root -b -q macros/linkplotter.C >& plots.log 
 	mv L1ADQM.root mergeOLD.root 
 
-	foldername=$(date +%Y%m%d_%H%M%S)
+	foldername="$ARCHIVE"/$(date +%Y%m%d_%H%M%S)
 	mkdir -p "$foldername" 
 	cp *png *log  "$foldername"
 	cp mergeOLD.root L1ADQM_$COUNTER.root RCTToDigi.root  "$foldername"
 	rm DQM_V0001_R000000001__L1TMonitor__Calo__CTP7.root
 	cp index.html "$foldername"
-	cp rct.log /afs/cern.ch/user/r/rctcmstr/www/L1A/.
-	cp *png /afs/cern.ch/user/r/rctcmstr/www/L1A/. 
+	[ -f latency.txt ] && mv latency.txt "$foldername"
+	ctp7Archive store "$ARCHIVE" "$foldername"
+	ctp7Archive copy /afs/cern.ch/user/r/rctcmstr/www/L1A rct.log *png
 
 	let COUNTER+=1
 
@@ -1,15 +1,21 @@
 #!/bin/bash
  
 NAME="runningL1A"
+SELECT=""
  
 while [ "$1" != "" ]; do
     case $1 in
-        -h | --help )               echo "harvesting.sh usage: bash harvesting.sh [-h] [--name dirName]"
+        -h | --help )               echo "harvesting.sh usage: bash harvesting.sh [-h] [--name dirName] [--last-hours H] [--links-good]"
                                     exit 1
                                     ;;
         --name )                    shift
                                     NAME=$1
                                     ;;
+        --last-hours )              shift
+                                    SELECT="$SELECT --last-hours $1"
+                                    ;;
+        --links-good )              SELECT="$SELECT --links-good"
+                                    ;;
     esac
     shift
 done
@@ -23,7 +29,12 @@ while [ $RUN == true ]; do
 	  echo "Something bad happened: your directory with root files does not exit!"
 	  echo "You should first run runCapture.sh; the harvesting will run in the background"
 	else
-	  cat "$NAME"/archiveList.txt  | xargs hadd -f L1ADQMMERGED.root 
+	  if [ "$SELECT" != "" ] && [ -f "$NAME"/captureIndex.bin ]; then
+	    # only the captures selected in the index, see ctp7CaptureIndex
+	    ctp7CaptureIndex query "$NAME"/captureIndex.bin $SELECT | xargs hadd -f L1ADQMMERGED.root
+	  else
+	    cat "$NAME"/archiveList.txt  | xargs hadd -f L1ADQMMERGED.root 
+	  fi
 	  root -b -q macros/fastplotter.C >& plots.log
 	  root -b -q macros/linkplotter.C >& plots2.log 
 	  mv L1ADQMMERGED.root "$NAME"
@@ -1,5 +1,8 @@
 import FWCore.ParameterSet.Config as cms
 
+# L1TCTP7 reads the RegionSummary of this producer
+from CTP7Tests.RegionSummary.regionSummary_cfi import regionSummary
+
 l1tctp7 = cms.EDAnalyzer("L1TCTP7",
     DQMStore = cms.untracked.bool(True),
     disableROOToutput = cms.untracked.bool(False),
@@ -0,0 +1,199 @@
+/*
+ * \file BxAlignment.cc
+ *
+ * Per-card and per-crate BX alignment from the E_T-weighted BX centroids
+ * of multi-BC captures.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/BxAlignment.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#include "DataFormats/L1CaloTrigger/interface/L1CaloRegionDetId.h"
+#include "FWCore/Utilities/interface/UnixSignalHandlers.h"
+
+using namespace edm;
+
+const unsigned int BXBINS = RegionSummary::MAXBX;
+const float BXMIN = -0.5;
+const float BXMAX = RegionSummary::MAXBX - 0.5;
+
+BxAlignment::BxAlignment(const ParameterSet & ps) :
+	etVsBx_(0),
+	cardOffset_(0),
+	cardError_(0),
+	crateOffset_(0),
+	regionSummary_( consumes<RegionSummary>(ps.getUntrackedParameter< InputTag >("regionSummary", InputTag("regionSummary")) )),
+	centralBx_ (ps.getUntrackedParameter< int >("centralBx", -1)),
+	targetError_ (ps.getUntrackedParameter< double >("targetError", 0.05)),
+	minEvents_ (ps.getUntrackedParameter< unsigned int >("minEvents", 20)),
+	checkEvery_ (ps.getUntrackedParameter< unsigned int >("checkEvery", 100)),
+	offsetFile_ (ps.getUntrackedParameter< std::string >("offsetFile", "bxAlignment.txt")),
+	stopWhenConverged_ (ps.getUntrackedParameter< bool >("stopWhenConverged", true)),
+	firstBx_ (0),
+	nBx_ (0),
+	central_ (0),
+	cards_ (NCRATES*NCARDS),
+	crates_ (NCRATES),
+	nev_ (0),
+	used_ (0),
+	converged_ (false),
+	warned_ (false)
+{
+	if (checkEvery_ == 0) checkEvery_ = 1;
+
+	dbe = NULL;
+	if (ps.getUntrackedParameter < bool > ("DQMStore", false)) {
+		dbe = Service < DQMStore > ().operator->();
+	}
+}
+
+BxAlignment::~BxAlignment()
+{
+}
+
+void BxAlignment::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
+{
+	if (!dbe) return;
+	dbe->setCurrentFolder("L1T/BxAlignment");
+
+	etVsBx_ =
+		dbe->book1D("BxAlignmentEtVsBx", "REGION E_{T} PER BX OF THE WINDOW", BXBINS, BXMIN, BXMAX);
+	cardOffset_ =
+		dbe->book2D("BxAlignmentCardOffset", "BX OFFSET PER CARD (HF = 7)", NCRATES, -0.5, NCRATES - 0.5, NCARDS, -0.5, NCARDS - 0.5);
+	cardError_ =
+		dbe->book2D("BxAlignmentCardError", "BX OFFSET UNCERTAINTY PER CARD (HF = 7)", NCRATES, -0.5, NCRATES - 0.5, NCARDS, -0.5, NCARDS - 0.5);
+	crateOffset_ =
+		dbe->book1D("BxAlignmentCrateOffset", "BX OFFSET PER CRATE", NCRATES, -0.5, NCRATES - 0.5);
+}
+
+void BxAlignment::analyze(const Event & e, const EventSetup & c)
+{
+	nev_++;
+	if (converged_) return;
+
+	Handle < RegionSummary > summary;
+	e.getByToken(regionSummary_, summary);
+	if (!summary.isValid() || !summary->hasRegions()) {
+		edm::LogInfo("DataNotFound") << "can't find RegionSummary";
+		return;
+	}
+	const RegionSummary& rs = *summary;
+
+	// the centroids are positions in one fixed readout window
+	if (nBx_ == 0 && rs.nBx_ > 1) {
+		firstBx_ = rs.firstBx_;
+		nBx_ = rs.nBx_;
+		central_ = (centralBx_ >= 0 && centralBx_ < int(nBx_)) ? centralBx_ : (nBx_ - 1)/2;
+		edm::LogInfo("BxAlignment") << "readout window of " << nBx_ << " BX from " << firstBx_
+			<< ", central BX at position " << central_;
+	}
+	if (rs.nBx_ < 2 || rs.firstBx_ != firstBx_ || rs.nBx_ != nBx_) {
+		if (!warned_) edm::LogWarning("BxAlignment") << "event with a readout window of " << rs.nBx_
+			<< " BX from " << rs.firstBx_ << " skipped, the alignment needs the multi-BC window of the first event";
+		warned_ = true;
+		return;
+	}
+	used_++;
+
+	for (std::vector<uint16_t>::const_iterator i = rs.nonZeroIndex_.begin(); i != rs.nonZeroIndex_.end(); i++) {
+		const unsigned int position = *i / RegionSummary::NREGIONS;
+		const L1CaloRegionDetId id(rs.gctEta(*i), rs.gctPhi(*i));
+		const unsigned int crate = id.rctCrate();
+		if (crate >= NCRATES) continue;
+		const unsigned int card = id.isHf() ? NCARDS - 1 : id.rctCard();
+		const double et = rs.et(*i);
+		if (card < NCARDS) cards_.add(crate*NCARDS + card, position, et);
+		crates_.add(crate, position, et);
+		if (etVsBx_) etVsBx_->Fill(position, et);
+	}
+	if (rs.hasEm()) {
+		for (unsigned int k = 0; k < rs.emSize(); k++) {
+			const int position = rs.emBx_[k] - firstBx_;
+			if (position < 0 || position >= int(nBx_) || rs.emCrate_[k] >= NCRATES) continue;
+			crates_.add(rs.emCrate_[k], position, rs.emRank_[k]);
+		}
+	}
+	cards_.endEvent();
+	crates_.endEvent();
+
+	if (used_ % checkEvery_ != 0) return;
+	if (!publish()) return;
+
+	converged_ = true;
+	edm::LogInfo("BxAlignment") << "BX alignment converged after " << used_ << " events, table in " << offsetFile_;
+	if (stopWhenConverged_) {
+		edm::LogInfo("BxAlignment") << "stopping the job";
+		edm::shutdown_flag = true;
+	}
+}
+
+bool BxAlignment::converged() const
+{
+	// every crate must have data; cards with too few events are not required
+	for (unsigned int c = 0; c < NCRATES; c++) {
+		const double err = crates_.error(c);
+		if (crates_.events(c) < minEvents_ || err < 0 || err > targetError_) return false;
+	}
+	for (unsigned int c = 0; c < cards_.size(); c++) {
+		if (cards_.events(c) < minEvents_) continue;
+		if (cards_.error(c) > targetError_) return false;
+	}
+	return true;
+}
+
+bool BxAlignment::publish()
+{
+	const bool done = converged();
+
+	for (unsigned int c = 0; c < NCRATES; c++) {
+		if (crateOffset_ && crates_.events(c) > 0) {
+			crateOffset_->setBinContent(c + 1, crates_.centroid(c) - central_);
+			crateOffset_->setBinError(c + 1, crates_.error(c));
+		}
+		for (unsigned int k = 0; k < NCARDS; k++) {
+			const unsigned int ch = c*NCARDS + k;
+			if (!cardOffset_ || cards_.events(ch) == 0) continue;
+			cardOffset_->setBinContent(c + 1, k + 1, cards_.centroid(ch) - central_);
+			cardError_->setBinContent(c + 1, k + 1, cards_.error(ch));
+		}
+	}
+
+	if (offsetFile_.empty()) return done;
+	const std::string tmp = offsetFile_ + ".tmp";
+	std::ofstream out(tmp.c_str());
+	out << "# BX alignment, window of " << nBx_ << " BX from " << firstBx_ << ", central position " << central_
+		<< ", " << used_ << " events, " << (done ? "converged" : "not converged")
+		<< " (target " << targetError_ << " BX)" << std::endl
+		<< "#         crate card  events         E_T  offset   error  shift" << std::endl
+		<< std::fixed;
+	for (unsigned int c = 0; c < NCRATES + cards_.size(); c++) {
+		const bool crate = c < NCRATES;
+		const BxCentroids& centroids = crate ? crates_ : cards_;
+		const unsigned int ch = crate ? c : c - NCRATES;
+		if (centroids.events(ch) == 0) continue;
+		const double offset = centroids.centroid(ch) - central_;
+		out << (crate ? "crate " : "card  ") << std::setw(9) << (crate ? ch : ch/NCARDS) << std::setw(5);
+		if (crate) out << "-";
+		else out << ch % NCARDS;
+		out << std::setw(8) << centroids.events(ch) << std::setw(12) << std::setprecision(0) << centroids.et(ch)
+			<< std::setw(8) << std::setprecision(3) << offset << std::setw(8) << centroids.error(ch)
+			<< std::setw(7) << -lround(offset) << std::endl;
+	}
+	out.close();
+	rename(tmp.c_str(), offsetFile_.c_str());
+	return done;
+}
+
+void BxAlignment::endJob(void)
+{
+	LogInfo("EndJob") << "analyzed " << nev_ << " events, " << used_ << " with a multi-BC window";
+	if (used_ == 0) return;
+	if (!publish() && !converged_)
+		LogWarning("BxAlignment") << "BX alignment not converged to " << targetError_ << " BX after " << used_
+			<< " events, table in " << offsetFile_;
+}
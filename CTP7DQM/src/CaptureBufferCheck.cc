@@ -0,0 +1,51 @@
+/*
+ * \file CaptureBufferCheck.cc
+ *
+ * DAQ buffer validation of the capture, counted by reason code.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/CaptureBufferCheck.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "CTP7Tests/CaptureTools/interface/BufferValidator.h"
+
+CaptureBufferCheck::CaptureBufferCheck(const std::string& module, const edm::ParameterSet& ps) :
+  module_(module),
+  files_(ps.getUntrackedParameter < std::vector<std::string> > ("daqBuffers", std::vector<std::string>())),
+  rejectCorrupt_(ps.getUntrackedParameter < bool > ("rejectCorruptBuffers", true)),
+  rejected_(false),
+  skipped_(0),
+  check_(0)
+{
+}
+
+void CaptureBufferCheck::book(DQMStore* dbe)
+{
+  if (!dbe || files_.empty()) return;
+  check_ = dbe->book1D("RctBufferCheck", "DAQ BUFFER CHECK", ctp7buf::NREASONS, -0.5, ctp7buf::NREASONS - 0.5);
+  for (unsigned int r = 0; r < ctp7buf::NREASONS; r++)
+    check_->setBinLabel(r + 1, ctp7buf::reasonName(ctp7buf::Reason(r)));
+
+  rejected_ = false;
+  for (std::vector<std::string>::const_iterator f = files_.begin(); f != files_.end(); f++) {
+    ctp7buf::BufferCheck check;
+    std::string error;
+    if (!ctp7buf::validateFile(*f, check, error)) {
+      edm::LogWarning(module_) << "daqBuffers: " << error;
+      continue;
+    }
+    check_->Fill(check.reason);
+    if (check.reason == ctp7buf::Ok) continue;
+    edm::LogWarning(module_) << "daqBuffers: " << *f << ": " << ctp7buf::describe(check)
+                             << (rejectCorrupt_ ? ", capture rejected" : "");
+    if (rejectCorrupt_) rejected_ = true;
+  }
+}
+
+void CaptureBufferCheck::endJob()
+{
+  if (skipped_)
+    edm::LogWarning(module_) << skipped_ << " events of a corrupted capture skipped";
+}
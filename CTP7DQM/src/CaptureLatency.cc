@@ -0,0 +1,81 @@
+/*
+ * \file CaptureLatency.cc
+ *
+ * Capture-to-DQM latency from the TimeMonitor stamps.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/CaptureLatency.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+// 10 s bins up to one hour, later fills go to the overflow
+const unsigned int LATENCYBINS = 360;
+const float LATENCYMIN = 0.;
+const float LATENCYMAX = 3600.;
+
+CaptureLatency::CaptureLatency(const std::string& module, const edm::ParameterSet& ps) :
+  module_(module),
+  file_(ps.getUntrackedParameter < std::string > ("latencyFile", "")),
+  capture_(0),
+  latency_(0),
+  metric_(MetricsRegistry::instance().gauge("ctp7_dqm_capture_latency_seconds",
+                                            "Seconds from the capture to the DQM fill of the last event.", module))
+{
+}
+
+void CaptureLatency::book(DQMStore* dbe)
+{
+  if (!dbe) return;
+  latency_ = dbe->book1D("RctCaptureLatency", "CAPTURE TO DQM FILL LATENCY (s)",
+                         LATENCYBINS, LATENCYMIN, LATENCYMAX);
+}
+
+time_t CaptureLatency::captureTime(const TimeMonitor& t, time_t now)
+{
+  struct tm local;
+  localtime_r(&now, &local);
+  struct tm c;
+  memset(&c, 0, sizeof(c));
+  c.tm_year = local.tm_year;
+  c.tm_mon = t.date() % 100 - 1;
+  c.tm_mday = t.date() / 100;
+  c.tm_hour = t.minute() / 10000;
+  c.tm_min = t.minute() / 100 % 100;
+  c.tm_sec = t.minute() % 100;
+  c.tm_isdst = -1;
+  if (c.tm_mon < 0 || c.tm_mon > 11 || c.tm_mday < 1) return 0;
+  time_t capture = mktime(&c);
+  // captured in December, processed in January
+  if (capture > now + 86400) {
+    c.tm_year--;
+    c.tm_isdst = -1;
+    capture = mktime(&c);
+  }
+  return capture;
+}
+
+void CaptureLatency::fill(const TimeMonitorCollection& time)
+{
+  if (time.empty()) return;
+  const time_t now = ::time(0);
+  if (capture_ == 0) capture_ = captureTime(time.back(), now);
+  if (capture_ == 0) return;
+  if (latency_) latency_->Fill(static_cast<double>(now - capture_));
+  metric_.set(static_cast<double>(now - capture_));
+}
+
+void CaptureLatency::endJob()
+{
+  if (file_.size() == 0 || capture_ == 0) return;
+  std::ofstream out(file_.c_str(), std::ios::app);
+  if (!out) {
+    edm::LogWarning("CaptureLatency") << "cannot write " << file_;
+    return;
+  }
+  out << "capture " << capture_ << "\n"
+      << "dqm:" << module_ << " " << ::time(0) << std::endl;
+}
@@ -0,0 +1,53 @@
+/*
+ * \file CardSources.cc
+ *
+ * The CTP7 cards of an analyzer and the folders of their views.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/CardSources.h"
+
+#include <set>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "CTP7Tests/RegionSummary/interface/RegionSummary.h"
+
+CardSources::CardSources(const std::string& module, const edm::ParameterSet& ps) :
+  listed_(false)
+{
+  std::vector<edm::InputTag> sources =
+    ps.getUntrackedParameter< std::vector<edm::InputTag> >("ctp7Sources", std::vector<edm::InputTag>());
+  if (sources.empty()) {
+    sources_.push_back(ps.getParameter< edm::InputTag >("ctp7Source"));
+    names_.push_back(sources_.back().label());
+    return;
+  }
+
+  listed_ = true;
+  std::set<std::string> seen;
+  for (std::vector<edm::InputTag>::const_iterator src = sources.begin(); src != sources.end(); src++) {
+    const std::string name = RegionSummary::cardName(src->label(), src->instance());
+    if (!seen.insert(name).second) {
+      edm::LogWarning(module) << "ctp7Sources: " << src->encode() << " listed twice, ignored";
+      continue;
+    }
+    sources_.push_back(*src);
+    names_.push_back(name);
+  }
+
+  std::string cards;
+  for (unsigned int c = 0; c < names_.size(); c++) cards += " " + names_[c];
+  edm::LogInfo(module) << names_.size() << " cards:" << cards;
+}
+
+edm::InputTag CardSources::summary(const edm::InputTag& regionSummary, unsigned int card) const
+{
+  if (!listed_) return regionSummary;
+  return edm::InputTag(regionSummary.label(), names_[card], regionSummary.process());
+}
+
+std::string CardSources::folder(const std::string& base, const std::string& view, unsigned int card) const
+{
+  if (!multi() || card >= size()) return view;
+  return base + "/" + names_[card] + view.substr(base.size());
+}
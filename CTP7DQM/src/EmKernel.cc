@@ -0,0 +1,94 @@
+/*
+ * \file EmKernel.cc
+ *
+ * Single-pass EM candidate partition, cell sums and per-crate top-N.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/EmKernel.h"
+
+#include <algorithm>
+
+// EM ranks are 6 bits
+const unsigned int RANKBINS = 64;
+const float RANKMIN = -0.5;
+const float RANKMAX = 63.5;
+
+EmKernel::EmKernel(unsigned int topN) :
+  topN_(std::max(1u, std::min(topN, MAXTOPN))),
+  top_(NCRATES*MAXTOPN, 0),
+  leadRank_(0),
+  topRank_(0)
+{
+  for (unsigned int i = 0; i < 2; i++) cellEt_[i].assign(NCELLS, 0);
+  candidates_.reserve(2*4*NCRATES);
+}
+
+void EmKernel::insertTop(unsigned int crate, uint16_t rank)
+{
+  uint16_t* t = &top_[crate*MAXTOPN];
+  if (rank <= t[topN_ - 1]) return;
+  // shift the smaller ranks down one slot, the last one drops out
+  unsigned int i = topN_ - 1;
+  for (; i > 0 && t[i - 1] < rank; i--) t[i] = t[i - 1];
+  t[i] = rank;
+}
+
+void EmKernel::process(const RegionSummary& summary)
+{
+  // undo the previous event: only what it touched
+  for (unsigned int iso = 0; iso < 2; iso++) {
+    for (std::vector<uint16_t>::const_iterator c = touched_[iso].begin(); c != touched_[iso].end(); c++)
+      cellEt_[iso][*c] = 0;
+    touched_[iso].clear();
+  }
+  for (std::vector<Candidate>::const_iterator c = candidates_.begin(); c != candidates_.end(); c++)
+    std::fill(top_.begin() + c->crate*MAXTOPN, top_.begin() + (c->crate + 1)*MAXTOPN, 0);
+  candidates_.clear();
+  iso_.clear();
+  nonIso_.clear();
+
+  for (unsigned int i = 0; i < summary.emSize(); i++) {
+    const uint16_t rank = summary.emRank_[i];
+    Candidate c;
+    c.rank = rank;
+    c.bx = summary.emBx_[i];
+    c.ieta = summary.emEta_[i];
+    c.iphi = summary.emPhi_[i];
+    c.crate = summary.emCrate_[i];
+    c.iso = summary.emIso_[i];
+    if (c.cell() >= NCELLS || c.crate >= NCRATES) continue;
+
+    (c.iso ? iso_ : nonIso_).push_back(candidates_.size());
+    candidates_.push_back(c);
+
+    uint16_t& et = cellEt_[c.iso][c.cell()];
+    if (et == 0) touched_[c.iso].push_back(c.cell());
+    et += rank;
+
+    insertTop(c.crate, rank);
+  }
+}
+
+void EmKernel::book(DQMStore* dbe)
+{
+  if (!dbe) return;
+  leadRank_ = dbe->book2D("RctEmCrateLeadRank", "HIGHEST EM RANK PER CRATE",
+                          NCRATES, -0.5, NCRATES - 0.5, RANKBINS, RANKMIN, RANKMAX);
+  topRank_ = dbe->book2D("RctEmCrateTopRank", "TOP " + std::to_string(topN_) + " EM RANKS PER CRATE",
+                         NCRATES, -0.5, NCRATES - 0.5, RANKBINS, RANKMIN, RANKMAX);
+}
+
+void EmKernel::fillSummary()
+{
+  if (!leadRank_) return;
+  // a crate is reset and filled only if it had a candidate, so visit those
+  unsigned int done = 0;
+  for (std::vector<Candidate>::const_iterator c = candidates_.begin(); c != candidates_.end(); c++) {
+    if (done & (1u << c->crate)) continue;
+    done |= 1u << c->crate;
+    const uint16_t* t = top(c->crate);
+    leadRank_->Fill(c->crate, t[0]);
+    for (unsigned int i = 0; i < topN_ && t[i] > 0; i++) topRank_->Fill(c->crate, t[i]);
+  }
+}
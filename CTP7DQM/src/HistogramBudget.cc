@@ -0,0 +1,143 @@
+/*
+ * \file HistogramBudget.cc
+ *
+ * Booking-time memory accounting and budget of the CTP7DQM analyzers.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/HistogramBudget.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "TH1.h"
+#include "TH2.h"
+#include "TProfile.h"
+
+const double MEGABYTE = 1024.*1024.;
+
+HistogramBudget::HistogramBudget(const std::string& module, const edm::ParameterSet& ps) :
+  module_(module),
+  maxBytes_(static_cast<size_t>(ps.getUntrackedParameter < double > ("maxMegabytes", 0.)*MEGABYTE)),
+  action_(Report),
+  reportElements_(ps.getUntrackedParameter < bool > ("reportElements", true)),
+  minBins_(ps.getUntrackedParameter < unsigned int > ("minBins", 64)),
+  bytes_(0)
+{
+  std::string action = ps.getUntrackedParameter < std::string > ("action", "report");
+  if (action == "coarsen") action_ = Coarsen;
+  else if (action == "refuse") action_ = Refuse;
+  else if (action != "report")
+    edm::LogWarning("HistogramBudget") << "unknown memoryBudget action " << action << ", using report";
+}
+
+size_t HistogramBudget::cells(const TH1* h)
+{
+  return h ? static_cast<size_t>(h->GetNcells()) : 0;
+}
+
+size_t HistogramBudget::footprint(const TH1* h)
+{
+  if (!h) return 0;
+  const size_t n = cells(h);
+  size_t perCell = sizeof(double);
+  if (dynamic_cast<const TArrayF*>(h)) perCell = sizeof(float);
+  else if (dynamic_cast<const TArrayI*>(h)) perCell = sizeof(int);
+  else if (dynamic_cast<const TArrayS*>(h)) perCell = sizeof(short);
+  else if (dynamic_cast<const TArrayC*>(h)) perCell = sizeof(char);
+  size_t bytes = n*perCell + h->GetSumw2N()*sizeof(double);
+  // profiles also keep the entries per bin
+  if (dynamic_cast<const TProfile*>(h)) bytes += n*sizeof(double);
+  return bytes;
+}
+
+namespace {
+  struct Booked {
+    TH1* h;
+    std::string name;
+    size_t bytes;
+    bool operator<(const Booked& o) const { return bytes > o.bytes; }
+  };
+}
+
+size_t HistogramBudget::audit(DQMStore* dbe, const std::string& folder)
+{
+  bytes_ = 0;
+  if (!dbe) return 0;
+
+  std::vector<Booked> booked;
+  std::vector<MonitorElement*> mes = dbe->getAllContents(folder);
+  for (std::vector<MonitorElement*>::const_iterator me = mes.begin(); me != mes.end(); me++) {
+    if ((*me)->kind() < MonitorElement::DQM_KIND_TH1F) continue;
+    Booked b;
+    b.h = (*me)->getTH1();
+    if (!b.h) continue;
+    // histograms of a subfolder are reported as subfolder/name
+    const std::string& path = (*me)->getPathname();
+    b.name = path.size() > folder.size() ? path.substr(folder.size() + 1) + "/" + (*me)->getName()
+                                         : (*me)->getName();
+    b.bytes = footprint(b.h);
+    bytes_ += b.bytes;
+    booked.push_back(b);
+  }
+  std::sort(booked.begin(), booked.end());
+
+  if (reportElements_) {
+    edm::LogInfo info("HistogramBudget");
+    info << module_ << " booked histograms in " << folder << " (bins, kB):";
+    for (std::vector<Booked>::const_iterator b = booked.begin(); b != booked.end(); b++)
+      info << "\n  " << b->name << " " << cells(b->h) << " " << b->bytes/1024;
+  }
+  edm::LogInfo("HistogramBudget") << module_ << ": " << booked.size() << " histograms, "
+                                  << bytes_/MEGABYTE << " MB";
+
+  if (maxBytes_ == 0 || bytes_ <= maxBytes_) return bytes_;
+
+  if (action_ == Refuse)
+    throw cms::Exception("HistogramBudget")
+      << module_ << " books " << bytes_/MEGABYTE << " MB of histograms, over the memoryBudget of "
+      << maxBytes_/MEGABYTE << " MB; select a smaller histogramProfile or raise maxMegabytes\n";
+
+  if (action_ == Report) {
+    edm::LogWarning("HistogramBudget") << module_ << " books " << bytes_/MEGABYTE
+                                       << " MB of histograms, over the memoryBudget of "
+                                       << maxBytes_/MEGABYTE << " MB";
+    return bytes_;
+  }
+
+  // coarsen: always merge the currently largest histogram, axes below
+  // minBins bins (the eta-phi maps) are never touched
+  while (bytes_ > maxBytes_ && !booked.empty()) {
+    Booked& b = booked.front();
+    const int nx = b.h->GetNbinsX(), ny = b.h->GetNbinsY();
+    const int gx = (nx >= (int) minBins_ && nx % 2 == 0) ? 2 : 1;
+    const int gy = (b.h->GetDimension() == 2 && ny >= (int) minBins_ && ny % 2 == 0) ? 2 : 1;
+    if (gx == 1 && gy == 1) {
+      booked.erase(booked.begin());
+      continue;
+    }
+    if (b.h->GetDimension() == 2) static_cast<TH2*>(b.h)->Rebin2D(gx, gy);
+    else b.h->Rebin(gx);
+
+    const size_t before = b.bytes;
+    b.bytes = footprint(b.h);
+    bytes_ = bytes_ - before + b.bytes;
+    edm::LogWarning("HistogramBudget") << module_ << ": coarsened " << b.name << " from "
+                                       << nx << "x" << ny << " to " << b.h->GetNbinsX() << "x"
+                                       << b.h->GetNbinsY() << " bins, " << before/1024 << " -> "
+                                       << b.bytes/1024 << " kB";
+    std::sort(booked.begin(), booked.end());
+  }
+
+  if (bytes_ > maxBytes_)
+    edm::LogWarning("HistogramBudget") << module_ << " still books " << bytes_/MEGABYTE
+                                       << " MB after coarsening, over the memoryBudget of "
+                                       << maxBytes_/MEGABYTE << " MB";
+  else
+    edm::LogInfo("HistogramBudget") << module_ << ": " << bytes_/MEGABYTE << " MB after coarsening";
+
+  return bytes_;
+}
@@ -8,6 +8,7 @@
 #include "CTP7Tests/CTP7DQM/interface/L1TCTP7.h"
 #include "DataFormats/Provenance/interface/EventAuxiliary.h"
 
+
 //DQMStore
 #include "DQMServices/Core/interface/DQMStore.h"
 
@@ -42,10 +43,47 @@ const unsigned int PUMBINS = 22;
 const float PUMMIN = -0.5;
 const float PUMMAX = 21.5;
 
+// everything booked per trigger-type view by bookGroup
+const HistogramViews<L1TCTP7>::Member L1TCTP7::VIEWHISTOGRAMS[] = {
+  &L1TCTP7::ctp7RegionsEtEtaPhi_, &L1TCTP7::ctp7RegionsOccEtaPhi_, &L1TCTP7::ctp7RegionRank_,
+  &L1TCTP7::ctp7RegionBx_,
+  &L1TCTP7::ctp7OverFlowEtaPhi_, &L1TCTP7::ctp7TauVetoEtaPhi_, &L1TCTP7::ctp7MipEtaPhi_,
+  &L1TCTP7::ctp7QuietEtaPhi_, &L1TCTP7::ctp7HfPlusTauEtaPhi_,
+  &L1TCTP7::ctp7RegionsTotalRegionEt_, &L1TCTP7::ctp7RegionsAverageRegionEt_,
+  &L1TCTP7::ctp7RegionsAvgEtVsEta_, &L1TCTP7::ctp7RegionsNonZero_, &L1TCTP7::ctp7RegionsNormNonZero_,
+  &L1TCTP7::ctp7RegionsNonZeroVsEvt_, &L1TCTP7::ctp7RegionsNonZeroBarrelVsEvt_,
+  &L1TCTP7::ctp7RegionsNonZeroHFVsEvt_, &L1TCTP7::ctp7RegionsNormNonZeroVsEvt_,
+  &L1TCTP7::ctp7RegionsAvgEtVsEvt_, &L1TCTP7::ctp7RegionsTotEtVsEvt_, &L1TCTP7::ctp7RegionsOccVsEvt_,
+  &L1TCTP7::ctp7RegionsEtMapVsEvt_, &L1TCTP7::ctp7RegionsHFPhiOccETVsEvt_,
+  &L1TCTP7::ctp7RegionsHFPhiPlusOccETVsEvt_, &L1TCTP7::ctp7RegionsHFPhiMinusOccETVsEvt_,
+  &L1TCTP7::ctp7RegionsMaxEtVsEvt_, &L1TCTP7::ctp7RegionsMaxEtHFVsEvt_,
+  &L1TCTP7::ctp7RegionsMaxEtBarrelVsEvt_,
+  &L1TCTP7::ctp7IsoEmEtEtaPhi_, &L1TCTP7::ctp7IsoEmOccEtaPhi_, &L1TCTP7::ctp7NonIsoEmEtEtaPhi_,
+  &L1TCTP7::ctp7NonIsoEmOccEtaPhi_, &L1TCTP7::ctp7EmAvgEtVsEta_, &L1TCTP7::ctp7IsoEmRank_,
+  &L1TCTP7::ctp7NonIsoEmRank_, &L1TCTP7::ctp7EmBx_,
+  &L1TCTP7::ctp7EmTotEtVsEvt_, &L1TCTP7::ctp7EmAvgEtVsEvt_, &L1TCTP7::ctp7EmMaxEtVsEvt_,
+  &L1TCTP7::ctp7EmNonZeroVsEvt_
+};
+
 L1TCTP7::L1TCTP7(const ParameterSet & ps) :
-   ctp7Source_L1CRCollection_( consumes<L1CaloRegionCollection>(ps.getParameter< InputTag >("ctp7Source") )),
-   ctp7Source_L1CEMCollection_( consumes<L1CaloEmCollection>(ps.getParameter< InputTag >("ctp7Source") )),
-   filterTriggerType_ (ps.getParameter< int >("filterTriggerType"))
+   cards_ ("L1TCTP7", ps),
+   ctp7Source_TCollection_( consumes<TimeMonitorCollection>(cards_.source(0)) ),
+   filterTriggerType_ (ps.getParameter< int >("filterTriggerType")),
+   routing_ ("L1TCTP7", "L1T/L1TCTP7", ps.getUntrackedParameter< ParameterSet >("triggerRouting", ParameterSet())),
+   views_ (VIEWHISTOGRAMS, sizeof(VIEWHISTOGRAMS)/sizeof(VIEWHISTOGRAMS[0])),
+   regionQuality_ ("RctRegions", "RctRegionsEtEtaPhi", routing_.base(),
+                   ps.getUntrackedParameter< ParameterSet >("qualityTests", ParameterSet())),
+   isoEmQuality_ ("RctEmIsoEm", "RctEmIsoEmEtEtaPhi", routing_.base(),
+                  ps.getUntrackedParameter< ParameterSet >("emQualityTests",
+                      ps.getUntrackedParameter< ParameterSet >("qualityTests", ParameterSet())),
+                  OnlineQualityTests::FIRST_EM_ETA, OnlineQualityTests::LAST_EM_ETA),
+   pum_ (ps),
+   anomalies_ (ps.getUntrackedParameter< ParameterSet >("anomalyDetector", ParameterSet())),
+   budget_ ("L1TCTP7", ps.getUntrackedParameter< ParameterSet >("memoryBudget", ParameterSet())),
+   emKernel_ (ps.getUntrackedParameter< unsigned int >("emTopN", 4)),
+   mapHistory_ ("L1TCTP7", routing_, ps.getUntrackedParameter< ParameterSet >("mapHistory", ParameterSet())),
+   output_ ("L1TCTP7", ps),
+   metrics_ ("L1TCTP7", ps)
 {
 
   // verbosity switch
@@ -74,12 +112,34 @@ L1TCTP7::L1TCTP7(const ParameterSet & ps) :
   if (disable) {
     outputFile_ = "";
   }
+  if (dbe != NULL) output_.open(outputFile_, routing_.base());
 
 
   if (dbe != NULL) {
     dbe->setCurrentFolder("L1T/L1TCTP7");
   }
 
+  // optional live mirror of the histograms in shared memory
+  shmSegment_ = ps.getUntrackedParameter < std::string > ("shmSegment", "");
+  shmUpdateEvery_ = ps.getUntrackedParameter < unsigned int > ("shmUpdateEvery", 50);
+  if (shmUpdateEvery_ == 0) shmUpdateEvery_ = 1;
+
+  // optional per-event column file
+  eventSummaryFile_ = ps.getUntrackedParameter < std::string > ("eventSummaryFile", "");
+
+  // histogram groups to fill: minimal, pum, timing or full
+  groups_ = profileGroups(ps.getUntrackedParameter < std::string > ("histogramProfile", "full"));
+  booked_ = 0;
+
+  // regions, EM and links of every card, decoded once by RegionSummaryProducer
+  const InputTag regionSummary = ps.getUntrackedParameter< InputTag >("regionSummary", InputTag("regionSummary"));
+  for (unsigned int card = 0; card < cards_.size(); card++)
+    regionSummaries_.push_back(consumes<RegionSummary>(cards_.summary(regionSummary, card)));
+
+  views_.resize(routing_.size()*cards_.views());
+  viewBooked_.assign(routing_.size()*cards_.views(), 0);
+  if (routing_.enabled() && filterTriggerType_ >= 0)
+    edm::LogWarning("L1TCTP7") << "triggerRouting is set, filterTriggerType is ignored";
 
 }
 
@@ -90,11 +150,35 @@ L1TCTP7::~L1TCTP7()
 void L1TCTP7::beginJob(void)
 {
   nev_ = 0;
+
+  if (eventSummaryFile_.size() != 0) {
+    // same order as SummaryColumn
+    eventSummary_.reset(new ColumnFileWriter(eventSummaryFile_));
+    eventSummary_->addColumn("run", ctp7col::UInt32);
+    eventSummary_->addColumn("lumi", ctp7col::UInt32);
+    eventSummary_->addColumn("event", ctp7col::UInt64);
+    eventSummary_->addColumn("date", ctp7col::UInt32);
+    eventSummary_->addColumn("time", ctp7col::UInt32);
+    eventSummary_->addColumn("triggerType", ctp7col::UInt32);
+    eventSummary_->addColumn("nonZero", ctp7col::UInt32);
+    eventSummary_->addColumn("nonZeroBarrel", ctp7col::UInt32);
+    eventSummary_->addColumn("nonZeroHF", ctp7col::UInt32);
+    eventSummary_->addColumn("totalEt", ctp7col::UInt32);
+    eventSummary_->addColumn("maxEt", ctp7col::UInt32);
+    eventSummary_->addColumn("maxEtBarrel", ctp7col::UInt32);
+    eventSummary_->addColumn("maxEtHF", ctp7col::UInt32);
+    eventSummary_->addColumn("emNonZero", ctp7col::UInt32);
+    eventSummary_->addColumn("emTotalEt", ctp7col::UInt32);
+    eventSummary_->addColumn("emMaxEt", ctp7col::UInt32);
+    eventSummary_->addColumn("linkMask", ctp7col::UInt64);
+    eventSummary_->addColumn("badLinks", ctp7col::UInt32);
+    if (!eventSummary_->open()) eventSummary_.reset();
+  }
 }
 
 void L1TCTP7::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
 {
-  //Only histograms booking
+  //Only histograms booking; the histogram groups are booked on first use
 
   // get hold of back-end interface
   DQMStore *dbe = 0;
@@ -105,7 +189,172 @@ void L1TCTP7::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
 
     triggerType_ =
       dbe->book1D("TriggerType", "TriggerType", 17, -0.5, 16.5);
+
+    // quality summaries, filled at the lumi boundaries
+    regionQuality_.book(dbe);
+    isoEmQuality_.book(dbe);
+    anomalies_.book(dbe);
+
+    // highest EM ranks per crate
+    emKernel_.book(dbe);
+
+    // the selected groups of every view are booked now with a memory
+    // budget, so that it is enforced once on the worst case before the
+    // first event, with a shared-memory segment, which is created once
+    // with every histogram and never replaced under its readers, and with
+    // several cards so that the card sums have every histogram; PUM once
+    if (budget_.limited() || shmSegment_.size() != 0 || cards_.multi()) {
+      for (unsigned int v = 0; v < routing_.size()*cards_.views(); v++) {
+        selectView(v);
+        for (unsigned int g = RegionMaps; g & AllGroups; g <<= 1)
+          if (groups_ & g & ~booked_ && (g != Pum || v == view(0, routing_.shared())))
+            bookGroup(static_cast<HistogramGroup>(g));
+      }
+      selectView(view(0, routing_.shared()));
+    }
+
+    budget_.audit(dbe, routing_.base());
+    registerShm(dbe);
+  }
+}
+
+void L1TCTP7::registerShm(DQMStore* dbe)
+{
+  // once per run, after every group is booked
+  if (shmSegment_.size() == 0) return;
+  shm_.reset(new ShmHistogramWriter(shmSegment_, "L1TCTP7"));
+  std::vector<MonitorElement*> mes = dbe->getAllContents(routing_.base());
+  for (std::vector<MonitorElement*>::const_iterator me = mes.begin(); me != mes.end(); me++)
+    shm_->add(routing_.relativeName(*me), (*me)->getTH1(),
+              pum_.writesContents(*me) || anomalies_.writesContents(*me));
+  if (!shm_->open()) shm_.reset();
+}
+
+void L1TCTP7::selectView(unsigned int view)
+{
+  viewBooked_[views_.current()] = booked_;
+  views_.select(*this, view);
+  booked_ = viewBooked_[view];
+}
+
+std::string L1TCTP7::viewFolder(unsigned int view) const
+{
+  return cards_.folder(routing_.base(), routing_.folder(view % routing_.size()), view / routing_.size());
+}
+
+void L1TCTP7::sumCards()
+{
+  if (!cards_.multi()) return;
+  for (unsigned int r = 0; r < routing_.size(); r++) {
+    std::vector<unsigned int> cards;
+    for (unsigned int card = 0; card < cards_.size(); card++) cards.push_back(view(card, r));
+    views_.sum(*this, view(cards_.sum(), r), cards);
+  }
+}
+
+unsigned int L1TCTP7::profileGroups(const std::string& profile)
+{
+  if (profile == "minimal") return RegionMaps | EmMaps;
+  if (profile == "pum") return RegionMaps | EmMaps | RegionTotals | Pum;
+  if (profile == "timing") return RegionMaps | EmMaps | RegionVsEvt | EmVsEvt;
+  if (profile != "full")
+    edm::LogWarning("L1TCTP7") << "unknown histogramProfile " << profile << ", using full";
+  return AllGroups;
+}
+
+void L1TCTP7::bookGroup(HistogramGroup group)
+{
+  booked_ |= group;
+
+  DQMStore *dbe = 0;
+  dbe = Service < DQMStore > ().operator->();
+  if (!dbe) return;
+  // PUM calibration is not split by trigger type
+  dbe->setCurrentFolder(group == Pum ? routing_.base() : viewFolder(views_.current()));
+
+  switch (group) {
+
+  case RegionMaps :
     // global regions
+    ctp7RegionsEtEtaPhi_ =
+	dbe->book2D("RctRegionsEtEtaPhi", "REGION E_{T}", ETABINS, ETAMIN,
+		    ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+    ctp7RegionsOccEtaPhi_ =
+	dbe->book2D("RctRegionsOccEtaPhi", "REGION OCCUPANCY", ETABINS,
+		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+
+    // rank histos
+    ctp7RegionRank_ =
+	dbe->book1D("RctRegionRank", "REGION RANK", R10BINS, R10MIN,
+		    R10MAX);
+
+    // local regions
+/*
+    const int nlocphibins = 2; 
+    const float locphimin = -0.5;
+    const float locphimax = 1.5;
+    const int nlocetabins = 11;
+    const float locetamin = -0.5;
+    const float locetamax = 10.5;
+    ctp7RegionsLocalEtEtaPhi_ =
+	dbe->book2D("RctRegionsLocalEtEtaPhi", "REGION E_{T} (Local)", 
+		    nlocetabins, locetamin, locetamax,
+		    nlocphibins, locphimin, locphimax);
+    ctp7RegionsLocalOccEtaPhi_ =
+	dbe->book2D("RctRegionsLocalOccEtaPhi", "REGION OCCUPANCY (Local)", 
+		    nlocetabins, locetamin, locetamax,
+		    nlocphibins, locphimin, locphimax);
+    ctp7TauVetoLocalEtaPhi_ =
+	dbe->book2D("RctTauLocalVetoEtaPhi", "TAU VETO OCCUPANCY (Local)",
+		    nlocetabins, locetamin, locetamax,
+		    nlocphibins, locphimin, locphimax);
+*/
+
+    // bx histos
+    ctp7RegionBx_ = dbe->book1D("RctRegionBx", "Region BX", 256, -0.5, 4095.5);
+    break;
+
+  case RegionBits :
+    ctp7OverFlowEtaPhi_ =
+	dbe->book2D("RctBitOverFlowEtaPhi", "OVER FLOW OCCUPANCY", ETABINS,
+		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+
+    ctp7TauVetoEtaPhi_ =
+	dbe->book2D("RctBitTauVetoEtaPhi", "TAU VETO OCCUPANCY", ETABINS,
+		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+
+    ctp7MipEtaPhi_ =
+	dbe->book2D("RctBitMipEtaPhi", "MIP OCCUPANCY", ETABINS,
+		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+
+    ctp7QuietEtaPhi_ =
+	dbe->book2D("RctBitQuietEtaPhi", "QUIET OCCUPANCY", ETABINS,
+		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+
+    ctp7HfPlusTauEtaPhi_ =
+	dbe->book2D("RctBitHfPlusTauEtaPhi", "HF plus Tau OCCUPANCY", ETABINS,
+		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+    break;
+
+  case RegionTotals :
+    ctp7RegionsTotalRegionEt_ =
+        dbe->book1D("RctRegionsTotalRegionEt", "AVERAGE REGION RANK", 100,0,100000);
+
+    ctp7RegionsAverageRegionEt_ =
+	dbe->book1D("RctRegionsAverageRegionEt", "AVERAGE REGION RANK", R10BINS, R10MIN, R10MAX);
+
+    ctp7RegionsAvgEtVsEta_ =
+	dbe->book2D("RctRegionsAvgEtVsEta", " AVERAGE REGION RANK vs ETA", ETABINS, ETAMIN,
+                    ETAMAX, R10BINS, R10MIN, R10MAX);
+
+    ctp7RegionsNonZero_ =
+        dbe->book1D("RctRegionsNonZero", "REGION PUM", NUMREGIONS,-0.5,NUMREGIONS-0.5);
+
+    ctp7RegionsNormNonZero_ =
+	dbe->book1D("RctRegionsNormNonZero", "REGION PUM", PUMBINS, PUMMIN, PUMMAX);
+    break;
+
+  case RegionVsEvt :
     ctp7RegionsNonZeroVsEvt_ =
 	dbe->book2D("RctRegionsNonZeroVsEvt", "REGION PUM vs EVT", EVBINS, EVMIN,
                     EVMAX, NUMREGIONS,-0.5,NUMREGIONS-0.5);
@@ -161,102 +410,14 @@ void L1TCTP7::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
     ctp7RegionsMaxEtBarrelVsEvt_ =
         dbe->book2D("RctRegionsMaxEtBarrelVsEvt", " MAX REGION RANK gctETA=10||11 vs EVT", EVBINS, EVMIN,
                     EVMAX, R10BINS, R10MIN, R10MAX);
+    break;
 
-    ctp7EmTotEtVsEvt_ =
-                dbe->book2D("RctEmIsoTotEtVsEvt", " TOTAL REGION RANK vs EVT", EVBINS, EVMIN,
-                    EVMAX, R10BINS*2,R10MIN,R10MAX*2);
-
-    ctp7RegionsTotalRegionEt_ =
-        dbe->book1D("RctRegionsTotalRegionEt", "AVERAGE REGION RANK", 100,0,100000);
-
-    ctp7EmAvgEtVsEvt_ =
-		dbe->book2D("RctEmIsoAvgEtVsEvt", " AVERAGE REGION RANK vs EVT", EVBINS, EVMIN,
-                    EVMAX, R10BINS, R10MIN, R10MAX);
-
-    ctp7EmMaxEtVsEvt_ =
-        dbe->book2D("RctEmIsoMaxEtVsEvt", " MAX REGION RANK vs EVT", EVBINS, EVMIN,
-                    EVMAX, R10BINS, R10MIN, R10MAX);
-
-    ctp7RegionsAverageRegionEt_ =
-	dbe->book1D("RctRegionsAverageRegionEt", "AVERAGE REGION RANK", R10BINS, R10MIN, R10MAX);
-
-    ctp7RegionsAvgEtVsEta_ =
-	dbe->book2D("RctRegionsAvgEtVsEta", " AVERAGE REGION RANK vs ETA", ETABINS, ETAMIN,
-                    ETAMAX, R10BINS, R10MIN, R10MAX);
-
-    ctp7RegionsNonZero_ =
-        dbe->book1D("RctRegionsNonZero", "REGION PUM", NUMREGIONS,-0.5,NUMREGIONS-0.5);
-
-    ctp7RegionsNormNonZero_ =
-	dbe->book1D("RctRegionsNormNonZero", "REGION PUM", PUMBINS, PUMMIN, PUMMAX);
-
-    ctp7RegionsPumEta0_ =
-	dbe->book2D("RctRegionsPumEta0", " PUM BIN", PUMBINS, PUMMIN,
-		    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta1_ =
-	dbe->book2D("RctRegionsPumEta1", " PUM BIN", PUMBINS, PUMMIN,
-		    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta2_ =
-        dbe->book2D("RctRegionsPumEta2", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta3_ =
-        dbe->book2D("RctRegionsPumEta3", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta4_ =
-        dbe->book2D("RctRegionsPumEta4", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta5_ =
-        dbe->book2D("RctRegionsPumEta5", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta6_ =
-        dbe->book2D("RctRegionsPumEta6", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta7_ =
-        dbe->book2D("RctRegionsPumEta7", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta8_ =
-        dbe->book2D("RctRegionsPumEta8", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta9_ =
-        dbe->book2D("RctRegionsPumEta9", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta10_ =
-	dbe->book2D("RctRegionsPumEta10", " PUM BIN", PUMBINS, PUMMIN,
-		    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta11_ =
-	dbe->book2D("RctRegionsPumEta11", " PUM BIN", PUMBINS, PUMMIN,
-		    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta12_ =
-        dbe->book2D("RctRegionsPumEta12", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta13_ =
-        dbe->book2D("RctRegionsPumEta13", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta14_ =
-        dbe->book2D("RctRegionsPumEta14", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta15_ =
-        dbe->book2D("RctRegionsPumEta15", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta16_ =
-        dbe->book2D("RctRegionsPumEta16", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta17_ =
-        dbe->book2D("RctRegionsPumEta17", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta18_ =
-        dbe->book2D("RctRegionsPumEta18", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta19_ =
-        dbe->book2D("RctRegionsPumEta19", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta20_ =
-        dbe->book2D("RctRegionsPumEta20", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
-    ctp7RegionsPumEta21_ =
-        dbe->book2D("RctRegionsPumEta21", " PUM BIN", PUMBINS, PUMMIN,
-                    PUMMAX, R10BINS, R10MIN, R10MAX);
+  case Pum :
+    // PUM calibration table (and the optional coarse RctRegionsPumEta*)
+    pum_.book(dbe);
+    break;
 
+  case EmMaps :
     ctp7IsoEmEtEtaPhi_ =
 	dbe->book2D("RctEmIsoEmEtEtaPhi", "ISO EM E_{T}", ETABINS, ETAMIN,
 		    ETAMAX, PHIBINS, PHIMIN, PHIMAX);
@@ -269,69 +430,11 @@ void L1TCTP7::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
     ctp7NonIsoEmOccEtaPhi_ =
 	dbe->book2D("RctEmNonIsoEmOccEtaPhi", "NON-ISO EM OCCUPANCY",
 		    ETABINS, ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-    ctp7EmNonZeroVsEvt_ =
-	dbe->book2D("RctEmIsoNonZeroVsEvt", "EM NonZero vs EVT", EVBINS, EVMIN,
-                    EVMAX, NUMREGIONS,-0.5,NUMREGIONS-0.5);
 
     ctp7EmAvgEtVsEta_ =
 	dbe->book2D("RctEmIsoAvgEtVsEta", " AVERAGE EM RANK vs ETA", ETABINS, ETAMIN,
                     ETAMAX, R10BINS, R10MIN, R10MAX);
 
-
-
-    // global regions
-    ctp7RegionsEtEtaPhi_ =
-	dbe->book2D("RctRegionsEtEtaPhi", "REGION E_{T}", ETABINS, ETAMIN,
-		    ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-    ctp7RegionsOccEtaPhi_ =
-	dbe->book2D("RctRegionsOccEtaPhi", "REGION OCCUPANCY", ETABINS,
-		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-    ctp7OverFlowEtaPhi_ =
-	dbe->book2D("RctBitOverFlowEtaPhi", "OVER FLOW OCCUPANCY", ETABINS,
-		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-    ctp7TauVetoEtaPhi_ =
-	dbe->book2D("RctBitTauVetoEtaPhi", "TAU VETO OCCUPANCY", ETABINS,
-		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-    ctp7MipEtaPhi_ =
-	dbe->book2D("RctBitMipEtaPhi", "MIP OCCUPANCY", ETABINS,
-		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-    ctp7QuietEtaPhi_ =
-	dbe->book2D("RctBitQuietEtaPhi", "QUIET OCCUPANCY", ETABINS,
-		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-    ctp7HfPlusTauEtaPhi_ =
-	dbe->book2D("RctBitHfPlusTauEtaPhi", "HF plus Tau OCCUPANCY", ETABINS,
-		    ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-    // local regions
-/*
-    const int nlocphibins = 2; 
-    const float locphimin = -0.5;
-    const float locphimax = 1.5;
-    const int nlocetabins = 11;
-    const float locetamin = -0.5;
-    const float locetamax = 10.5;
-    ctp7RegionsLocalEtEtaPhi_ =
-	dbe->book2D("RctRegionsLocalEtEtaPhi", "REGION E_{T} (Local)", 
-		    nlocetabins, locetamin, locetamax,
-		    nlocphibins, locphimin, locphimax);
-    ctp7RegionsLocalOccEtaPhi_ =
-	dbe->book2D("RctRegionsLocalOccEtaPhi", "REGION OCCUPANCY (Local)", 
-		    nlocetabins, locetamin, locetamax,
-		    nlocphibins, locphimin, locphimax);
-    ctp7TauVetoLocalEtaPhi_ =
-	dbe->book2D("RctTauLocalVetoEtaPhi", "TAU VETO OCCUPANCY (Local)",
-		    nlocetabins, locetamin, locetamax,
-		    nlocphibins, locphimin, locphimax);
-*/
-    // rank histos
-    ctp7RegionRank_ =
-	dbe->book1D("RctRegionRank", "REGION RANK", R10BINS, R10MIN,
-		    R10MAX);
     ctp7IsoEmRank_ =
 	dbe->book1D("RctEmIsoEmRank", "ISO EM RANK", R6BINS, R6MIN, R6MAX);
     ctp7NonIsoEmRank_ =
@@ -341,31 +444,105 @@ void L1TCTP7::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
 //    ctp7EmCardRegion_ = dbe->book1D("ctp7EmCardRegion", "Em Card * Region",
 //				   256, -127.5, 127.5);
 
-    // bx histos
-    ctp7RegionBx_ = dbe->book1D("RctRegionBx", "Region BX", 256, -0.5, 4095.5);
     ctp7EmBx_ = dbe->book1D("RctEmBx", "EM BX", 256, -0.5, 4095.5);
- 
+    break;
+
+  case EmVsEvt :
+    ctp7EmTotEtVsEvt_ =
+                dbe->book2D("RctEmIsoTotEtVsEvt", " TOTAL REGION RANK vs EVT", EVBINS, EVMIN,
+                    EVMAX, R10BINS*2,R10MIN,R10MAX*2);
+
+    ctp7EmAvgEtVsEvt_ =
+		dbe->book2D("RctEmIsoAvgEtVsEvt", " AVERAGE REGION RANK vs EVT", EVBINS, EVMIN,
+                    EVMAX, R10BINS, R10MIN, R10MAX);
+
+    ctp7EmMaxEtVsEvt_ =
+        dbe->book2D("RctEmIsoMaxEtVsEvt", " MAX REGION RANK vs EVT", EVBINS, EVMIN,
+                    EVMAX, R10BINS, R10MIN, R10MAX);
+
+    ctp7EmNonZeroVsEvt_ =
+	dbe->book2D("RctEmIsoNonZeroVsEvt", "EM NonZero vs EVT", EVBINS, EVMIN,
+                    EVMAX, NUMREGIONS,-0.5,NUMREGIONS-0.5);
+    break;
+
+  default :
+    break;
   }
 }
 
+void L1TCTP7::endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const& iSetup)
+{
+  regionQuality_.endLumi(iLumi.luminosityBlock());
+  isoEmQuality_.endLumi(iLumi.luminosityBlock());
+  sumCards();
+  mapHistory_.endLumi(dbe, iLumi.luminosityBlock());
+  pum_.publish();
+  output_.endLumi(dbe, iLumi.luminosityBlock());
+}
+
 void L1TCTP7::endJob(void)
 {
   if (verbose_)
     std::cout << "L1TCTP7: end job...." << std::endl;
   LogInfo("EndJob") << "analyzed " << nev_ << " events";
 
-  if (outputFile_.size() != 0 && dbe)
-    dbe->save(outputFile_);
+  pum_.publish();
+  pum_.writeLut();
+  sumCards();
+  mapHistory_.endJob();
+
+  if (eventSummary_) {
+    eventSummary_->close();
+    LogInfo("EndJob") << eventSummary_->rows() << " event summaries written to " << eventSummaryFile_;
+  }
+
+  if (shm_) shm_->update();
+
+  output_.endJob(dbe);
 
   return;
 }
 
+void L1TCTP7::fillEventSummaryHeader(const Event & e, const RegionSummary* summary)
+{
+  eventSummary_->set(colRun, static_cast<uint64_t>(e.id().run()));
+  eventSummary_->set(colLumi, static_cast<uint64_t>(e.luminosityBlock()));
+  eventSummary_->set(colEvent, static_cast<uint64_t>(e.id().event()));
+  eventSummary_->set(colTriggerType, static_cast<uint64_t>(e.experimentType()));
+
+  // the per-event columns start from zero, missing collections stay empty
+  for (unsigned int c = colNonZero; c < NSUMMARYCOLUMNS; c++)
+    eventSummary_->set(c, static_cast<uint64_t>(0));
+
+  edm::Handle < TimeMonitorCollection > time;
+  e.getByToken(ctp7Source_TCollection_,time);
+  if (time.isValid() && !time->empty()) {
+    eventSummary_->set(colDate, static_cast<uint64_t>(time->back().date()));
+    eventSummary_->set(colTime, static_cast<uint64_t>(time->back().minute()));
+  }
+
+  // bit i set if link i is not 0xf, as in LinkDQM
+  if (summary && summary->hasLinks()) {
+    eventSummary_->set(colLinkMask, summary->badLinkMask_);
+    eventSummary_->set(colBadLinks, static_cast<uint64_t>(summary->nBadLinks_));
+  }
+}
+
 void L1TCTP7::analyze(const Event & e, const EventSetup & c)
 {
+  ModuleMetrics::Timer timer(metrics_);
+  metrics_.event();
+
   if (verbose_) {
     std::cout << "L1TCTP7: analyze...." << std::endl;
   }
 
+  // publish what was accumulated so far, before any early return
+  if (shm_ && nev_ % shmUpdateEvery_ == 0) {
+    sumCards();
+    shm_->update();
+  }
+
   // filter according trigger type
   //  enum ExperimentType {
   //        Undefined          =  0,
@@ -385,8 +562,21 @@ void L1TCTP7::analyze(const Event & e, const EventSetup & c)
   triggerType_->Fill(triggerType);
   triggerType_->Fill(triggerTypeLast + 1);
 
+  // with triggerRouting, each trigger type fills its own view; simulated
+  // events have no trigger type and go to the shared one
+  unsigned int route = routing_.shared();
+  if (routing_.enabled()) {
+      if (e.isRealData()) {
+          const int r = routing_.route(e.experimentType());
+          if (r < 0) {
+            metrics_.rejectedTrigger();
+            return;
+          }
+          route = r;
+      }
+  }
   // filter only if trigger type is greater than 0, negative values disable filtering
-  if (filterTriggerType_ >= 0) {
+  else if (filterTriggerType_ >= 0) {
 
       // now filter, for real data only
       if (e.isRealData()) {
@@ -394,6 +584,7 @@ void L1TCTP7::analyze(const Event & e, const EventSetup & c)
 
               edm::LogInfo("L1TCTP7") << "\n Event of TriggerType "
                       << e.experimentType() << " rejected" << std::endl;
+              metrics_.rejectedTrigger();
               return;
 
           }
@@ -401,207 +592,200 @@ void L1TCTP7::analyze(const Event & e, const EventSetup & c)
 
   }
 
-  // Get the RCT digis
-  edm::Handle < L1CaloEmCollection > em;
-  edm::Handle < L1CaloRegionCollection > rgn;
+  // quality tests, PUM, anomalies and per-crate EM ranks are not split
+  const bool shared = route == routing_.shared();
+  if (shared) {
+    regionQuality_.countEvent();
+    isoEmQuality_.countEvent();
+  }
 
+  // every card fills its own view; the monitors that are not split and
+  // the event summary follow the first card
+  bool counted = false;
+  for (unsigned int card = 0; card < cards_.size(); card++) {
+    // regions, EM and links of the card, decoded once for all the modules
+    edm::Handle < RegionSummary > summary;
+    e.getByToken(regionSummaries_[card],summary);
+    const RegionSummary* rs = summary.isValid() ? summary.product() : 0;
+
+    if (card == 0 && eventSummary_) fillEventSummaryHeader(e, rs);
+    selectView(view(card, route));
+    if (fillCard(rs, shared && card == 0, card == 0) && card == 0) counted = true;
+  }
+  if (counted) nev_++;
+
+}
+
+bool L1TCTP7::fillCard(const RegionSummary* summary, bool shared, bool first)
+{
   bool doEm = true;
   bool doHd = true;
 
-  e.getByToken(ctp7Source_L1CRCollection_,rgn);
- 
-  if (!rgn.isValid()) {
+  if (!summary || !summary->hasRegions()) {
     edm::LogInfo("DataNotFound") << "can't find L1CaloRegionCollection";
     doHd = false;
   }
 
   if ( doHd ) {
-    // Fill the RCT histograms
-    double nonzeroregions = 0; // this is divided later
-    double nonzeroregions_barrel = 0; // this is divided later
-    double nonzeroregions_hf = 0; // this is divided later
-    double totalregionet = 0;
-    unsigned int maxregionet = 0;
-    unsigned int maxregionet_hf = 0;
-    unsigned int maxregionet_barrel = 0;
-
-    int regionbin=0;
-
-    // Regions
-    for (L1CaloRegionCollection::const_iterator ireg = rgn->begin();
-	 ireg != rgn->end(); ireg++) {
-      regionbin++;
-      if(ireg->et()>0)
-      {
-
-      ctp7RegionsEtMapVsEvt_->Fill(nev_,regionbin,ireg->et());
-      ctp7RegionsOccVsEvt_->Fill(nev_,regionbin);
-
-      nonzeroregions++;
-      totalregionet += ireg->et();
-      if(ireg->gctEta()==10||ireg->gctEta()==11){
-        nonzeroregions_barrel++;   
-	if(ireg->et()>maxregionet_barrel) maxregionet_barrel=ireg->et();     
+    const RegionSummary& rs = *summary;
+    double nonzeroregions = rs.nonZero_; // this is divided later
+    double nonzeroregions_barrel = rs.nonZeroBarrel_; // this is divided later
+    double nonzeroregions_hf = rs.nonZeroHF_; // this is divided later
+    double totalregionet = rs.totalEt_;
+    unsigned int maxregionet = rs.maxEt_;
+    unsigned int maxregionet_hf = rs.maxEtHF_;
+    unsigned int maxregionet_barrel = rs.maxEtBarrel_;
+
+    // decide once per event which groups are filled, booking them on first use
+    const bool maps = use(RegionMaps);
+    const bool bits = use(RegionBits);
+    const bool totals = use(RegionTotals);
+    const bool vsEvt = use(RegionVsEvt);
+    const bool pum = shared && use(Pum);
+
+    // non-zero regions
+    for (std::vector<uint16_t>::const_iterator i = rs.nonZeroIndex_.begin();
+         i != rs.nonZeroIndex_.end(); i++) {
+      const unsigned int et = rs.et(*i);
+      const unsigned int eta = rs.gctEta(*i);
+      const unsigned int phi = rs.gctPhi(*i);
+
+      if (vsEvt) {
+        ctp7RegionsEtMapVsEvt_->Fill(nev_,rs.regionId(*i),et);
+        ctp7RegionsOccVsEvt_->Fill(nev_,rs.regionId(*i));
+        if (RegionSummary::hf(eta)) {
+          ctp7RegionsHFPhiOccETVsEvt_->Fill(nev_,phi,et);
+          if(eta<4) ctp7RegionsHFPhiMinusOccETVsEvt_->Fill(nev_,phi,et);
+          if(eta>17) ctp7RegionsHFPhiPlusOccETVsEvt_->Fill(nev_,phi,et);
+        }
       }
-      if(ireg->gctEta()<4||ireg->gctEta()>17){
-        nonzeroregions_hf++;
-        if(ireg->et()>maxregionet_hf) maxregionet_hf=ireg->et();
-        ctp7RegionsHFPhiOccETVsEvt_->Fill(nev_,ireg->gctPhi(),ireg->et());
-
-        if(ireg->gctEta()<4) ctp7RegionsHFPhiMinusOccETVsEvt_->Fill(nev_,ireg->gctPhi(),ireg->et());
-
-        if(ireg->gctEta()>17) ctp7RegionsHFPhiPlusOccETVsEvt_->Fill(nev_,ireg->gctPhi(),ireg->et());
 
+      if (maps) {
+        ctp7RegionRank_->Fill(et);
+        if(et>5){
+          ctp7RegionsOccEtaPhi_->Fill(eta, phi);
+        }
+        ctp7RegionsEtEtaPhi_->Fill(eta, phi, et);
+        ctp7RegionBx_->Fill(rs.bx(*i));
       }
+      if (shared) regionQuality_.fill(eta, phi, et);
+    }
 
-      if(ireg->et()>maxregionet) maxregionet=ireg->et();        
-
-      ctp7RegionRank_->Fill(ireg->et());
-      if(ireg->et()>5){
-	ctp7RegionsOccEtaPhi_->Fill(ireg->gctEta(), ireg->gctPhi());
+    // all regions, zeros included
+    const unsigned int pumBin = PumCalibration::pumBin(nonzeroregions);
+    // the EWMA follows one crossing, not the last BX of the window
+    const unsigned int anomalySlot = anomalies_.slot(rs.nBx_);
+    for (unsigned int i = 0; i < rs.size(); i++) {
+      if (!rs.present(i)) continue;
+      const unsigned int eta = rs.gctEta(i);
+      const unsigned int phi = rs.gctPhi(i);
+
+      if (bits) {
+        if(rs.flag(i, RegionSummary::OverFlow))  ctp7OverFlowEtaPhi_ ->Fill(eta, phi);
+        if(rs.flag(i, RegionSummary::TauVeto))   ctp7TauVetoEtaPhi_  ->Fill(eta, phi);
+        if(rs.flag(i, RegionSummary::Mip))       ctp7MipEtaPhi_      ->Fill(eta, phi);
+        if(rs.flag(i, RegionSummary::Quiet))     ctp7QuietEtaPhi_    ->Fill(eta, phi);
+        if(rs.flag(i, RegionSummary::FineGrain)) ctp7HfPlusTauEtaPhi_->Fill(eta, phi);
       }
-      ctp7RegionsEtEtaPhi_->Fill(ireg->gctEta(), ireg->gctPhi(), ireg->et());
-      ctp7RegionBx_->Fill(ireg->bx());
-      }
-
-
-    if(ireg->overFlow())  ctp7OverFlowEtaPhi_ ->Fill(ireg->gctEta(), ireg->gctPhi());
-    if(ireg->tauVeto())   ctp7TauVetoEtaPhi_  ->Fill(ireg->gctEta(), ireg->gctPhi());
-    if(ireg->mip())       ctp7MipEtaPhi_      ->Fill(ireg->gctEta(), ireg->gctPhi());
-    if(ireg->quiet())     ctp7QuietEtaPhi_    ->Fill(ireg->gctEta(), ireg->gctPhi());
-    if(ireg->fineGrain()) ctp7HfPlusTauEtaPhi_->Fill(ireg->gctEta(), ireg->gctPhi()); 
-   
-      regionbin++;
- 
-    }//end region loop
+      if (shared && i / RegionSummary::NREGIONS == anomalySlot) anomalies_.fill(eta, phi, rs.et(i));
+      if (totals) ctp7RegionsAvgEtVsEta_->Fill(eta,rs.et(i));
+      if (pum) pum_.fill(pumBin, eta, rs.et(i));
+    }
+    if (shared) anomalies_.endEvent(nev_);
+
+    if (first && eventSummary_) {
+      eventSummary_->set(colNonZero, static_cast<uint64_t>(nonzeroregions));
+      eventSummary_->set(colNonZeroBarrel, static_cast<uint64_t>(nonzeroregions_barrel));
+      eventSummary_->set(colNonZeroHF, static_cast<uint64_t>(nonzeroregions_hf));
+      eventSummary_->set(colTotalEt, static_cast<uint64_t>(totalregionet));
+      eventSummary_->set(colMaxEt, static_cast<uint64_t>(maxregionet));
+      eventSummary_->set(colMaxEtBarrel, static_cast<uint64_t>(maxregionet_barrel));
+      eventSummary_->set(colMaxEtHF, static_cast<uint64_t>(maxregionet_hf));
+    }
     //
+    if (totals) {
     ctp7RegionsAverageRegionEt_->Fill(totalregionet*1.0/NUMREGIONS);
+    ctp7RegionsTotalRegionEt_->Fill(totalregionet);
+    ctp7RegionsNormNonZero_->Fill(nonzeroregions*1.0/PUMBINS);
+    ctp7RegionsNonZero_->Fill(nonzeroregions);
+    }
+
+    if (vsEvt) {
     ctp7RegionsAvgEtVsEvt_->Fill(nev_,totalregionet*1.0/NUMREGIONS);
     ctp7RegionsMaxEtVsEvt_->Fill(nev_,maxregionet);
     ctp7RegionsMaxEtHFVsEvt_->Fill(nev_,maxregionet_hf);
     ctp7RegionsMaxEtBarrelVsEvt_->Fill(nev_,maxregionet_barrel);
-
     ctp7RegionsTotEtVsEvt_->Fill(nev_,totalregionet);
-    ctp7RegionsTotalRegionEt_->Fill(totalregionet);
-
-    ctp7RegionsNormNonZero_->Fill(nonzeroregions*1.0/PUMBINS);
     ctp7RegionsNormNonZeroVsEvt_->Fill(nev_,(nonzeroregions*1.0)/(1.0*PUMBINS));
-
-    ctp7RegionsNonZero_->Fill(nonzeroregions);
     ctp7RegionsNonZeroVsEvt_->Fill(nev_,nonzeroregions);
     ctp7RegionsNonZeroBarrelVsEvt_->Fill(nev_,nonzeroregions_barrel);
     ctp7RegionsNonZeroHFVsEvt_->Fill(nev_,nonzeroregions_hf);
-
-    // Can we move this to a independent function, and/or clean up the loop (Maria)
-    //second region loop necessary because pum found in prior loop  
-    for (L1CaloRegionCollection::const_iterator ireg = rgn->begin();
-         ireg != rgn->end(); ireg++) {
-          ctp7RegionsAvgEtVsEta_->Fill(ireg->gctEta(),ireg->et());
-      if (ireg->gctEta()==0){
-          ctp7RegionsPumEta0_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==1) {
-          ctp7RegionsPumEta1_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==2){ 
-          ctp7RegionsPumEta2_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==3){ 
-          ctp7RegionsPumEta3_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==4){ 
-          ctp7RegionsPumEta4_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==5){ 
-          ctp7RegionsPumEta5_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==6){ 
-          ctp7RegionsPumEta6_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==7){ 
-          ctp7RegionsPumEta7_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==8){ 
-          ctp7RegionsPumEta8_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==9){ 
-          ctp7RegionsPumEta9_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==10){ 
-          ctp7RegionsPumEta10_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==11){ 
-          ctp7RegionsPumEta11_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==12){ 
-          ctp7RegionsPumEta12_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==13){ 
-          ctp7RegionsPumEta13_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==14){ 
-          ctp7RegionsPumEta14_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==15){ 
-          ctp7RegionsPumEta15_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==16){ 
-          ctp7RegionsPumEta16_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==17){ 
-          ctp7RegionsPumEta17_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==18){ 
-          ctp7RegionsPumEta18_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==19){ 
-          ctp7RegionsPumEta19_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==20){ 
-          ctp7RegionsPumEta20_->Fill(nonzeroregions/PUMBINS,ireg->et());}
-      else if (ireg->gctEta()==21){
-          ctp7RegionsPumEta21_->Fill(nonzeroregions/PUMBINS,ireg->et());}
     }
 
   }//end doHd
 
-  
-  e.getByToken(ctp7Source_L1CEMCollection_,em);
-  
-  if (!em.isValid()) {
+  if (!summary || !summary->hasEm()) {
     edm::LogInfo("DataNotFound") << "can't find L1CaloEmCollection";
     doEm = false;
   }
-  if ( ! doEm ) return;
+  if ( ! doEm ) {
+    if (first && eventSummary_) eventSummary_->endRow();
+    return false;
+  }
 
-    double nonzeroem = 0;
-    double totalemet = 0;
-    unsigned int maxemet = 0;
+    // partition and sum the candidates once
+    emKernel_.process(*summary);
+    const std::vector<EmKernel::Candidate>& cands = emKernel_.candidates();
+    double nonzeroem = summary->emSize();
+    double totalemet = summary->emTotalEt_;
+    unsigned int maxemet = summary->emMaxRank_;
+
+    if (shared) {
+      for (std::vector<uint16_t>::const_iterator i = emKernel_.isolated().begin();
+           i != emKernel_.isolated().end(); i++)
+        isoEmQuality_.fill(cands[*i].ieta, cands[*i].iphi, cands[*i].rank);
+    }
 
   // Isolated and non-isolated EM
-  for (L1CaloEmCollection::const_iterator iem = em->begin();
-       iem != em->end(); iem++) {
-    
-    if(iem->rank()>0) { nonzeroem++; totalemet+=iem->rank();}
-    if(iem->rank()>maxemet) maxemet=iem->rank(); 
-
-    if (iem->isolated()) {
-      if(iem->rank()>0)
-      {
-      ctp7IsoEmRank_->Fill(iem->rank());
-      ctp7IsoEmEtEtaPhi_->Fill(iem->regionId().ieta(),
-			      iem->regionId().iphi(), iem->rank());
-      ctp7EmAvgEtVsEta_->Fill(iem->regionId().ieta(),iem->rank());
-
-      if(iem->rank()>10){
-	ctp7IsoEmOccEtaPhi_->Fill(iem->regionId().ieta(),
-				 iem->regionId().iphi());
+  if (use(EmMaps)) {
+    for (std::vector<EmKernel::Candidate>::const_iterator c = cands.begin(); c != cands.end(); c++) {
+      if (c->iso) {
+        ctp7IsoEmRank_->Fill(c->rank);
+        ctp7EmAvgEtVsEta_->Fill(c->ieta, c->rank);
+        if (c->rank > 10) ctp7IsoEmOccEtaPhi_->Fill(c->ieta, c->iphi);
       }
-      ctp7EmBx_->Fill(iem->bx());
+      else {
+        ctp7NonIsoEmRank_->Fill(c->rank);
+        if (c->rank > 10) ctp7NonIsoEmOccEtaPhi_->Fill(c->ieta, c->iphi);
       }
+      ctp7EmBx_->Fill(c->bx);
     }
-    else {
-      if(iem->rank()>0)
-      { 
-      ctp7NonIsoEmRank_->Fill(iem->rank());
-      ctp7NonIsoEmEtEtaPhi_->Fill(iem->regionId().ieta(),
-				 iem->regionId().iphi(), iem->rank());
-      if(iem->rank()>10){
-	ctp7NonIsoEmOccEtaPhi_->Fill(iem->regionId().ieta(),
-				    iem->regionId().iphi());
-      }
-      ctp7EmBx_->Fill(iem->bx());
-      }
+
+    // one fill per touched cell with the summed rank
+    for (unsigned int iso = 0; iso < 2; iso++) {
+      MonitorElement* map = iso ? ctp7IsoEmEtEtaPhi_ : ctp7NonIsoEmEtEtaPhi_;
+      for (std::vector<uint16_t>::const_iterator cell = emKernel_.touched(iso).begin();
+           cell != emKernel_.touched(iso).end(); cell++)
+        map->Fill(*cell / EmKernel::NPHI, *cell % EmKernel::NPHI, emKernel_.cellEt(iso, *cell));
     }
 
+    if (shared) emKernel_.fillSummary();
   }
 
+    if (use(EmVsEvt)) {
     ctp7EmAvgEtVsEvt_->Fill(nev_,totalemet/NUMREGIONS);
     ctp7EmMaxEtVsEvt_->Fill(nev_,maxemet);
     ctp7EmTotEtVsEvt_->Fill(nev_,totalemet);
     ctp7EmNonZeroVsEvt_->Fill(nev_,nonzeroem);
+    }
 
+    if (first && eventSummary_) {
+      eventSummary_->set(colEmNonZero, static_cast<uint64_t>(nonzeroem));
+      eventSummary_->set(colEmTotalEt, static_cast<uint64_t>(totalemet));
+      eventSummary_->set(colEmMaxEt, static_cast<uint64_t>(maxemet));
+      eventSummary_->endRow();
+    }
 
-  nev_++;
+  return true;
 
 }
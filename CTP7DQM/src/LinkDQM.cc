@@ -31,12 +31,30 @@ const unsigned int TIMEBINS = 245959;
 const float TIMEMIN = -0.5;
 const float TIMEMAX = 245958.5;
 
+// everything booked per card
+const HistogramViews<LinkDQM>::Member LinkDQM::VIEWHISTOGRAMS[] = {
+	&LinkDQM::ctp7LinkMonitor_, &LinkDQM::ctp7LinkMonitorNot15_, &LinkDQM::ctp7LinkMonitor2D_,
+	&LinkDQM::ctp7LinkMonitorNot15_2D_, &LinkDQM::ctp7LinkMonitorVsTime_
+};
 
 
 LinkDQM::LinkDQM(const ParameterSet & ps) :
-	ctp7Source_LMCollection_( consumes<LinkMonitorCollection>(ps.getParameter< InputTag >("ctp7Source") )),
-	ctp7Source_TCollection_( consumes<TimeMonitorCollection>(ps.getParameter< InputTag >("ctp7Source") ))
+	cards_ ("LinkDQM", ps),
+	ctp7Source_TCollection_( consumes<TimeMonitorCollection>(cards_.source(0)) ),
+	views_ (VIEWHISTOGRAMS, sizeof(VIEWHISTOGRAMS)/sizeof(VIEWHISTOGRAMS[0])),
+	budget_ ("LinkDQM", ps.getUntrackedParameter< ParameterSet >("memoryBudget", ParameterSet())),
+	latency_ ("LinkDQM", ps),
+	output_ ("LinkDQM", ps),
+	metrics_ ("LinkDQM", ps)
 {
+	for (unsigned int card = 0; card < cards_.size(); card++) {
+		ctp7Source_LMCollection_.push_back(consumes<LinkMonitorCollection>(cards_.source(card)));
+		badLinkEventsMetric_.push_back(metrics_.counter("ctp7_dqm_bad_link_events_total",
+			"Events with a link of the card not 0xf.", "card", cards_.name(card)));
+		badLinksMetric_.push_back(metrics_.gauge("ctp7_dqm_bad_links",
+			"Links of the card not 0xf in the last event.", "card", cards_.name(card)));
+	}
+	views_.resize(cards_.views());
 
 
 
@@ -68,12 +86,18 @@ LinkDQM::LinkDQM(const ParameterSet & ps) :
 	if (disable) {
 		outputFile_ = "";
 	}
+	if (dbe != NULL) output_.open(outputFile_, "L1T/LinkDQM");
 
 
 	if (dbe != NULL) {
 		dbe->setCurrentFolder("L1T/LinkDQM");
 	}
 
+	// optional live mirror of the histograms in shared memory
+	shmSegment_ = ps.getUntrackedParameter < std::string > ("shmSegment", "");
+	shmUpdateEvery_ = ps.getUntrackedParameter < unsigned int > ("shmUpdateEvery", 50);
+	if (shmUpdateEvery_ == 0) shmUpdateEvery_ = 1;
+
 
 }
 
@@ -98,29 +122,72 @@ void LinkDQM::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
 
 	std::cout << "LinkDQM: begin run...." << std::endl;
 	if (dbe) {
-		dbe->setCurrentFolder("L1T/LinkDQM");
+		// the link histograms of each card, and their sum in L1T/LinkDQM
+		for (unsigned int card = 0; card < cards_.views(); card++) {
+			views_.select(*this, card);
+			dbe->setCurrentFolder(cards_.folder("L1T/LinkDQM", "L1T/LinkDQM", card));
+
+			ctp7LinkMonitor_ = 
+				dbe->book1D("RctLinkMonitor", "LINK MONITOR",NUINT, 0.,NUINT );
+			ctp7LinkMonitorNot15_ = 
+				dbe->book1D("RctLinkMonitorNot15", "LINK MONITOR NOT 0xf",NUINT,0., NUINT);
+			ctp7LinkMonitor2D_ = 
+				dbe->book2D("RctLinkMonitor2D", "LINK MONITOR 2D", NILINKS, NILINKSMIN, NILINKSMAX,2,-0.5,1.5);
+			ctp7LinkMonitorNot15_2D_ = 
+				dbe->book2D("RctLinkMonitorNot15_2D", "LINK MONITOR 2D Not 0xf", NILINKS, NILINKSMIN, NILINKSMAX,NUINT,0.,NUINT);
+			ctp7LinkMonitorVsTime_ = 
+				dbe->book2D("RctLinkMonitorVsTime", "LINK MONITOR Vs Time", TIMEBINS,TIMEMIN,TIMEMAX,NILINKS, NILINKSMIN, NILINKSMAX);
+		}
+		views_.select(*this, 0);
 
-		// global regions
-		ctp7LinkMonitor_ = 
-			dbe->book1D("RctLinkMonitor", "LINK MONITOR",NUINT, 0.,NUINT );
-		ctp7LinkMonitorNot15_ = 
-			dbe->book1D("RctLinkMonitorNot15", "LINK MONITOR NOT 0xf",NUINT,0., NUINT);
-		ctp7LinkMonitor2D_ = 
-			dbe->book2D("RctLinkMonitor2D", "LINK MONITOR 2D", NILINKS, NILINKSMIN, NILINKSMAX,2,-0.5,1.5);
-		ctp7LinkMonitorNot15_2D_ = 
-			dbe->book2D("RctLinkMonitorNot15_2D", "LINK MONITOR 2D Not 0xf", NILINKS, NILINKSMIN, NILINKSMAX,NUINT,0.,NUINT);
-		ctp7LinkMonitorVsTime_ = 
-			dbe->book2D("RctLinkMonitorVsTime", "LINK MONITOR Vs Time", TIMEBINS,TIMEMIN,TIMEMAX,NILINKS, NILINKSMIN, NILINKSMAX);
+		// the capture of the first card, bad link events of any card
+		dbe->setCurrentFolder("L1T/LinkDQM");
+		ctp7CaptureInfo_ =
+			dbe->book1D("RctCaptureInfo", "CAPTURE INFO", 3, 0.5, 3.5);
+		ctp7CaptureInfo_->setBinLabel(1, "captures");
+		ctp7CaptureInfo_->setBinLabel(2, "events");
+		ctp7CaptureInfo_->setBinLabel(3, "bad link events");
+		ctp7CaptureRun_ = dbe->bookInt("RctCaptureRun");
+		ctp7CaptureDate_ = dbe->bookInt("RctCaptureDate");
+		ctp7CaptureTime_ = dbe->bookInt("RctCaptureTime");
+
+		latency_.book(dbe);
+
+		budget_.audit(dbe, "L1T/LinkDQM");
+
+		if (shmSegment_.size() != 0) {
+			shm_.reset(new ShmHistogramWriter(shmSegment_, "LinkDQM"));
+			// the histograms of a card as card/name
+			const std::string base = "L1T/LinkDQM";
+			std::vector<MonitorElement*> mes = dbe->getAllContents(base);
+			for (std::vector<MonitorElement*>::const_iterator me = mes.begin(); me != mes.end(); me++) {
+				if ((*me)->kind() < MonitorElement::DQM_KIND_TH1F) continue;
+				const std::string& path = (*me)->getPathname();
+				shm_->add(path.size() > base.size() ? path.substr(base.size() + 1) + "/" + (*me)->getName()
+					: (*me)->getName(), (*me)->getTH1());
+			}
+			if (!shm_->open()) shm_.reset();
+		}
 	}
 }
 
+void LinkDQM::endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const& iSetup)
+{
+	sumCards();
+	output_.endLumi(dbe, iLumi.luminosityBlock());
+}
+
 void LinkDQM::endJob(void)
 {
 	if (verbose_)
 	LogInfo("EndJob") << "analyzed " << nev_ << " events";
 
-	if (outputFile_.size() != 0 && dbe)
-		dbe->save(outputFile_);
+	sumCards();
+	if (shm_) shm_->update();
+
+	output_.endJob(dbe);
+
+	latency_.endJob();
 
         myfile.close();
 
@@ -129,45 +196,68 @@ void LinkDQM::endJob(void)
 
 void LinkDQM::analyze(const Event & e, const EventSetup & c)
 {
+	ModuleMetrics::Timer timer(metrics_);
+	metrics_.event();
 	nev_++;
 	if (verbose_) {
 		std::cout << "LinkDQM: analyze...." << std::endl;
 	}
 
+	// publish what was accumulated so far, before any early return
+	if (shm_ && nev_ % shmUpdateEvery_ == 0) {
+		sumCards();
+		shm_->update();
+	}
+
 	// Get the RCT digis
-	edm::Handle < LinkMonitorCollection > lm;
 	edm::Handle < TimeMonitorCollection > time;
-
-	bool doLm = true;
-
-	e.getByToken(ctp7Source_LMCollection_,lm);
 	e.getByToken(ctp7Source_TCollection_,time);
 
-	if (!lm.isValid()) {
-		edm::LogInfo("DataNotFound") << "can't find LinkMonitor";
-		doLm = false;
+	// the last stamp of the capture; without one the links are not put vs time
+	const bool stamped = time.isValid() && !time->empty();
+	if (!stamped) edm::LogInfo("DataNotFound") << "can't find TimeMonitor";
+	unsigned int date = 0;
+	unsigned int clock = 0;
+	if (stamped) {
+		date = time->back().date();
+		clock = time->back().minute();
 	}
 
-        unsigned int date;
-        unsigned int clock;
-        for (TimeMonitorCollection::const_iterator t = time->begin(); t != time->end(); t++){
-                date=t->date();
-                clock=t->minute();
+	// the capture start, the indexer uses it as run/time of the capture
+	if (time.isValid()) latency_.fill(*time);
+	if (nev_ == 1) ctp7CaptureInfo_->Fill(1);
+	if (stamped && nev_ == 1) {
+		ctp7CaptureRun_->Fill(time->back().run());
+		ctp7CaptureDate_->Fill(time->back().date());
+		ctp7CaptureTime_->Fill(time->back().minute());
 	}
 
-	if ( doLm ) {
+	// every card fills its own link histograms
+	int numbadlinks =0;
+	for (unsigned int card = 0; card < cards_.size(); card++) {
+		edm::Handle < LinkMonitorCollection > lm;
+		e.getByToken(ctp7Source_LMCollection_[card],lm);
+		if (!lm.isValid()) {
+			edm::LogInfo("DataNotFound") << "can't find LinkMonitor of " << cards_.name(card);
+			continue;
+		}
+		views_.select(*this, card);
+		const std::string prefix = cards_.multi() ? cards_.name(card) + " " : "";
+
                 int i =0;
-                int numbadlinks =0;
+		const int cardbadlinks = numbadlinks;
 		for (LinkMonitorCollection::const_iterator link = lm->begin(); link != lm->end(); link++) {
 			ctp7LinkMonitor_->Fill(link->raw());
 		        if (link->raw()!=15) {
 			        ctp7LinkMonitor2D_->Fill(i,1);
 			        ctp7LinkMonitorNot15_->Fill(link->raw());
 			        ctp7LinkMonitorNot15_2D_->Fill(i,link->raw());
-				ctp7LinkMonitorVsTime_->Fill(clock,i);
-				myfile <<"Time: date: "<<date <<"; clock time: "<<clock <<std::endl;
-				myfile <<"Link "<<i<<" is not 15!"<<std::endl;
-				myfile <<"Link "<<i<<" is: "<< link->raw()<<std::endl;
+				if (stamped) {
+					ctp7LinkMonitorVsTime_->Fill(clock,i);
+					myfile <<"Time: date: "<<date <<"; clock time: "<<clock <<std::endl;
+				}
+				myfile <<prefix<<"Link "<<i<<" is not 15!"<<std::endl;
+				myfile <<prefix<<"Link "<<i<<" is: "<< link->raw()<<std::endl;
 				numbadlinks++;
                          }	
 			else{
@@ -175,6 +265,18 @@ void LinkDQM::analyze(const Event & e, const EventSetup & c)
 			}
 			i++;
 		}
+		badLinksMetric_[card].set(numbadlinks - cardbadlinks);
+		if (numbadlinks > cardbadlinks) badLinkEventsMetric_[card].inc();
 	}
+	ctp7CaptureInfo_->Fill(2);
+	if (numbadlinks > 0) ctp7CaptureInfo_->Fill(3);
 
 }
+
+void LinkDQM::sumCards()
+{
+	if (!cards_.multi()) return;
+	std::vector<unsigned int> cards;
+	for (unsigned int card = 0; card < cards_.size(); card++) cards.push_back(card);
+	views_.sum(*this, cards_.sum(), cards);
+}
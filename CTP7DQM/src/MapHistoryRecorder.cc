@@ -0,0 +1,75 @@
+/*
+ * \file MapHistoryRecorder.cc
+ *
+ * Per-lumi history of the eta-phi maps, written as a MapHistory file.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/MapHistoryRecorder.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+static const char* const DEFAULTMAPS[] = {
+  "RctRegionsEtEtaPhi", "RctRegionsOccEtaPhi",
+  "RctEmIsoEmEtEtaPhi", "RctEmIsoEmOccEtaPhi",
+  "RctEmNonIsoEmEtEtaPhi", "RctEmNonIsoEmOccEtaPhi"
+};
+
+MapHistoryRecorder::MapHistoryRecorder(const std::string& module, const TriggerRouting& routing,
+                                       const edm::ParameterSet& ps) :
+  module_(module),
+  base_(routing.base()),
+  file_(ps.getUntrackedParameter < std::string > ("file", "")),
+  history_(NETA, NPHI, ps.getUntrackedParameter < double > ("scale", 1.)),
+  contents_(NETA*NPHI, 0.)
+{
+  if (!enabled()) return;
+
+  // the maps of the shared view, "Physics/RctRegionsEtEtaPhi" with routing
+  std::string view;
+  if (routing.enabled()) view = routing.folder(routing.shared()).substr(base_.size() + 1) + "/";
+  std::vector<std::string> defaults;
+  for (unsigned int i = 0; i < sizeof(DEFAULTMAPS)/sizeof(DEFAULTMAPS[0]); i++)
+    defaults.push_back(view + DEFAULTMAPS[i]);
+
+  maps_ = ps.getUntrackedParameter < std::vector<std::string> > ("maps", defaults);
+  for (std::vector<std::string>::const_iterator m = maps_.begin(); m != maps_.end(); m++)
+    history_.addMap(*m);
+  warned_.assign(maps_.size(), false);
+}
+
+void MapHistoryRecorder::endLumi(DQMStore* dbe, unsigned int lumi)
+{
+  if (!enabled() || !dbe) return;
+
+  for (unsigned int m = 0; m < maps_.size(); m++) {
+    MonitorElement* me = dbe->get(base_ + "/" + maps_[m]);
+    if (!me || me->getNbinsX() != int(NETA) || me->getNbinsY() != int(NPHI)) {
+      if (!warned_[m])
+        edm::LogWarning(module_) << "mapHistory: " << maps_[m]
+                                 << (me ? " is not a 22x18 map" : " is not booked") << ", not recorded";
+      warned_[m] = true;
+      continue;
+    }
+    for (unsigned int ix = 0; ix < NETA; ix++)
+      for (unsigned int iy = 0; iy < NPHI; iy++)
+        contents_[ix*NPHI + iy] = me->getBinContent(ix + 1, iy + 1);
+    history_.record(m, lumi, &contents_[0]);
+  }
+}
+
+void MapHistoryRecorder::endJob()
+{
+  if (!enabled()) return;
+
+  size_t bytes = 0;
+  unsigned int frames = 0;
+  for (unsigned int m = 0; m < history_.maps(); m++) {
+    bytes += history_.bytes(m);
+    frames += history_.frames(m).size();
+  }
+  if (history_.write(file_))
+    edm::LogInfo(module_) << "mapHistory: " << frames << " map lumis in " << bytes << " bytes written to " << file_;
+  else
+    edm::LogWarning(module_) << "mapHistory: cannot write " << file_;
+}
@@ -0,0 +1,40 @@
+/*
+ * \file ModuleMetrics.cc
+ *
+ * Event, rejection and timing counters of an analyzer.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/ModuleMetrics.h"
+
+#include "CTP7Tests/LiveExport/interface/MetricsExporter.h"
+
+ModuleMetrics::ModuleMetrics(const std::string& module, const edm::ParameterSet& ps) :
+  module_(module)
+{
+  MetricsRegistry& registry = MetricsRegistry::instance();
+  events_ = registry.counter("ctp7_dqm_events_total", "Events seen by the analyzer.", module_);
+  rejectedTrigger_ = registry.counter("ctp7_dqm_rejected_events_total", "Events the analyzer did not fill.",
+                                      module_, "reason", "trigger");
+  rejectedBuffer_ = registry.counter("ctp7_dqm_rejected_events_total", "Events the analyzer did not fill.",
+                                     module_, "reason", "buffer");
+  analyze_ = registry.counter("ctp7_dqm_analyze_nanoseconds_total", "Time spent in analyze.", module_);
+
+  const edm::ParameterSet metrics = ps.getUntrackedParameter < edm::ParameterSet > ("metrics", edm::ParameterSet());
+  MetricsExporter::start(module_,
+                         metrics.getUntrackedParameter < std::string > ("socket", ""),
+                         metrics.getUntrackedParameter < std::string > ("file", ""),
+                         metrics.getUntrackedParameter < double > ("period", 10.));
+}
+
+ctp7metrics::Counter ModuleMetrics::counter(const std::string& name, const std::string& help,
+                                            const std::string& label, const std::string& value) const
+{
+  return MetricsRegistry::instance().counter(name, help, module_, label, value);
+}
+
+ctp7metrics::Gauge ModuleMetrics::gauge(const std::string& name, const std::string& help,
+                                        const std::string& label, const std::string& value) const
+{
+  return MetricsRegistry::instance().gauge(name, help, module_, label, value);
+}
@@ -0,0 +1,167 @@
+/*
+ * \file OnlineQualityTests.cc
+ *
+ * Lumi-boundary quality tests on the eta-phi maps of L1TCTP7 and RCTL1A.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/OnlineQualityTests.h"
+#include "CTP7Tests/DQMCompare/interface/HistogramShape.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+const unsigned int LUMIBINS = 500;
+const float LUMIMIN = 0.5;
+const float LUMIMAX = 500.5;
+
+OnlineQualityTests::OnlineQualityTests(const std::string& name, const std::string& referenceHisto,
+                                       const std::string& moduleFolder, const edm::ParameterSet& ps,
+                                       unsigned int firstEta, unsigned int lastEta) :
+  name_(name),
+  referenceHisto_(referenceHisto),
+  enabled_(ps.getUntrackedParameter < bool > ("enable", false)),
+  firstEta_(firstEta),
+  lastEta_(lastEta < NETA ? lastEta : NETA - 1),
+  minEvents_(ps.getUntrackedParameter < unsigned int > ("minEvents", 100)),
+  maxChi2PerNdf_(ps.getUntrackedParameter < double > ("maxChi2PerNdf", 3.)),
+  deadOccupancy_(ps.getUntrackedParameter < double > ("deadOccupancy", 0.)),
+  hotFactor_(ps.getUntrackedParameter < double > ("hotFactor", 5.)),
+  maxDead_(ps.getUntrackedParameter < unsigned int > ("maxDead", 0)),
+  maxHot_(ps.getUntrackedParameter < unsigned int > ("maxHot", 0)),
+  lumiEt_(NCELLS, 0.),
+  lumiOcc_(NCELLS, 0),
+  lumiEvents_(0),
+  referenceIntegral_(0.),
+  summary_(0),
+  verdictVsLumi_(0),
+  deadEtaPhi_(0),
+  hotEtaPhi_(0)
+{
+  std::string file = ps.getUntrackedParameter < std::string > ("referenceFile", "");
+  if (enabled_ && file.size() != 0)
+    loadReference(file, ps.getUntrackedParameter < std::string > ("referenceFolder", "DQMData/" + moduleFolder));
+}
+
+void OnlineQualityTests::loadReference(const std::string& file, const std::string& folder)
+{
+  HistogramShapeCollection shapes;
+  std::string error;
+  if (!shapeio::loadReference(file, folder, file + ".refcache", shapes, error)) {
+    edm::LogWarning("OnlineQualityTests") << "no reference for " << name_ << ": " << error;
+    return;
+  }
+  for (HistogramShapeCollection::const_iterator s = shapes.begin(); s != shapes.end(); s++) {
+    if (s->name != referenceHisto_) continue;
+    if (s->dimension != 2 || s->nbinsX != NETA || s->nbinsY != NPHI) break;
+    // drop the under/overflow cells, reorder to [ieta*NPHI + iphi]
+    reference_.assign(NCELLS, 0.);
+    for (unsigned int ieta = 0; ieta < NETA; ieta++)
+      for (unsigned int iphi = 0; iphi < NPHI; iphi++)
+        reference_[ieta*NPHI + iphi] = s->shape[(iphi + 1)*(NETA + 2) + ieta + 1];
+    referenceIntegral_ = s->integral;
+    return;
+  }
+  edm::LogWarning("OnlineQualityTests") << "no usable " << referenceHisto_ << " in " << file;
+}
+
+void OnlineQualityTests::book(DQMStore* dbe)
+{
+  if (!enabled_ || !dbe) return;
+
+  summary_ = dbe->book1D(name_ + "QualitySummary", name_ + " QUALITY (SUMS OVER LUMIS)", 7, 0.5, 7.5);
+  summary_->setBinLabel(1, "evaluated");
+  summary_->setBinLabel(2, "good");
+  summary_->setBinLabel(3, "bad");
+  summary_->setBinLabel(4, "chi2");
+  summary_->setBinLabel(5, "ndf");
+  summary_->setBinLabel(6, "dead cells");
+  summary_->setBinLabel(7, "hot cells");
+  verdictVsLumi_ = dbe->book2D(name_ + "QualityVsLumi", name_ + " QUALITY VERDICT vs LUMI",
+                               LUMIBINS, LUMIMIN, LUMIMAX, 2, -0.5, 1.5);
+  verdictVsLumi_->setBinLabel(1, "bad", 2);
+  verdictVsLumi_->setBinLabel(2, "good", 2);
+  deadEtaPhi_ = dbe->book2D(name_ + "DeadEtaPhi", name_ + " LUMIS WITH DEAD CELL",
+                            NETA, -0.5, NETA - 0.5, NPHI, -0.5, NPHI - 0.5);
+  hotEtaPhi_ = dbe->book2D(name_ + "HotEtaPhi", name_ + " LUMIS WITH HOT CELL",
+                           NETA, -0.5, NETA - 0.5, NPHI, -0.5, NPHI - 0.5);
+}
+
+void OnlineQualityTests::endLumi(unsigned int lumi)
+{
+  if (!enabled_ || !summary_) return;
+
+  // too few events: the lumi is not evaluated and nothing is filled
+  if (lumiEvents_ < minEvents_) {
+    reset();
+    return;
+  }
+
+  unsigned int nDead = 0, nHot = 0;
+
+  // mean occupancy of each eta ring
+  double ringMean[NETA];
+  for (unsigned int ieta = 0; ieta < NETA; ieta++) {
+    double sum = 0.;
+    for (unsigned int iphi = 0; iphi < NPHI; iphi++) sum += lumiOcc_[ieta*NPHI + iphi];
+    ringMean[ieta] = sum/NPHI;
+  }
+
+  double lumiIntegral = 0.;
+  for (unsigned int c = 0; c < NCELLS; c++) {
+    const unsigned int ieta = c/NPHI, iphi = c%NPHI;
+    lumiIntegral += lumiEt_[c];
+    // not reachable by this map, neither dead nor hot
+    if (ieta < firstEta_ || ieta > lastEta_) continue;
+    if (lumiOcc_[c] <= deadOccupancy_*lumiEvents_) {
+      nDead++;
+      deadEtaPhi_->Fill(ieta, iphi);
+    }
+    else if (ringMean[ieta] > 0 && lumiOcc_[c] > hotFactor_*ringMean[ieta]) {
+      nHot++;
+      hotEtaPhi_->Fill(ieta, iphi);
+    }
+  }
+
+  // two-sample chi2 between the lumi E_T map and the reference
+  double chi2 = 0.;
+  int ndf = 0;
+  if (!reference_.empty() && lumiIntegral > 0) {
+    const double n1 = lumiIntegral, n2 = referenceIntegral_;
+    int nonEmpty = 0;
+    for (unsigned int c = 0; c < NCELLS; c++) {
+      const double p = lumiEt_[c]/n1, q = reference_[c];
+      const double sum = n1*p + n2*q;
+      if (sum <= 0) continue;
+      chi2 += n1*n2*(p - q)*(p - q)/sum;
+      nonEmpty++;
+    }
+    ndf = nonEmpty - 1;
+  }
+  const double chi2PerNdf = ndf > 0 ? chi2/ndf : -1.;
+
+  const int verdict = (nDead <= maxDead_ && nHot <= maxHot_
+                       && (chi2PerNdf < 0 || chi2PerNdf <= maxChi2PerNdf_)) ? Good : Bad;
+
+  summary_->Fill(1);
+  summary_->Fill(verdict == Good ? 2 : 3);
+  if (ndf > 0) {
+    summary_->Fill(4, chi2);
+    summary_->Fill(5, ndf);
+  }
+  summary_->Fill(6, nDead);
+  summary_->Fill(7, nHot);
+  verdictVsLumi_->Fill(lumi, verdict);
+
+  if (verdict == Bad)
+    edm::LogWarning("OnlineQualityTests") << name_ << " lumi " << lumi << " failed: chi2/ndf "
+                                          << chi2PerNdf << ", " << nDead << " dead, " << nHot << " hot";
+
+  reset();
+}
+
+void OnlineQualityTests::reset()
+{
+  lumiEt_.assign(NCELLS, 0.);
+  lumiOcc_.assign(NCELLS, 0);
+  lumiEvents_ = 0;
+}
@@ -0,0 +1,330 @@
+/*
+ * \file OutputCoordinator.cc
+ *
+ * One ROOT file per outputFile of the job, written by a background thread.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/OutputCoordinator.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <sys/time.h>
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TObjString.h"
+#include "TThread.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+
+namespace {
+
+  double seconds(const timeval& start)
+  {
+    timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + 1e-6*(now.tv_usec - start.tv_usec);
+  }
+
+  // DQMData/<path>, created if needed
+  TDirectory* folder(TFile& f, const std::string& path)
+  {
+    const std::string name = "DQMData/" + path;
+    TDirectory* dir = f.GetDirectory(name.c_str());
+    if (!dir) {
+      f.mkdir(name.c_str());
+      dir = f.GetDirectory(name.c_str());
+    }
+    return dir;
+  }
+
+  // copies of the histograms of one file, owned by the writer
+  struct Snapshot {
+    std::string file;
+    int compression;
+    bool final;
+    unsigned int lumi;
+    std::vector<std::pair<std::string, TH1*> > histograms; // folder, copy
+    std::vector<std::pair<std::string, std::string> > scalars; // folder, <name>i=value</name>
+
+    ~Snapshot() {
+      for (unsigned int i = 0; i < histograms.size(); i++) delete histograms[i].second;
+    }
+  };
+
+  // the modules sharing one file
+  struct Output {
+    Output() : compression(1), every(0), written(false), ok(false) { }
+    int compression;
+    unsigned int every;
+    std::vector<const OutputCoordinator*> modules;
+    std::set<std::string> folders;
+    std::map<const OutputCoordinator*, unsigned int> lumi; // last snapshot lumi ended
+    std::set<const OutputCoordinator*> done; // reached endJob
+    bool written; // the end-of-job snapshot left the writer
+    bool ok;
+  };
+
+  class Writer {
+
+  public:
+
+    static Writer& instance() {
+      static Writer writer;
+      return writer;
+    }
+
+    ~Writer() { stop(); }
+
+    void join(const OutputCoordinator* m, const std::vector<std::string>& folders, int compression, unsigned int every);
+    void leave(const OutputCoordinator* m);
+    void endLumi(const OutputCoordinator* m, DQMStore* dbe, unsigned int lumi);
+    void endJob(const OutputCoordinator* m, DQMStore* dbe);
+
+  private:
+
+    Writer() : stop_(false) { }
+
+    // copies the folders of the file and queues them in place of a snapshot
+    // of the same file still waiting; called with the lock held
+    void queue(const std::string& file, const Output& out, DQMStore* dbe, unsigned int lumi, bool final);
+    void loop();
+    bool write(const Snapshot& s) const;
+    void stop();
+
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable written_;
+    std::map<std::string, Output> outputs_;
+    std::deque<Snapshot*> queue_;
+    std::thread thread_;
+    bool stop_;
+
+  };
+
+  void Writer::join(const OutputCoordinator* m, const std::vector<std::string>& folders,
+                    int compression, unsigned int every)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    Output& out = outputs_[m->file()];
+    if (out.modules.empty()) {
+      out.compression = compression;
+      out.every = every;
+    } else if (compression != out.compression || every != out.every) {
+      edm::LogWarning(m->module()) << m->file() << " is shared with " << out.modules.front()->module()
+        << ", written with its outputCompression " << out.compression << " and snapshotEveryLumis " << out.every;
+    }
+    out.modules.push_back(m);
+    out.folders.insert(folders.begin(), folders.end());
+
+    if (!thread_.joinable()) {
+      // thread-local gDirectory and the ROOT locks for the writer
+      TThread::Initialize();
+      stop_ = false;
+      thread_ = std::thread(&Writer::loop, this);
+    }
+  }
+
+  void Writer::leave(const OutputCoordinator* m)
+  {
+    bool last = false;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      std::map<std::string, Output>::iterator out = outputs_.find(m->file());
+      // gone once written at endJob
+      if (out == outputs_.end()) return;
+      std::vector<const OutputCoordinator*>& modules = out->second.modules;
+      modules.erase(std::remove(modules.begin(), modules.end(), m), modules.end());
+      out->second.lumi.erase(m);
+      out->second.done.erase(m);
+      if (modules.empty()) outputs_.erase(out);
+      last = outputs_.empty();
+    }
+    if (last) stop();
+  }
+
+  void Writer::endLumi(const OutputCoordinator* m, DQMStore* dbe, unsigned int lumi)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::map<std::string, Output>::iterator out = outputs_.find(m->file());
+    if (out == outputs_.end() || out->second.every == 0 || lumi % out->second.every != 0) return;
+
+    Output& o = out->second;
+    o.lumi[m] = lumi;
+    for (std::vector<const OutputCoordinator*>::const_iterator i = o.modules.begin(); i != o.modules.end(); i++)
+      if (o.lumi[*i] != lumi) return;
+    queue(out->first, o, dbe, lumi, false);
+  }
+
+  void Writer::endJob(const OutputCoordinator* m, DQMStore* dbe)
+  {
+    std::unique_lock<std::mutex> guard(lock_);
+    std::map<std::string, Output>::iterator out = outputs_.find(m->file());
+    if (out == outputs_.end()) return;
+
+    Output& o = out->second;
+    o.done.insert(m);
+    if (o.done.size() < o.modules.size()) return;
+
+    timeval start;
+    gettimeofday(&start, 0);
+    queue(out->first, o, dbe, 0, true);
+    while (!o.written) written_.wait(guard);
+
+    if (o.ok) {
+      std::string modules;
+      for (std::vector<const OutputCoordinator*>::const_iterator i = o.modules.begin(); i != o.modules.end(); i++)
+        modules += (modules.empty() ? "" : "+") + (*i)->module();
+      edm::LogInfo("SaveTime") << modules << " saved " << out->first << " in " << seconds(start) << " s";
+    }
+    outputs_.erase(out);
+    const bool last = outputs_.empty();
+    guard.unlock();
+    if (last) stop();
+  }
+
+  void Writer::queue(const std::string& file, const Output& out, DQMStore* dbe, unsigned int lumi, bool final)
+  {
+    std::unique_ptr<Snapshot> s(new Snapshot);
+    s->file = file;
+    s->compression = out.compression;
+    s->final = final;
+    s->lumi = lumi;
+
+    // a folder may also be a subfolder of another one
+    std::set<const MonitorElement*> seen;
+    for (std::set<std::string>::const_iterator f = out.folders.begin(); f != out.folders.end(); f++) {
+      std::vector<MonitorElement*> mes = dbe->getAllContents(*f);
+      for (std::vector<MonitorElement*>::const_iterator me = mes.begin(); me != mes.end(); me++) {
+        if ((*me)->kind() == MonitorElement::DQM_KIND_INVALID || !seen.insert(*me).second) continue;
+        if ((*me)->kind() < MonitorElement::DQM_KIND_TH1F) {
+          s->scalars.push_back(std::make_pair((*me)->getPathname(), (*me)->tagString()));
+          continue;
+        }
+        TH1* copy = static_cast<TH1*>((*me)->getTH1()->Clone());
+        copy->SetDirectory(0);
+        s->histograms.push_back(std::make_pair((*me)->getPathname(), copy));
+      }
+    }
+
+    for (std::deque<Snapshot*>::iterator q = queue_.begin(); q != queue_.end(); q++) {
+      if ((*q)->file != file) continue;
+      delete *q;
+      *q = s.release();
+      return;
+    }
+    queue_.push_back(s.release());
+    wake_.notify_one();
+  }
+
+  void Writer::loop()
+  {
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+      while (queue_.empty() && !stop_) wake_.wait(guard);
+      if (queue_.empty()) return;
+      std::unique_ptr<Snapshot> s(queue_.front());
+      queue_.pop_front();
+      guard.unlock();
+
+      timeval start;
+      gettimeofday(&start, 0);
+      const bool ok = write(*s);
+      if (ok && !s->final)
+        edm::LogInfo("OutputCoordinator") << "lumi " << s->lumi << " snapshot written to " << s->file
+          << " in " << seconds(start) << " s";
+      const std::string file = s->file;
+      const bool final = s->final;
+      s.reset();
+
+      guard.lock();
+      if (!final) continue;
+      std::map<std::string, Output>::iterator out = outputs_.find(file);
+      if (out != outputs_.end()) {
+        out->second.written = true;
+        out->second.ok = ok;
+      }
+      written_.notify_all();
+    }
+  }
+
+  bool Writer::write(const Snapshot& s) const
+  {
+    const std::string tmp = s.file + ".tmp";
+    TFile f(tmp.c_str(), "RECREATE", "", s.compression);
+    if (f.IsZombie()) {
+      edm::LogWarning("OutputCoordinator") << "cannot write " << tmp;
+      return false;
+    }
+
+    // the layout of DQMStore::save
+    for (std::vector<std::pair<std::string, TH1*> >::const_iterator h = s.histograms.begin(); h != s.histograms.end(); h++) {
+      TDirectory* dir = folder(f, h->first);
+      if (dir) dir->WriteTObject(h->second);
+    }
+    // int, real and string elements as TObjStrings, as DQMStore::save does
+    for (std::vector<std::pair<std::string, std::string> >::const_iterator v = s.scalars.begin(); v != s.scalars.end(); v++) {
+      TDirectory* dir = folder(f, v->first);
+      TObjString tag(v->second.c_str());
+      if (dir) dir->WriteTObject(&tag);
+    }
+    f.Close();
+
+    if (rename(tmp.c_str(), s.file.c_str()) != 0) {
+      edm::LogWarning("OutputCoordinator") << "cannot rename " << tmp << " to " << s.file;
+      return false;
+    }
+    return true;
+  }
+
+  void Writer::stop()
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+}
+
+OutputCoordinator::OutputCoordinator(const std::string& module, const edm::ParameterSet& ps) :
+  module_(module),
+  folders_(ps.getUntrackedParameter < std::vector<std::string> > ("outputFolders", std::vector<std::string>())),
+  compression_(ps.getUntrackedParameter < int > ("outputCompression", 1)),
+  snapshotEvery_(ps.getUntrackedParameter < unsigned int > ("snapshotEveryLumis", 0))
+{
+}
+
+OutputCoordinator::~OutputCoordinator()
+{
+  if (enabled()) Writer::instance().leave(this);
+}
+
+void OutputCoordinator::open(const std::string& file, const std::string& folder)
+{
+  if (file.empty() || enabled()) return;
+  file_ = file;
+  folders_.insert(folders_.begin(), folder);
+  Writer::instance().join(this, folders_, compression_, snapshotEvery_);
+}
+
+void OutputCoordinator::endLumi(DQMStore* dbe, unsigned int lumi)
+{
+  if (enabled() && dbe) Writer::instance().endLumi(this, dbe, lumi);
+}
+
+void OutputCoordinator::endJob(DQMStore* dbe)
+{
+  if (enabled() && dbe) Writer::instance().endJob(this, dbe);
+}
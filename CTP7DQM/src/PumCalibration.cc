@@ -0,0 +1,129 @@
+/*
+ * \file PumCalibration.cc
+ *
+ * Online PUM calibration table for L1TCTP7.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/PumCalibration.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+const float PUMMIN = -0.5;
+const float PUMMAX = 21.5;
+const float R10MIN = -0.5;
+const float R10MAX = 1023.5;
+
+const char PUMLUTMAGIC[8] = { 'C', 'T', 'P', '7', 'P', 'U', 'M', '1' };
+
+PumCalibration::PumCalibration(const edm::ParameterSet& ps) :
+  table_(NPUM*NETA),
+  coarseHistograms_(ps.getUntrackedParameter < bool > ("pumCoarseHistograms", false)),
+  coarseRankBins_(ps.getUntrackedParameter < unsigned int > ("pumCoarseRankBins", 64)),
+  lutFile_(ps.getUntrackedParameter < std::string > ("pumLutFile", "")),
+  coarse_(NETA, (MonitorElement*) 0),
+  lutEntries_(0),
+  lutSum_(0),
+  lutSum2_(0)
+{
+  if (coarseRankBins_ == 0) coarseRankBins_ = 1;
+}
+
+void PumCalibration::book(DQMStore* dbe)
+{
+  if (!dbe) return;
+
+  lutEntries_ = dbe->book2D("RctRegionsPumLutEntries", "PUM LUT: ENTRIES", NPUM, PUMMIN, PUMMAX,
+                            NETA, -0.5, NETA - 0.5);
+  lutSum_ = dbe->book2D("RctRegionsPumLutSum", "PUM LUT: SUM OF REGION RANKS", NPUM, PUMMIN, PUMMAX,
+                        NETA, -0.5, NETA - 0.5);
+  lutSum2_ = dbe->book2D("RctRegionsPumLutSum2", "PUM LUT: SUM OF SQUARED REGION RANKS", NPUM, PUMMIN, PUMMAX,
+                         NETA, -0.5, NETA - 0.5);
+
+  if (coarseHistograms_) {
+    for (unsigned int ieta = 0; ieta < NETA; ieta++) {
+      std::ostringstream name;
+      name << "RctRegionsPumEta" << ieta;
+      coarse_[ieta] = dbe->book2D(name.str(), " PUM BIN", NPUM, PUMMIN, PUMMAX,
+                                  coarseRankBins_, R10MIN, R10MAX);
+    }
+  }
+}
+
+unsigned int PumCalibration::pumBin(double nonZeroRegions)
+{
+  // same binning as the old Fill(nonzeroregions/PUMBINS, ...) on a -0.5..21.5 axis
+  const double x = nonZeroRegions/NPUM + 0.5;
+  if (x < 0) return 0;
+  const unsigned int bin = static_cast<unsigned int>(x);
+  return bin < NPUM ? bin : NPUM - 1;
+}
+
+double PumCalibration::rms(unsigned int pum, unsigned int ieta) const
+{
+  const Cell& c = table_[pum*NETA + ieta];
+  if (c.n < 2) return 0.;
+  const double var = (c.sum2 - c.sum*c.sum/c.n)/(c.n - 1);
+  return var > 0 ? std::sqrt(var) : 0.;
+}
+
+void PumCalibration::publish()
+{
+  // the sums of the job so far: a file holds its own, hadd adds them
+  if (!lutEntries_) return;
+  for (unsigned int pum = 0; pum < NPUM; pum++) {
+    for (unsigned int ieta = 0; ieta < NETA; ieta++) {
+      const Cell& c = table_[pum*NETA + ieta];
+      lutEntries_->setBinContent(pum + 1, ieta + 1, c.n);
+      lutSum_->setBinContent(pum + 1, ieta + 1, c.sum);
+      lutSum2_->setBinContent(pum + 1, ieta + 1, c.sum2);
+    }
+  }
+}
+
+void PumCalibration::writeLut() const
+{
+  if (lutFile_.size() == 0) return;
+  if (!writeText(lutFile_ + ".txt") || !writeBinary(lutFile_ + ".bin"))
+    edm::LogWarning("PumCalibration") << "could not write the PUM LUT to " << lutFile_ << ".txt/.bin";
+}
+
+bool PumCalibration::writeText(const std::string& file) const
+{
+  std::ofstream out(file.c_str());
+  if (!out) return false;
+  out << "# PUM calibration LUT: region rank per PUM bin (non-zero regions / 22) and gctEta" << std::endl;
+  out << "# pumBin gctEta entries mean rms" << std::endl;
+  for (unsigned int pum = 0; pum < NPUM; pum++)
+    for (unsigned int ieta = 0; ieta < NETA; ieta++)
+      out << pum << " " << ieta << " " << entries(pum, ieta) << " "
+          << mean(pum, ieta) << " " << rms(pum, ieta) << std::endl;
+  return out.good();
+}
+
+bool PumCalibration::writeBinary(const std::string& file) const
+{
+  // magic, NPUM, NETA, then entries (uint64), mean and rms (double) as
+  // [pum][eta] arrays
+  FILE* f = fopen(file.c_str(), "wb");
+  if (!f) return false;
+  const uint32_t dims[2] = { NPUM, NETA };
+  std::vector<uint64_t> n(table_.size());
+  std::vector<double> m(table_.size()), r(table_.size());
+  for (unsigned int i = 0; i < table_.size(); i++) {
+    n[i] = table_[i].n;
+    m[i] = mean(i/NETA, i%NETA);
+    r[i] = rms(i/NETA, i%NETA);
+  }
+  bool ok = fwrite(PUMLUTMAGIC, sizeof(PUMLUTMAGIC), 1, f) == 1
+    && fwrite(dims, sizeof(dims), 1, f) == 1
+    && fwrite(&n[0], sizeof(uint64_t), n.size(), f) == n.size()
+    && fwrite(&m[0], sizeof(double), m.size(), f) == m.size()
+    && fwrite(&r[0], sizeof(double), r.size(), f) == r.size();
+  return (fclose(f) == 0) && ok;
+}
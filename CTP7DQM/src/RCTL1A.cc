@@ -44,11 +44,49 @@ const unsigned int PUMBINS = 22;
 const float PUMMIN = -0.5;
 const float PUMMAX = 21.5;
 
+// everything booked per trigger-type view by bookView
+const HistogramViews<RCTL1A>::Member RCTL1A::VIEWHISTOGRAMS[] = {
+	&RCTL1A::ctp7RegionsAvgEtVsEta_, &RCTL1A::ctp7RegionsEtEtaPhi_, &RCTL1A::ctp7RegionsOccEtaPhi_,
+	&RCTL1A::ctp7IsoEmEtEtaPhi_, &RCTL1A::ctp7IsoEmOccEtaPhi_,
+	&RCTL1A::ctp7NonIsoEmEtEtaPhi_, &RCTL1A::ctp7NonIsoEmOccEtaPhi_,
+	&RCTL1A::ctp7RegionRank_, &RCTL1A::ctp7IsoEmRank_, &RCTL1A::ctp7NonIsoEmRank_,
+	&RCTL1A::ctp7RegionBx_, &RCTL1A::ctp7EmBx_,
+	&RCTL1A::ctp7RegionsEtEtaPhiBx_, &RCTL1A::ctp7RegionsOccEtaPhiBx_,
+	&RCTL1A::ctp7IsoEmEtEtaPhiBx_, &RCTL1A::ctp7NonIsoEmEtEtaPhiBx_,
+	&RCTL1A::ctp7RegionRankBx_, &RCTL1A::ctp7EmRankBx_,
+	&RCTL1A::ctp7RegionBxEt_, &RCTL1A::ctp7EmBxEt_
+};
+
 RCTL1A::RCTL1A(const ParameterSet & ps) :
-	ctp7Source_L1CRCollection_( consumes<L1CaloRegionCollection>(ps.getParameter< InputTag >("ctp7Source") )),
-	ctp7Source_L1CEMCollection_( consumes<L1CaloEmCollection>(ps.getParameter< InputTag >("ctp7Source") )),
-	filterTriggerType_ (ps.getParameter< int >("filterTriggerType"))
+	cards_ ("RCTL1A", ps),
+	ctp7Source_TCollection_( consumes<TimeMonitorCollection>(cards_.source(0)) ),
+	filterTriggerType_ (ps.getParameter< int >("filterTriggerType")),
+	nBx_ (ps.getUntrackedParameter< int >("nBx", 5)),
+	centralBx_ (ps.getUntrackedParameter< int >("centralBx", 2)),
+	routing_ ("RCTL1A", "L1T/RCTL1A", ps.getUntrackedParameter< ParameterSet >("triggerRouting", ParameterSet())),
+	views_ (VIEWHISTOGRAMS, sizeof(VIEWHISTOGRAMS)/sizeof(VIEWHISTOGRAMS[0])),
+	regionQuality_ ("RctRegions", "RctRegionsEtEtaPhi", routing_.base(),
+			ps.getUntrackedParameter< ParameterSet >("qualityTests", ParameterSet())),
+	isoEmQuality_ ("RctEmIsoEm", "RctEmIsoEmEtEtaPhi", routing_.base(),
+			ps.getUntrackedParameter< ParameterSet >("emQualityTests",
+			    ps.getUntrackedParameter< ParameterSet >("qualityTests", ParameterSet())),
+			OnlineQualityTests::FIRST_EM_ETA, OnlineQualityTests::LAST_EM_ETA),
+	budget_ ("RCTL1A", ps.getUntrackedParameter< ParameterSet >("memoryBudget", ParameterSet())),
+	latency_ ("RCTL1A", ps),
+	bufferCheck_ ("RCTL1A", ps),
+	emKernel_ (ps.getUntrackedParameter< unsigned int >("emTopN", 4)),
+	mapHistory_ ("RCTL1A", routing_, ps.getUntrackedParameter< ParameterSet >("mapHistory", ParameterSet())),
+	output_ ("RCTL1A", ps),
+	metrics_ ("RCTL1A", ps)
 {
+	// regions and EM of every card, decoded once by RegionSummaryProducer
+	const InputTag regionSummary = ps.getUntrackedParameter< InputTag >("regionSummary", InputTag("regionSummary"));
+	for (unsigned int card = 0; card < cards_.size(); card++)
+		regionSummaries_.push_back(consumes<RegionSummary>(cards_.summary(regionSummary, card)));
+
+	if (nBx_ < 1) nBx_ = 1;
+	const unsigned int views = routing_.size()*cards_.views();
+	views_.resize(views);
 
 	// verbosity switch
 	verbose_ = ps.getUntrackedParameter < bool > ("verbose", false);
@@ -76,12 +114,21 @@ RCTL1A::RCTL1A(const ParameterSet & ps) :
 	if (disable) {
 		outputFile_ = "";
 	}
+	if (dbe != NULL) output_.open(outputFile_, routing_.base());
 
 
 	if (dbe != NULL) {
 		dbe->setCurrentFolder("L1T/RCTL1A");
 	}
 
+	// optional live mirror of the histograms in shared memory
+	shmSegment_ = ps.getUntrackedParameter < std::string > ("shmSegment", "");
+	shmUpdateEvery_ = ps.getUntrackedParameter < unsigned int > ("shmUpdateEvery", 50);
+	if (shmUpdateEvery_ == 0) shmUpdateEvery_ = 1;
+
+	if (routing_.enabled() && filterTriggerType_ >= 0)
+		edm::LogWarning("RCTL1A") << "triggerRouting is set, filterTriggerType is ignored";
+
 
 }
 
@@ -107,47 +154,113 @@ void RCTL1A::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
 
 		triggerType_ =
 			dbe->book1D("TriggerType", "TriggerType", 17, -0.5, 16.5);
-		// global regions
-		ctp7RegionsAvgEtVsEta_ =
-			dbe->book2D("RctRegionsAvgEtVsEta", " AVERAGE REGION RANK vs ETA", ETABINS, ETAMIN, ETAMAX, R10BINS, R10MIN, R10MAX);
-
-		// global regions
-		ctp7RegionsEtEtaPhi_ =
-			dbe->book2D("RctRegionsEtEtaPhi", "REGION E_{T}", ETABINS, ETAMIN,
-					ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-		ctp7RegionsOccEtaPhi_ =
-			dbe->book2D("RctRegionsOccEtaPhi", "REGION OCCUPANCY", ETABINS,
-					ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-		ctp7IsoEmEtEtaPhi_ =
-			dbe->book2D("RctEmIsoEmEtEtaPhi", "ISO EM E_{T}", ETABINS, ETAMIN,
-					ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-		ctp7IsoEmOccEtaPhi_ =
-			dbe->book2D("RctEmIsoEmOccEtaPhi", "ISO EM OCCUPANCY", ETABINS,
-					ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-		ctp7NonIsoEmEtEtaPhi_ =
-			dbe->book2D("RctEmNonIsoEmEtEtaPhi", "NON-ISO EM E_{T}", ETABINS,
-					ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-		ctp7NonIsoEmOccEtaPhi_ =
-			dbe->book2D("RctEmNonIsoEmOccEtaPhi", "NON-ISO EM OCCUPANCY",
-					ETABINS, ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
-
-		// Region rank histos
-		ctp7RegionRank_ =
-			dbe->book1D("RctRegionRank", "REGION RANK", R10BINS, R10MIN,
-					R10MAX);
-		//EM Rank
-		ctp7IsoEmRank_ =
-			dbe->book1D("RctEmIsoEmRank", "ISO EM RANK", R6BINS, R6MIN, R6MAX);
-		ctp7NonIsoEmRank_ =
-			dbe->book1D("RctEmNonIsoEmRank", "NON-ISO EM RANK", R6BINS, R6MIN,
-					R6MAX);
-		// bx histos
+		// the views, in the subfolders with triggerRouting and per card
+		for (unsigned int v = 0; v < routing_.size()*cards_.views(); v++) {
+			views_.select(*this, v);
+			bookView(dbe, cards_.folder(routing_.base(), routing_.folder(v % routing_.size()), v / routing_.size()));
+		}
+		selectView(view(0, routing_.shared()));
+		dbe->setCurrentFolder("L1T/RCTL1A");
+
+		// quality summaries, filled at the lumi boundaries
+		regionQuality_.book(dbe);
+		isoEmQuality_.book(dbe);
+		latency_.book(dbe);
+		bufferCheck_.book(dbe);
+		emKernel_.book(dbe);
+
+		budget_.audit(dbe, routing_.base());
+
+		if (shmSegment_.size() != 0) {
+			shm_.reset(new ShmHistogramWriter(shmSegment_, "RCTL1A"));
+			std::vector<MonitorElement*> mes = dbe->getAllContents(routing_.base());
+			for (std::vector<MonitorElement*>::const_iterator me = mes.begin(); me != mes.end(); me++)
+				shm_->add(routing_.relativeName(*me), (*me)->getTH1());
+			if (!shm_->open()) shm_.reset();
+		}
+	}
+}
+
+void RCTL1A::bookView(DQMStore* dbe, const std::string& folder)
+{
+	dbe->setCurrentFolder(folder);
+
+	// global regions
+	ctp7RegionsAvgEtVsEta_ =
+		dbe->book2D("RctRegionsAvgEtVsEta", " AVERAGE REGION RANK vs ETA", ETABINS, ETAMIN, ETAMAX, R10BINS, R10MIN, R10MAX);
+
+	// global regions
+	ctp7RegionsEtEtaPhi_ =
+		dbe->book2D("RctRegionsEtEtaPhi", "REGION E_{T}", ETABINS, ETAMIN,
+				ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+	ctp7RegionsOccEtaPhi_ =
+		dbe->book2D("RctRegionsOccEtaPhi", "REGION OCCUPANCY", ETABINS,
+				ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+	ctp7IsoEmEtEtaPhi_ =
+		dbe->book2D("RctEmIsoEmEtEtaPhi", "ISO EM E_{T}", ETABINS, ETAMIN,
+				ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+	ctp7IsoEmOccEtaPhi_ =
+		dbe->book2D("RctEmIsoEmOccEtaPhi", "ISO EM OCCUPANCY", ETABINS,
+				ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+	ctp7NonIsoEmEtEtaPhi_ =
+		dbe->book2D("RctEmNonIsoEmEtEtaPhi", "NON-ISO EM E_{T}", ETABINS,
+				ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+	ctp7NonIsoEmOccEtaPhi_ =
+		dbe->book2D("RctEmNonIsoEmOccEtaPhi", "NON-ISO EM OCCUPANCY",
+				ETABINS, ETAMIN, ETAMAX, PHIBINS, PHIMIN, PHIMAX);
+
+	// Region rank histos
+	ctp7RegionRank_ =
+		dbe->book1D("RctRegionRank", "REGION RANK", R10BINS, R10MIN,
+				R10MAX);
+	//EM Rank
+	ctp7IsoEmRank_ =
+		dbe->book1D("RctEmIsoEmRank", "ISO EM RANK", R6BINS, R6MIN, R6MAX);
+	ctp7NonIsoEmRank_ =
+		dbe->book1D("RctEmNonIsoEmRank", "NON-ISO EM RANK", R6BINS, R6MIN,
+				R6MAX);
+	// bx histos
 //		ctp7RegionBx_ = dbe->book1D("RctRegionBx", "Region BX", 5, 0, 5);
 //		ctp7EmBx_ = dbe->book1D("RctEmBx", "EM BX", 5, 0, 5);
                 ctp7RegionBx_ = dbe->book1D("RctRegionBx", "Region BX", 5, -2.5, 2.5);
                 ctp7EmBx_ = dbe->book1D("RctEmBx", "EM BX", 5, -2.5, 2.5);
 
-	}
+	// BX-resolved maps, one eta block of ETABINS per BX
+	const float bxmin = -nBx_/2 - 0.5;
+	const float bxmax = bxmin + nBx_;
+	ctp7RegionsEtEtaPhiBx_ =
+		dbe->book2D("RctRegionsEtEtaPhiBx", "REGION E_{T} PER BX", nBx_*ETABINS, ETAMIN,
+				ETAMIN + nBx_*ETABINS, PHIBINS, PHIMIN, PHIMAX);
+	ctp7RegionsOccEtaPhiBx_ =
+		dbe->book2D("RctRegionsOccEtaPhiBx", "REGION OCCUPANCY PER BX", nBx_*ETABINS, ETAMIN,
+				ETAMIN + nBx_*ETABINS, PHIBINS, PHIMIN, PHIMAX);
+	ctp7IsoEmEtEtaPhiBx_ =
+		dbe->book2D("RctEmIsoEmEtEtaPhiBx", "ISO EM E_{T} PER BX", nBx_*ETABINS, ETAMIN,
+				ETAMIN + nBx_*ETABINS, PHIBINS, PHIMIN, PHIMAX);
+	ctp7NonIsoEmEtEtaPhiBx_ =
+		dbe->book2D("RctEmNonIsoEmEtEtaPhiBx", "NON-ISO EM E_{T} PER BX", nBx_*ETABINS, ETAMIN,
+				ETAMIN + nBx_*ETABINS, PHIBINS, PHIMIN, PHIMAX);
+	ctp7RegionRankBx_ =
+		dbe->book2D("RctRegionRankBx", "REGION RANK PER BX", R10BINS, R10MIN, R10MAX,
+				nBx_, bxmin, bxmax);
+	ctp7EmRankBx_ =
+		dbe->book2D("RctEmRankBx", "EM RANK PER BX", R6BINS, R6MIN, R6MAX,
+				nBx_, bxmin, bxmax);
+	// sums, so that hadd of the captures adds them; fastplotter.C divides
+	// by the central BX
+	ctp7RegionBxEt_ =
+		dbe->book1D("RctRegionBxEt", "REGION E_{T} PER BX", nBx_, bxmin, bxmax);
+	ctp7EmBxEt_ =
+		dbe->book1D("RctEmBxEt", "EM E_{T} PER BX", nBx_, bxmin, bxmax);
+}
+
+void RCTL1A::endLuminosityBlock(edm::LuminosityBlock const& iLumi, edm::EventSetup const& iSetup)
+{
+	regionQuality_.endLumi(iLumi.luminosityBlock());
+	isoEmQuality_.endLumi(iLumi.luminosityBlock());
+	sumCards();
+	mapHistory_.endLumi(dbe, iLumi.luminosityBlock());
+	output_.endLumi(dbe, iLumi.luminosityBlock());
 }
 
 void RCTL1A::endJob(void)
@@ -156,19 +269,39 @@ void RCTL1A::endJob(void)
 		std::cout << "RCTL1A: end job...." << std::endl;
 	LogInfo("EndJob") << "analyzed " << nev_ << " events";
 
-	if (outputFile_.size() != 0 && dbe)
-		dbe->save(outputFile_);
+	sumCards();
+	if (shm_) shm_->update();
+
+	output_.endJob(dbe);
+
+	latency_.endJob();
+	bufferCheck_.endJob();
+	mapHistory_.endJob();
 
 	return;
 }
 
 void RCTL1A::analyze(const Event & e, const EventSetup & c)
 {
+	ModuleMetrics::Timer timer(metrics_);
+	metrics_.event();
 	nev_++;
 	if (verbose_) {
 		std::cout << "RCTL1A: analyze...." << std::endl;
 	}
 
+	// publish what was accumulated so far, before any early return
+	if (shm_ && nev_ % shmUpdateEvery_ == 0) {
+		sumCards();
+		shm_->update();
+	}
+
+	// a corrupted capture fills nothing but RctBufferCheck
+	if (bufferCheck_.reject()) {
+		metrics_.rejectedBuffer();
+		return;
+	}
+
 	// fill a histogram with the trigger type, for normalization fill also last bin
 	// ErrorTrigger + 1
 	double triggerType = static_cast<double> (e.experimentType()) + 0.001;
@@ -177,8 +310,21 @@ void RCTL1A::analyze(const Event & e, const EventSetup & c)
 	triggerType_->Fill(triggerType);
 	triggerType_->Fill(triggerTypeLast + 1);
 
+	// with triggerRouting, each trigger type fills its own view; simulated
+	// events have no trigger type and go to the shared one
+	unsigned int route = routing_.shared();
+	if (routing_.enabled()) {
+		if (e.isRealData()) {
+			const int r = routing_.route(e.experimentType());
+			if (r < 0) {
+				metrics_.rejectedTrigger();
+				return;
+			}
+			route = r;
+		}
+	}
 	// filter only if trigger type is greater than 0, negative values disable filtering
-	if (filterTriggerType_ >= 0) {
+	else if (filterTriggerType_ >= 0) {
 
 		// now filter, for real data only
 		if (e.isRealData()) {
@@ -186,6 +332,7 @@ void RCTL1A::analyze(const Event & e, const EventSetup & c)
 
 				edm::LogInfo("RCTL1A") << "\n Event of TriggerType "
 					<< e.experimentType() << " rejected" << std::endl;
+				metrics_.rejectedTrigger();
 				return;
 
 			}
@@ -193,80 +340,140 @@ void RCTL1A::analyze(const Event & e, const EventSetup & c)
 
 	}
 
-	// Get the RCT digis
-	edm::Handle < L1CaloEmCollection > em;
-	edm::Handle < L1CaloRegionCollection > rgn;
+	// quality tests and per-crate EM ranks are not split
+	const bool shared = route == routing_.shared();
+	if (shared) {
+		regionQuality_.countEvent();
+		isoEmQuality_.countEvent();
+	}
 
+	edm::Handle < TimeMonitorCollection > time;
+	e.getByToken(ctp7Source_TCollection_,time);
+	if (time.isValid()) latency_.fill(*time);
+
+	// every card fills its own view, the monitors that are not split
+	// follow the first card
+	for (unsigned int card = 0; card < cards_.size(); card++) {
+		// regions and EM of the card, decoded once for all the modules
+		edm::Handle < RegionSummary > summary;
+		e.getByToken(regionSummaries_[card],summary);
+		selectView(view(card, route));
+		fillCard(summary.isValid() ? summary.product() : 0, shared && card == 0);
+	}
+}
+
+void RCTL1A::fillCard(const RegionSummary* summary, bool shared)
+{
 	bool doEm = true;
 	bool doHd = true;
 
-	e.getByToken(ctp7Source_L1CRCollection_,rgn);
-
-	if (!rgn.isValid()) {
+	if (!summary || !summary->hasRegions()) {
 		edm::LogInfo("DataNotFound") << "can't find L1CaloRegionCollection";
 		doHd = false;
 	}
 
 	if ( doHd ) {
-		// Fill the RCT histograms
-		int nonzeroregions = 0;
-		int totalregionet = 0;
-		int maxregionet = 0;
-
-		// Regions
-		for (L1CaloRegionCollection::const_iterator ireg = rgn->begin();
-				ireg != rgn->end(); ireg++) {
-			ctp7RegionsAvgEtVsEta_->Fill(ireg->gctEta(),ireg->et());
-			if(ireg->et()>0)
-			{
-				nonzeroregions++;
-				totalregionet += ireg->et();
-				if(ireg->et()>maxregionet) maxregionet=ireg->et();        
-
-				ctp7RegionRank_->Fill(ireg->et());
-				if(ireg->et()>5){
-					ctp7RegionsOccEtaPhi_->Fill(ireg->gctEta(), ireg->gctPhi());
-				}
-				ctp7RegionsEtEtaPhi_->Fill(ireg->gctEta(), ireg->gctPhi(), ireg->et());
-
-				ctp7RegionBx_->Fill(ireg->bx()-2);  // -2 to have it centered in 0
+		const RegionSummary& rs = *summary;
+
+		// all regions, zeros included
+		for (unsigned int i = 0; i < rs.size(); i++)
+			if (rs.present(i)) ctp7RegionsAvgEtVsEta_->Fill(rs.gctEta(i),rs.et(i));
+
+		// non-zero regions
+		for (std::vector<uint16_t>::const_iterator i = rs.nonZeroIndex_.begin();
+				i != rs.nonZeroIndex_.end(); i++) {
+			const int et = rs.et(*i);
+			const int eta = rs.gctEta(*i);
+			const int phi = rs.gctPhi(*i);
+
+			ctp7RegionRank_->Fill(et);
+			if(et>5){
+				ctp7RegionsOccEtaPhi_->Fill(eta, phi);
+			}
+			ctp7RegionsEtEtaPhi_->Fill(eta, phi, et);
+			if (shared) regionQuality_.fill(eta, phi, et);
+
+			ctp7RegionBx_->Fill(rs.bx(*i)-2);  // -2 to have it centered in 0
+
+			int ibx = bxIndex(rs.bx(*i));
+			if (ibx >= 0) {
+				const int x = ibx*ETABINS + eta;
+				ctp7RegionsEtEtaPhiBx_->Fill(x, phi, et);
+				if (et>5) ctp7RegionsOccEtaPhiBx_->Fill(x, phi);
+				ctp7RegionRankBx_->Fill(et, ibx - nBx_/2);
+				ctp7RegionBxEt_->Fill(ibx - nBx_/2, et);
 			}
 		}//end region loop
 	}//end doHd
 
 
-	e.getByToken(ctp7Source_L1CEMCollection_,em);
-
-	if (!em.isValid()) {
+	if (!summary || !summary->hasEm()) {
 		edm::LogInfo("DataNotFound") << "can't find L1CaloEmCollection";
 		doEm = false;
 	}
 	if ( ! doEm ) return;
+	// partition and sum the candidates once
+	emKernel_.process(*summary);
+	const std::vector<EmKernel::Candidate>& cands = emKernel_.candidates();
+
 	// Isolated and non-isolated EM
-	for (L1CaloEmCollection::const_iterator iem = em->begin();
-			iem != em->end(); iem++) {
-		if (iem->rank()>0){
-			ctp7EmBx_->Fill(iem->bx()-2); // -2 to have it centered in 0
-			if (iem->isolated()){
-				ctp7IsoEmRank_->Fill(iem->rank());
-				ctp7IsoEmEtEtaPhi_->Fill(iem->regionId().ieta(),
-						iem->regionId().iphi(), iem->rank());
-
-				if (iem->rank()>10){
-					ctp7IsoEmOccEtaPhi_->Fill(iem->regionId().ieta(),
-							iem->regionId().iphi());
-				}
-			}
-			else{
-				ctp7NonIsoEmRank_->Fill(iem->rank());
-				ctp7NonIsoEmEtEtaPhi_->Fill(iem->regionId().ieta(),
-						iem->regionId().iphi(), iem->rank());
-				if (iem->rank()>10){
-					ctp7NonIsoEmOccEtaPhi_->Fill(iem->regionId().ieta(),
-							iem->regionId().iphi());
-				}
-			} 
+	for (std::vector<EmKernel::Candidate>::const_iterator c = cands.begin(); c != cands.end(); c++) {
+		ctp7EmBx_->Fill(c->bx-2); // -2 to have it centered in 0
+
+		int ibx = bxIndex(c->bx);
+		if (ibx >= 0) {
+			const int x = ibx*ETABINS + c->ieta;
+			if (c->iso)
+				ctp7IsoEmEtEtaPhiBx_->Fill(x, c->iphi, c->rank);
+			else
+				ctp7NonIsoEmEtEtaPhiBx_->Fill(x, c->iphi, c->rank);
+			ctp7EmRankBx_->Fill(c->rank, ibx - nBx_/2);
+			ctp7EmBxEt_->Fill(ibx - nBx_/2, c->rank);
+		}
+		if (c->iso){
+			ctp7IsoEmRank_->Fill(c->rank);
+			if (shared) isoEmQuality_.fill(c->ieta, c->iphi, c->rank);
+			if (c->rank>10)
+				ctp7IsoEmOccEtaPhi_->Fill(c->ieta, c->iphi);
+		}
+		else{
+			ctp7NonIsoEmRank_->Fill(c->rank);
+			if (c->rank>10)
+				ctp7NonIsoEmOccEtaPhi_->Fill(c->ieta, c->iphi);
 		}
 	}
 
+	// one fill per touched cell with the summed rank
+	for (unsigned int iso = 0; iso < 2; iso++) {
+		MonitorElement* map = iso ? ctp7IsoEmEtEtaPhi_ : ctp7NonIsoEmEtEtaPhi_;
+		for (std::vector<uint16_t>::const_iterator cell = emKernel_.touched(iso).begin();
+				cell != emKernel_.touched(iso).end(); cell++)
+			map->Fill(*cell / EmKernel::NPHI, *cell % EmKernel::NPHI, emKernel_.cellEt(iso, *cell));
+	}
+
+	if (shared) emKernel_.fillSummary();
+}
+
+void RCTL1A::selectView(unsigned int view)
+{
+	views_.select(*this, view);
+}
+
+void RCTL1A::sumCards()
+{
+	if (!cards_.multi()) return;
+	const unsigned int current = views_.current();
+	for (unsigned int r = 0; r < routing_.size(); r++) {
+		const unsigned int total = view(cards_.sum(), r);
+		std::vector<unsigned int> cards;
+		for (unsigned int card = 0; card < cards_.size(); card++) cards.push_back(view(card, r));
+		views_.sum(*this, total, cards);
+	}
+	selectView(current);
+}
+
+int RCTL1A::bxIndex(int bx) const
+{
+	int i = bx - centralBx_ + nBx_/2;
+	return (i >= 0 && i < nBx_) ? i : -1;
 }
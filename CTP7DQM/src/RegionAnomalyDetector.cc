@@ -0,0 +1,128 @@
+/*
+ * \file RegionAnomalyDetector.cc
+ *
+ * Per-region hot/dead/stuck detection for L1TCTP7.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/RegionAnomalyDetector.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+const unsigned int EVBINS = 4000;
+const float EVMIN = -0.5;
+const float EVMAX = 3999.5;
+
+RegionAnomalyDetector::RegionAnomalyDetector(const edm::ParameterSet& ps) :
+  enabled_(ps.getUntrackedParameter < bool > ("enable", false)),
+  centralBx_(ps.getUntrackedParameter < int > ("centralBx", -1)),
+  alpha_(ps.getUntrackedParameter < double > ("alpha", 0.01)),
+  checkEvery_(ps.getUntrackedParameter < unsigned int > ("checkEvery", 100)),
+  minEvents_(ps.getUntrackedParameter < unsigned int > ("minEvents", 200)),
+  hotFactor_(ps.getUntrackedParameter < double > ("hotFactor", 5.)),
+  deadFactor_(ps.getUntrackedParameter < double > ("deadFactor", 0.1)),
+  minRingOccupancy_(ps.getUntrackedParameter < double > ("minRingOccupancy", 0.05)),
+  stuckRms_(ps.getUntrackedParameter < double > ("stuckRms", 0.5)),
+  nEvents_(0),
+  anomalyEtaPhi_(0),
+  anomaliesVsEvt_(0)
+{
+  if (checkEvery_ == 0) checkEvery_ = 1;
+  memset(et_, 0, sizeof(et_));
+  memset(occ_, 0, sizeof(occ_));
+  memset(meanEt_, 0, sizeof(meanEt_));
+  memset(meanEt2_, 0, sizeof(meanEt2_));
+  memset(state_, None, sizeof(state_));
+}
+
+void RegionAnomalyDetector::book(DQMStore* dbe)
+{
+  if (!enabled_ || !dbe) return;
+
+  anomalyEtaPhi_ = dbe->book2D("RctRegionsAnomalyEtaPhi", "REGIONS DEAD (1) / HOT (2) / STUCK (3)",
+                               NETA, -0.5, NETA - 0.5, NPHI, -0.5, NPHI - 0.5);
+  anomaliesVsEvt_ = dbe->book1D("RctRegionsAnomaliesVsEvt", "FLAGGED REGIONS vs EVT",
+                                EVBINS, EVMIN, EVMAX);
+}
+
+void RegionAnomalyDetector::endEvent(unsigned int event)
+{
+  if (!enabled_) return;
+
+  // the first 1/alpha events use the plain running mean so the averages
+  // do not start biased towards zero
+  nEvents_++;
+  const float a = nEvents_*alpha_ < 1.f ? 1.f/nEvents_ : alpha_;
+
+  float* __restrict__ et = et_;
+  float* __restrict__ occ = occ_;
+  float* __restrict__ m1 = meanEt_;
+  float* __restrict__ m2 = meanEt2_;
+  for (unsigned int c = 0; c < NPAD; c++) {
+    const float x = et[c];
+    const float hit = x > 0.f ? 1.f : 0.f;
+    occ[c] += a*(hit - occ[c]);
+    m1[c] += a*(x - m1[c]);
+    m2[c] += a*(x*x - m2[c]);
+    et[c] = 0.f;
+  }
+
+  if (nEvents_ >= minEvents_ && nEvents_ % checkEvery_ == 0) evaluate(event);
+}
+
+void RegionAnomalyDetector::evaluate(unsigned int event)
+{
+  flagged_.clear();
+  unsigned int changed = 0;
+
+  for (unsigned int ieta = 0; ieta < NETA; ieta++) {
+    const unsigned int first = ieta*NPHI;
+    float ringOcc = 0.f, ringEt = 0.f;
+    for (unsigned int iphi = 0; iphi < NPHI; iphi++) {
+      ringOcc += occ_[first + iphi];
+      ringEt += meanEt_[first + iphi];
+    }
+
+    for (unsigned int iphi = 0; iphi < NPHI; iphi++) {
+      const unsigned int c = first + iphi;
+      // compare with the rest of the ring
+      const float otherOcc = (ringOcc - occ_[c])/(NPHI - 1);
+      const float otherEt = (ringEt - meanEt_[c])/(NPHI - 1);
+      const float var = meanEt2_[c] - meanEt_[c]*meanEt_[c];
+
+      Flag flag = None;
+      if (otherOcc >= minRingOccupancy_ && occ_[c] < deadFactor_*otherOcc)
+        flag = Dead;
+      else if (occ_[c] > 0.999f && meanEt_[c] > 0.f && var < stuckRms_*stuckRms_)
+        flag = Stuck;
+      else if ((otherOcc > 0.f && occ_[c] > hotFactor_*otherOcc && occ_[c] >= minRingOccupancy_)
+               || (otherEt > 0.f && meanEt_[c] > hotFactor_*otherEt))
+        flag = Hot;
+
+      if (flag != None) {
+        Anomaly an = { ieta, iphi, flag, occ_[c], meanEt_[c] };
+        flagged_.push_back(an);
+      }
+      if (flag != state_[c]) {
+        changed++;
+        state_[c] = flag;
+        if (anomalyEtaPhi_) anomalyEtaPhi_->setBinContent(ieta + 1, iphi + 1, flag);
+      }
+    }
+  }
+
+  if (anomaliesVsEvt_) anomaliesVsEvt_->setBinContent(anomaliesVsEvt_->getTH1()->GetXaxis()->FindFixBin(event),
+                                                      flagged_.size());
+
+  if (changed != 0) {
+    static const char* names[] = { "ok", "dead", "hot", "stuck" };
+    edm::LogWarning log("RegionAnomalyDetector");
+    log << flagged_.size() << " flagged regions at event " << event << ":";
+    for (std::vector<Anomaly>::const_iterator an = flagged_.begin(); an != flagged_.end(); an++)
+      log << " (" << an->ieta << "," << an->iphi << ") " << names[an->flag]
+          << " occ " << an->occupancy << " et " << an->meanEt << ";";
+  }
+}
@@ -10,3 +10,6 @@ DEFINE_FWK_MODULE(LinkDQM);
 
 #include <CTP7Tests/CTP7DQM/interface/RCTL1A.h>
 DEFINE_FWK_MODULE(RCTL1A);
+
+#include <CTP7Tests/CTP7DQM/interface/BxAlignment.h>
+DEFINE_FWK_MODULE(BxAlignment);
@@ -0,0 +1,62 @@
+/*
+ * \file TriggerRouting.cc
+ *
+ * Dispatch of the events to one histogram view per trigger type.
+ *
+ */
+
+#include "CTP7Tests/CTP7DQM/interface/TriggerRouting.h"
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+// EventAuxiliary::PhysicsTrigger
+const int PHYSICSTRIGGER = 1;
+
+TriggerRouting::TriggerRouting(const std::string& module, const std::string& folder,
+                               const edm::ParameterSet& ps) :
+  base_(folder),
+  shared_(0)
+{
+  for (int t = 0; t < NTYPES; t++) table_[t] = -1;
+
+  std::vector<std::string> names = ps.getParameterNamesForType< std::vector<int> >(false);
+  for (std::vector<std::string>::const_iterator name = names.begin(); name != names.end(); name++) {
+    const int route = names_.size();
+    std::vector<int> types = ps.getUntrackedParameter< std::vector<int> >(*name);
+    bool used = false;
+    for (std::vector<int>::const_iterator t = types.begin(); t != types.end(); t++) {
+      if (*t < 0 || *t >= NTYPES) {
+        edm::LogWarning(module) << "triggerRouting " << *name << ": trigger type " << *t << " ignored";
+        continue;
+      }
+      if (table_[*t] >= 0) {
+        edm::LogWarning(module) << "triggerRouting " << *name << ": trigger type " << *t
+                                << " already routed to " << names_[table_[*t]];
+        continue;
+      }
+      table_[*t] = route;
+      used = true;
+    }
+    if (!used) continue;
+    names_.push_back(*name);
+    folders_.push_back(base_ + "/" + *name);
+  }
+
+  if (!enabled()) {
+    folders_.push_back(base_);
+    return;
+  }
+  if (table_[PHYSICSTRIGGER] >= 0) shared_ = table_[PHYSICSTRIGGER];
+
+  std::string routes;
+  for (unsigned int r = 0; r < names_.size(); r++) routes += " " + names_[r];
+  edm::LogInfo(module) << "trigger routing to" << routes << ", shared monitors follow " << names_[shared_];
+}
+
+std::string TriggerRouting::relativeName(const MonitorElement* me) const
+{
+  const std::string& path = me->getPathname();
+  if (path.size() > base_.size() && path.compare(0, base_.size(), base_) == 0 && path[base_.size()] == '/')
+    return path.substr(base_.size() + 1) + "/" + me->getName();
+  return me->getName();
+}
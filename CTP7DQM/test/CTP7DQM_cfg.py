@@ -37,6 +37,19 @@ process.l1tctp7 = cms.EDAnalyzer("L1TCTP7",
     DQMStore = cms.untracked.bool(True),
     disableROOToutput = cms.untracked.bool(False),
     outputFile = cms.untracked.string('./CTP7DQM.root'),
+    pumLutFile = cms.untracked.string('pumLut'),
+    eventSummaryFile = cms.untracked.string('CTP7Events.col'),
+    anomalyDetector = cms.untracked.PSet(
+        enable = cms.untracked.bool(True),
+        checkEvery = cms.untracked.uint32(100)
+    ),
+    memoryBudget = cms.untracked.PSet(
+        maxMegabytes = cms.untracked.double(512.),
+        action = cms.untracked.string('coarsen')
+    ),
+    mapHistory = cms.untracked.PSet(
+        file = cms.untracked.string('./CTP7DQM_maps.bin')
+    ),
     ctp7Source = cms.InputTag("ctp7ToDigi"),
     verbose = cms.untracked.bool(False),
     filterTriggerType  = cms.int32(-1)
@@ -51,10 +64,13 @@ process.ctp7link = cms.EDAnalyzer("LinkDQM",
 )
 
 
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+
 #This creates DQM-compatible plots
 #process.p = cms.Path(process.l1tctp7+process.dqmSaver)
 #process.p = cms.Path(process.ctp7link+process.dqmSaver)
-process.p = cms.Path(process.ctp7link+filter_step+process.l1tctp7+process.dqmSaver)
+process.p = cms.Path(process.ctp7link+filter_step+process.regionSummary+process.l1tctp7+process.dqmSaver)
 
 
 # For faster debugging & extra couts we can also work with a standard analyzer
@@ -47,6 +47,7 @@ process.l1tctp7 = cms.EDAnalyzer("L1TCTP7",
     DQMStore = cms.untracked.bool(True),
     disableROOToutput = cms.untracked.bool(False),
     outputFile = cms.untracked.string('./CTP7DQM.root'),
+    pumLutFile = cms.untracked.string('pumLut'),
     ctp7Source = cms.InputTag("ctp7ToDigi"),
     verbose = cms.untracked.bool(False),
     filterTriggerType  = cms.int32(-1)
@@ -61,8 +62,11 @@ process.ctp7link = cms.EDAnalyzer("LinkDQM",
 )
 
 
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+
 #This creates DQM-compatible plots
-process.p = cms.Path(process.ctp7ToDigi+process.ctp7link+filter_step+process.l1tctp7+process.dqmSaver)
+process.p = cms.Path(process.ctp7ToDigi+process.ctp7link+filter_step+process.regionSummary+process.l1tctp7+process.dqmSaver)
 
 
 process.o1 = cms.OutputModule("PoolOutputModule",
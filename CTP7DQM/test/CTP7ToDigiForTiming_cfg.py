@@ -44,6 +44,8 @@ process.l1tctp7 = cms.EDAnalyzer("L1TCTP7",
     DQMStore = cms.untracked.bool(True),
     disableROOToutput = cms.untracked.bool(False),
     outputFile = cms.untracked.string('./CTP7DQM.root'),
+    # the BX alignment histograms go to the same file
+    outputFolders = cms.untracked.vstring('L1T/BxAlignment'),
     ctp7Source = cms.InputTag("ctp7ToDigi"),
     verbose = cms.untracked.bool(False),
     filterTriggerType  = cms.int32(-1)
@@ -58,8 +60,23 @@ process.ctp7link = cms.EDAnalyzer("LinkDQM",
 )
 
 
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+
+# per-card BX offsets from the multi-BC captures, the job stops once they
+# are known to targetError BX
+process.bxAlignment = cms.EDAnalyzer("BxAlignment",
+    DQMStore = cms.untracked.bool(True),
+    regionSummary = cms.untracked.InputTag("regionSummary"),
+    targetError = cms.untracked.double(0.05),
+    minEvents = cms.untracked.uint32(20),
+    checkEvery = cms.untracked.uint32(100),
+    offsetFile = cms.untracked.string('./bxAlignment.txt'),
+    stopWhenConverged = cms.untracked.bool(True)
+)
+
 #This creates DQM-compatible plots
-process.p = cms.Path(process.ctp7ToDigi+process.ctp7link+filter_step+process.l1tctp7+process.dqmSaver)
+process.p = cms.Path(process.ctp7ToDigi+process.ctp7link+filter_step+process.regionSummary+process.l1tctp7+process.bxAlignment+process.dqmSaver)
 
 
 process.o1 = cms.OutputModule("PoolOutputModule",
@@ -2,9 +2,12 @@
 
 while [ "$1" != "" ]; do
     case $1 in
-	-h | --help )               echo "runPattern.sh usage: ./runPattern.sh [-h] [n_iterations] [--wait n_minutes]"
+	-h | --help )               echo "runPattern.sh usage: ./runPattern.sh [-h] [n_iterations] [--wait n_minutes] [--pattern definition]"
                                     exit 1
                                     ;;
+	--pattern )                 shift
+                                    PATTERN=$1
+                                    ;;
 	--wait )                    shift
                                     WAIT_TIME=$1
                                     ;;
@@ -34,6 +37,16 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
 
    cmsRun CTP7ToDigiAndDQMPATTERN_cfg.py >& capture.log
 
+   # Compare with the expected pattern (patternRecorder writes pattern.cap)
+   if [ "$PATTERN" != "" ]; then
+       ctp7PatternCompare "$PATTERN" pattern.cap > patternCheck.txt
+       PATTERN_STATUS=$?
+       head -1 patternCheck.txt
+       if [ "$PATTERN_STATUS" != "0" ]; then
+           FAILED=1
+       fi
+   fi
+
    cp CTP7DQM.root CTP7DQMMERGE.root 
    # Plot
    root -b -q fastplotter.C >& plots.txt 
@@ -53,11 +66,14 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
    mv index.html "$foldername"
      	
    mv CTP7DQM.root  "$foldername"
-   rm *.root
+   rm -f *.root pattern.cap
         
-   cp  "$foldername"/* "$foldername"/index.html /afs/cern.ch/user/r/rctcmstr/www
+   # only the files whose contents changed since the last run are copied
+   ctp7Archive copy /afs/cern.ch/user/r/rctcmstr/www "$foldername"/*
 
    mv "$foldername" ../archive/
+   # files identical to those of earlier runs are kept once, see README
+   ctp7Archive store ../archive ../archive/"$foldername"
 
    if [ "$COUNTER" != "$N_ITERATIONS" ]; then
        if [ "$WAIT_TIME" == "" ]; then
@@ -73,3 +89,8 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
 
 done
     
+
+if [ "$FAILED" != "" ]; then
+    echo "Pattern test FAILED, see patternCheck.txt in the archive"
+    exit 1
+fi
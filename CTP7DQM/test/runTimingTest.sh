@@ -32,8 +32,17 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
 #   cmsRun CTP7ToDigi_cfg.py >& capture.log
 #   cmsRun CTP7DQM_cfg.py >& dqm.log
 
+   rm -f bxAlignment.txt
    cmsRun CTP7ToDigiForTiming_cfg.py  >& capture.log
 
+   # BxAlignment stops the job once the offsets are within its target
+   ALIGNED=""
+   if [ -f bxAlignment.txt ] && head -1 bxAlignment.txt | grep -q ", converged"; then
+       ALIGNED="yes"
+       echo "BX alignment converged:"
+       cat bxAlignment.txt
+   fi
+
    cp CTP7DQM.root CTP7DQMMERGE.root 
    # Plot
    root -b -q fastplotter.C >& plots.txt 
@@ -63,6 +72,11 @@ until [  $COUNTER -gt "$N_ITERATIONS" ]; do
 
    mv "$foldername" ../archive/
 
+   if [ "$ALIGNED" != "" ]; then
+       echo "Stopping after iteration "$COUNTER", the BX offsets are known"
+       break
+   fi
+
    if [ "$COUNTER" != "$N_ITERATIONS" ]; then
        if [ "$WAIT_TIME" == "" ]; then
 	   echo "Waiting 0 minute..."
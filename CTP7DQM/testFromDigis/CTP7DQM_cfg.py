@@ -36,8 +36,12 @@ process.l1tctp7 = cms.EDAnalyzer("L1TCTP7",
     filterTriggerType  = cms.int32(-1)
 )
 
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+process.regionSummary.ctp7Source = cms.InputTag("simRctDigis")
+
 #This creates DQM-compatible plots
-process.p = cms.Path(process.l1tctp7+process.dqmSaver)
+process.p = cms.Path(process.regionSummary+process.l1tctp7+process.dqmSaver)
 
 
 
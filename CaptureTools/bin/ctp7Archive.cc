@@ -0,0 +1,115 @@
+/*
+ * \file ctp7Archive.cc
+ *
+ * Deduplicated storage of the capture folders (CaptureArchive.h).
+ *
+ *   ctp7Archive store <archive> <captureDir>...   link the files into the store
+ *   ctp7Archive migrate <archive>                 store every folder of the archive
+ *   ctp7Archive restore <archive> <captureDir>... put back gzipped (cold) files
+ *   ctp7Archive compress <archive> [--days D]     gzip objects older than D days (30)
+ *   ctp7Archive copy <destDir> <file>...          copy the files whose contents changed
+ *   ctp7Archive usage <archive>                   stored and referenced bytes
+ *
+ * The capture folders must be inside <archive>, on the same file system.
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CTP7Tests/CaptureTools/interface/CaptureArchive.h"
+
+using namespace ctp7arc;
+
+static void usage()
+{
+	std::cout << "usage: ctp7Archive store <archive> <captureDir>...\n"
+		"       ctp7Archive migrate <archive>\n"
+		"       ctp7Archive restore <archive> <captureDir>...\n"
+		"       ctp7Archive compress <archive> [--days D]\n"
+		"       ctp7Archive copy <destDir> <file>...\n"
+		"       ctp7Archive usage <archive>" << std::endl;
+}
+
+static std::string megabytes(uint64_t bytes)
+{
+	std::ostringstream s;
+	s << std::fixed << std::setprecision(1) << bytes/1048576. << " MB";
+	return s.str();
+}
+
+static void print(const std::string& command, const Stats& s)
+{
+	std::cout << command << ": " << s.files << " files, " << megabytes(s.bytes);
+	if (s.skipped) std::cout << ", " << s.skipped << " unchanged";
+	if (s.linked) std::cout << ", " << s.linked << " deduplicated";
+	if (s.added) std::cout << ", " << s.added << (command == "copy" ? " copied" : " new");
+	if (s.compressed) std::cout << ", " << s.compressed << " gzipped";
+	std::cout << ", " << megabytes(s.savedBytes) << " saved" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+		usage();
+		return 1;
+	}
+	const std::string command = argv[1], target = argv[2];
+	std::vector<std::string> args(argv + 3, argv + argc);
+
+	Stats stats;
+	std::string error;
+	bool ok = true;
+
+	if (command == "copy") {
+		ok = copyChanged(args, target, stats, error);
+		print(command, stats);
+	} else if (command == "store" || command == "restore") {
+		if (args.empty()) {
+			usage();
+			return 1;
+		}
+		CaptureArchive archive(target);
+		for (std::vector<std::string>::const_iterator d = args.begin(); d != args.end(); d++) {
+			std::string dirError;
+			if (command == "store" ? archive.store(*d, stats, dirError) : archive.restore(*d, dirError)) continue;
+			std::cerr << "ctp7Archive: " << *d << ": " << dirError << std::endl;
+			ok = false;
+		}
+		if (command == "store") print(command, stats);
+		return ok ? 0 : 2;
+	} else if (command == "migrate") {
+		ok = CaptureArchive(target).migrate(stats, error);
+		print(command, stats);
+	} else if (command == "compress") {
+		double days = 30;
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == "--days" && i + 1 < args.size()) days = atof(args[++i].c_str());
+			else { usage(); return 1; }
+		}
+		ok = CaptureArchive(target).compressCold(uint64_t(days*86400), stats, error);
+		print(command, stats);
+	} else if (command == "usage") {
+		uint64_t objects, stored, referenced;
+		ok = CaptureArchive(target).usage(objects, stored, referenced, error);
+		if (ok) {
+			std::cout << objects << " objects, " << megabytes(stored) << " stored for "
+				<< megabytes(referenced) << " of capture files";
+			if (referenced) std::cout << " (" << std::setprecision(3) << 100.*stored/referenced << "%)";
+			std::cout << std::endl;
+		}
+	} else {
+		usage();
+		return 1;
+	}
+
+	if (!ok) {
+		std::cerr << "ctp7Archive: " << error << std::endl;
+		return 2;
+	}
+	return 0;
+}
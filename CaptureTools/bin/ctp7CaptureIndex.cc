@@ -0,0 +1,157 @@
+/*
+ * \file ctp7CaptureIndex.cc
+ *
+ * Maintains and queries the capture index of runCapture.sh.
+ *
+ *   ctp7CaptureIndex add <index> <captureDir> [--time T] [--file L1ADQM.root]
+ *   ctp7CaptureIndex list <index>
+ *   ctp7CaptureIndex query <index> [--since T] [--until T] [--last-hours H]
+ *                          [--run R] [--links-good] [--file L1ADQM.root]
+ *
+ * Times are unix seconds or YYYYMMDD_HHMMSS (local time). add takes the
+ * capture time from a N_Capture_YYYYMMDD_HHMMSS folder name, or from the
+ * folder mtime. query prints one <captureDir>/<file> per line, ready for hadd.
+ *
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+
+#include <sys/stat.h>
+
+#include "CTP7Tests/CaptureTools/interface/CaptureIndex.h"
+
+using namespace ctp7idx;
+
+static void usage()
+{
+	std::cout << "usage: ctp7CaptureIndex add <index> <captureDir> [--time T] [--file F]\n"
+		"       ctp7CaptureIndex list <index>\n"
+		"       ctp7CaptureIndex query <index> [--since T] [--until T] [--last-hours H]"
+		" [--run R] [--links-good] [--file F]" << std::endl;
+}
+
+// unix seconds, or YYYYMMDD_HHMMSS anywhere in the string; 0 if neither
+static uint64_t parseTime(const std::string& s)
+{
+	if (s.find_first_not_of("0123456789") == std::string::npos && s.size() != 0)
+		return strtoull(s.c_str(), 0, 10);
+	for (size_t i = 0; i + 15 <= s.size(); i++) {
+		struct tm t;
+		memset(&t, 0, sizeof(t));
+		const char* end = strptime(s.c_str() + i, "%Y%m%d_%H%M%S", &t);
+		if (end && end - (s.c_str() + i) == 15) {
+			t.tm_isdst = -1;
+			return mktime(&t);
+		}
+	}
+	return 0;
+}
+
+static std::string formatTime(uint64_t t)
+{
+	time_t tt = t;
+	char buf[32];
+	strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+	return buf;
+}
+
+static int add(const std::string& index, const std::string& dir, uint64_t time, const std::string& file)
+{
+	CaptureRecord r;
+	memset(&r, 0, sizeof(r));
+	if (dir.size() >= sizeof(r.dir)) {
+		std::cerr << "ctp7CaptureIndex: folder name too long: " << dir << std::endl;
+		return 1;
+	}
+	strncpy(r.dir, dir.c_str(), sizeof(r.dir) - 1);
+
+	std::string folder = dir;
+	while (folder.size() > 1 && folder[folder.size() - 1] == '/') folder.erase(folder.size() - 1);
+	r.captureTime = time ? time : parseTime(folder.substr(folder.rfind('/') + 1));
+	struct stat st;
+	if (!r.captureTime && stat(dir.c_str(), &st) == 0) r.captureTime = st.st_mtime;
+
+	std::string error;
+	if (!readCaptureMetadata(dir, file, r, error))
+		std::cerr << "ctp7CaptureIndex: " << error << ", indexing without DQM metadata" << std::endl;
+
+	CaptureIndex idx(index);
+	if (!idx.insert(r, error)) {
+		std::cerr << "ctp7CaptureIndex: " << error << std::endl;
+		return 2;
+	}
+	return 0;
+}
+
+static void print(const CaptureRecord& r)
+{
+	std::cout << formatTime(r.captureTime) << "  run " << std::setw(7) << r.run
+		<< "  events " << std::setw(6) << r.events
+		<< "  trig 0x" << std::hex << std::setw(4) << std::setfill('0') << r.triggerTypes
+		<< "  badLinks 0x" << std::setw(9) << r.badLinkMask << std::dec << std::setfill(' ')
+		<< " (" << r.badLinkEvents << " ev)"
+		<< ((r.flags & AllLinksGood) ? "  good  " : "        ") << r.dir << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		usage();
+		return 1;
+	}
+	const std::string command = argv[1], index = argv[2];
+
+	uint64_t since = 0, until = std::numeric_limits<uint64_t>::max(), time = 0;
+	bool haveRun = false, linksGood = false;
+	int run = 0;
+	std::string file = "L1ADQM.root", dir;
+	for (int i = 3; i < argc; i++) {
+		std::string a = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (a == "-h" || a == "--help") { usage(); return 0; }
+		else if (a == "--since" && hasValue) since = parseTime(argv[++i]);
+		else if (a == "--until" && hasValue) until = parseTime(argv[++i]);
+		else if (a == "--last-hours" && hasValue) since = ::time(0) - uint64_t(atof(argv[++i])*3600);
+		else if (a == "--time" && hasValue) time = parseTime(argv[++i]);
+		else if (a == "--run" && hasValue) { haveRun = true; run = atoi(argv[++i]); }
+		else if (a == "--links-good") linksGood = true;
+		else if (a == "--file" && hasValue) file = argv[++i];
+		else if (dir.empty()) dir = a;
+		else { usage(); return 1; }
+	}
+
+	if (command == "add") {
+		if (dir.empty()) { usage(); return 1; }
+		return add(index, dir, time, file);
+	}
+
+	CaptureIndex idx(index);
+	std::string error;
+	if (!idx.open(error)) {
+		std::cerr << "ctp7CaptureIndex: " << error << std::endl;
+		return 2;
+	}
+
+	if (command == "list") {
+		for (size_t i = 0; i < idx.size(); i++) print(idx[i]);
+		std::cout << idx.size() << " captures" << std::endl;
+		return 0;
+	}
+	if (command == "query") {
+		std::pair<size_t, size_t> range = idx.timeRange(since, until);
+		for (size_t i = range.first; i < range.second; i++) {
+			const CaptureRecord& r = idx[i];
+			if (haveRun && r.run != run) continue;
+			if (linksGood && !(r.flags & AllLinksGood)) continue;
+			std::cout << r.dir << "/" << file << std::endl;
+		}
+		return 0;
+	}
+	usage();
+	return 1;
+}
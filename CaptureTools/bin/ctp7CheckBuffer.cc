@@ -0,0 +1,71 @@
+/*
+ * \file ctp7CheckBuffer.cc
+ *
+ * Checks CTP7 DAQ buffers before they are unpacked or replayed.
+ *
+ *   ctp7CheckBuffer [--quarantine DIR] [--quiet] <daqBuffer.txt>...
+ *
+ * Prints one line per buffer with its reason code (Ok, BadMagic, ...),
+ * L1A, BX, nBCs and link count. The L1A and nBCs of a
+ * daqBuffer-L1A-<l1a>-nBCs-<n> file name must match the header. With
+ * --quarantine, corrupted buffers are moved to DIR with a <file>.reason
+ * next to them. Exit status 0 if every buffer is good, 1 if any was
+ * rejected, 2 if one could not be read.
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "CTP7Tests/CaptureTools/interface/BufferValidator.h"
+
+using namespace ctp7buf;
+
+static void usage()
+{
+	std::cout << "usage: ctp7CheckBuffer [--quarantine DIR] [--quiet] <daqBuffer.txt>..." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	std::string quarantineDir;
+	bool quiet = false;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "-h" || a == "--help") { usage(); return 0; }
+		else if (a == "--quarantine" && i + 1 < argc) quarantineDir = argv[++i];
+		else if (a == "--quiet") quiet = true;
+		else files.push_back(a);
+	}
+	if (files.empty()) {
+		usage();
+		return 1;
+	}
+
+	int status = 0;
+	unsigned int counts[NREASONS];
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0; i < files.size(); i++) {
+		BufferCheck check;
+		std::string error;
+		if (!validateFile(files[i], check, error)) {
+			std::cerr << "ctp7CheckBuffer: " << error << std::endl;
+			status = 2;
+			continue;
+		}
+		counts[check.reason]++;
+		if (!quiet || check.reason != Ok) std::cout << files[i] << ": " << describe(check) << std::endl;
+		if (check.reason == Ok) continue;
+		if (status == 0) status = 1;
+		if (!quarantineDir.empty() && !quarantine(files[i], check, quarantineDir, error))
+			std::cerr << "ctp7CheckBuffer: " << error << std::endl;
+	}
+
+	if (files.size() > 1) {
+		for (unsigned int r = 0; r < NREASONS; r++)
+			if (counts[r]) std::cout << counts[r] << " " << reasonName(Reason(r)) << std::endl;
+	}
+	return status;
+}
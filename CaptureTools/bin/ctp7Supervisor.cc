@@ -0,0 +1,605 @@
+/*
+ * \file ctp7Supervisor.cc
+ *
+ * Runs the capture -> DQM -> harvest -> plot -> publish chain of the l1a
+ * scripts as a pipeline: one thread per stage, bounded queues between
+ * them. Capture N+1 runs while DQM N runs; harvest, plot and publish are
+ * triggered by new DQM outputs and merge everything that arrived since
+ * their last pass. Replaces runCapture.sh + runHarvesting.sh.
+ *
+ *   ctp7Supervisor [options]            (run from CTP7DQM/l1a)
+ *     --name D          archive folder (default runningL1A)
+ *     --iterations N    captures to take, 0 = until SIGINT/SIGTERM (default 1)
+ *     --queue N         captures waiting for DQM before capture pauses (default 2)
+ *     --capture CMD     capture command, run in the capture folder
+ *                       (default: cmsRun <cwd>/RCTToDigi_cfg.py > rct.log 2>&1)
+ *     --dqm CMD         DQM command, run in the capture folder
+ *                       (default: cmsRun <cwd>/L1ADQM_cfg.py > dqm.log 2>&1)
+ *     --plot CMD        plot command, run in the current folder on the merged
+ *                       file $MERGED (default: the fastplotter/linkplotter macros)
+ *     --publish DIR     copy the plots and index.html there, those that changed
+ *                       since the last copy (default: no publish)
+ *
+ * The daqBuffer*.txt files of each capture are checked with the buffer
+ * validator before DQM. A capture with a corrupted buffer is moved to
+ * <name>/quarantine with the reasons in bufferCheck.txt, and never reaches
+ * DQM or the merged file.
+ *
+ * Every capture folder is appended to archiveList.txt and captureIndex.bin
+ * exactly as runCapture.sh does. Per-stage timings go to stdout and to
+ * <name>/supervisor.log.
+ *
+ * The merge, plot and publish completion times of each capture are added
+ * to the <capture>/latency.txt stamps written by the DQM modules, and the
+ * latency from the capture to each stage is summarised in
+ * <name>/latency_summary.txt.
+ *
+ * Once published, a capture folder is complete and its files are linked
+ * into the deduplicated store <name>/.objects (CaptureArchive.h).
+ *
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CTP7Tests/CaptureTools/interface/BufferValidator.h"
+#include "CTP7Tests/CaptureTools/interface/CaptureArchive.h"
+#include "CTP7Tests/CaptureTools/interface/CaptureIndex.h"
+
+// bounded FIFO between two stages; push blocks while full, pop blocks
+// while empty, close() wakes everybody and ends the consumer once drained
+template <class T> class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1), closed_(false) { }
+
+	void push(const T& v)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+		items_.push_back(v);
+		notEmpty_.notify_one();
+	}
+
+	// for the trigger queues: a pending trigger already covers this one
+	void pushOrDrop(const T& v)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (items_.size() >= capacity_) return;
+		items_.push_back(v);
+		notEmpty_.notify_one();
+	}
+
+	// wait for one item, then take everything queued; false once closed and empty
+	bool popAll(std::vector<T>& out)
+	{
+		out.clear();
+		std::unique_lock<std::mutex> lock(mutex_);
+		notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+		if (items_.empty()) return false;
+		out.assign(items_.begin(), items_.end());
+		items_.clear();
+		notFull_.notify_all();
+		return true;
+	}
+
+	bool pop(T& v)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+		if (items_.empty()) return false;
+		v = items_.front();
+		items_.pop_front();
+		notFull_.notify_one();
+		return true;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+		notEmpty_.notify_all();
+		notFull_.notify_all();
+	}
+
+private:
+	size_t capacity_;
+	bool closed_;
+	std::deque<T> items_;
+	std::mutex mutex_;
+	std::condition_variable notEmpty_, notFull_;
+};
+
+struct Capture {
+	unsigned int iteration;
+	std::string dir;
+	uint64_t time;
+	uint64_t captured;   // TimeMonitor capture time from latency.txt, else time
+};
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int)
+{
+	stopRequested = true;
+}
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+// per-stage timing, printed as the pipeline runs and summarised at the end
+class StageTimer
+{
+public:
+	StageTimer(const std::string& logFile) : log_(logFile.c_str(), std::ios::app) { }
+
+	void record(const std::string& stage, const std::string& what, double seconds, int status)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Stats& s = stats_[index(stage)];
+		s.count++;
+		s.total += seconds;
+		if (seconds > s.max) s.max = seconds;
+		if (status != 0) s.failed++;
+		std::ostringstream line;
+		line << std::fixed << std::setprecision(1) << std::setw(8) << stage << " " << what
+			<< " " << seconds << " s" << (status != 0 ? " FAILED" : "");
+		std::cout << line.str() << std::endl;
+		log_ << time(0) << " " << line.str() << std::endl;
+	}
+
+	void summary(double wall)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(1) << "stage      runs  failed   mean s    max s   total s" << std::endl;
+		for (size_t i = 0; i < stats_.size(); i++)
+			out << std::setw(8) << stats_[i].name << std::setw(8) << stats_[i].count << std::setw(8) << stats_[i].failed
+				<< std::setw(9) << (stats_[i].count ? stats_[i].total/stats_[i].count : 0.)
+				<< std::setw(9) << stats_[i].max << std::setw(10) << stats_[i].total << std::endl;
+		out << "wall time " << wall << " s" << std::endl;
+		std::cout << out.str();
+		log_ << out.str();
+	}
+
+private:
+	struct Stats {
+		std::string name;
+		unsigned int count, failed;
+		double total, max;
+	};
+
+	size_t index(const std::string& stage)
+	{
+		for (size_t i = 0; i < stats_.size(); i++)
+			if (stats_[i].name == stage) return i;
+		Stats s = { stage, 0, 0, 0., 0. };
+		stats_.push_back(s);
+		return stats_.size() - 1;
+	}
+
+	std::mutex mutex_;
+	std::vector<Stats> stats_;
+	std::ofstream log_;
+};
+
+// capture-to-stage latencies, stamped into each capture's latency.txt and
+// summarised (count, mean, median, 90%, max) in one small text file
+class LatencyTracker
+{
+public:
+	LatencyTracker(const std::string& summaryFile) : summaryFile_(summaryFile) { }
+
+	// capture time written by the DQM modules, or the supervisor's own
+	static uint64_t captured(const Capture& c)
+	{
+		std::ifstream in((c.dir + "/latency.txt").c_str());
+		std::string stage;
+		uint64_t t, first = 0;
+		while (in >> stage >> t)
+			if (stage == "capture" && (first == 0 || t < first)) first = t;
+		return first ? first : c.time;
+	}
+
+	void stamp(const std::vector<Capture>& captures, const std::string& stage)
+	{
+		const uint64_t t = time(0);
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<double>& l = latencies_[index(stage)].second;
+		for (size_t i = 0; i < captures.size(); i++) {
+			std::ofstream out((captures[i].dir + "/latency.txt").c_str(), std::ios::app);
+			out << stage << " " << t << std::endl;
+			l.push_back(double(t) - double(captures[i].captured));
+		}
+		write();
+	}
+
+	std::string summary()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return format();
+	}
+
+private:
+	size_t index(const std::string& stage)
+	{
+		for (size_t i = 0; i < latencies_.size(); i++)
+			if (latencies_[i].first == stage) return i;
+		latencies_.push_back(std::make_pair(stage, std::vector<double>()));
+		return latencies_.size() - 1;
+	}
+
+	// the two below are called with the lock held
+	std::string format() const
+	{
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(0)
+			<< "latency from capture  count   mean s median s    90% s    max s" << std::endl;
+		for (size_t i = 0; i < latencies_.size(); i++) {
+			std::vector<double> l = latencies_[i].second;
+			if (l.empty()) continue;
+			std::sort(l.begin(), l.end());
+			double sum = 0;
+			for (size_t j = 0; j < l.size(); j++) sum += l[j];
+			out << std::setw(21) << latencies_[i].first << std::setw(7) << l.size()
+				<< std::setw(9) << sum/l.size() << std::setw(9) << l[l.size()/2]
+				<< std::setw(9) << l[(l.size()*9)/10] << std::setw(9) << l.back() << std::endl;
+		}
+		return out.str();
+	}
+
+	// rewritten after every stamp, so the file always has the current numbers
+	void write() const
+	{
+		std::ofstream out((summaryFile_ + ".tmp").c_str());
+		out << format();
+		out.close();
+		rename((summaryFile_ + ".tmp").c_str(), summaryFile_.c_str());
+	}
+
+	std::string summaryFile_;
+	std::mutex mutex_;
+	std::vector<std::pair<std::string, std::vector<double> > > latencies_;
+};
+
+// captures handed from one stage to the next; the trigger queues only say
+// that there is something new, the captures themselves wait here
+class PendingCaptures
+{
+public:
+	void add(const std::vector<Capture>& c)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_.insert(pending_.end(), c.begin(), c.end());
+	}
+
+	std::vector<Capture> take()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<Capture> c;
+		c.swap(pending_);
+		return c;
+	}
+
+private:
+	std::mutex mutex_;
+	std::vector<Capture> pending_;
+};
+
+// /bin/sh -c cmd in dir, with MERGED set; returns the exit status. The
+// command gets its own process group, so Ctrl-C on the terminal reaches
+// only the supervisor, which lets the running steps finish.
+static int runCommand(const std::string& cmd, const std::string& dir, const std::string& merged = "")
+{
+	pid_t pid = fork();
+	if (pid < 0) return -1;
+	if (pid == 0) {
+		setpgid(0, 0);
+		if (!dir.empty() && chdir(dir.c_str()) != 0) _exit(127);
+		if (!merged.empty()) setenv("MERGED", merged.c_str(), 1);
+		execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*) 0);
+		_exit(127);
+	}
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR) return -1;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static std::string quote(const std::string& s)
+{
+	std::string q = "'";
+	for (size_t i = 0; i < s.size(); i++) q += s[i] == '\'' ? std::string("'\\''") : std::string(1, s[i]);
+	return q + "'";
+}
+
+// the plots of the archive folder and index.html, for the publish copy
+static std::vector<std::string> publishedFiles(const std::string& name)
+{
+	std::vector<std::string> files;
+	if (DIR* d = opendir(name.c_str())) {
+		while (struct dirent* e = readdir(d)) {
+			const std::string f = e->d_name;
+			if (f.size() > 4 && f.compare(f.size() - 4, 4, ".png") == 0) files.push_back(name + "/" + f);
+		}
+		closedir(d);
+	}
+	std::sort(files.begin(), files.end());
+	files.push_back("index.html");
+	return files;
+}
+
+static bool exists(const std::string& path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) == 0;
+}
+
+// validates every daqBuffer*.txt of the capture; the report lists each
+// buffer with its reason code, false if any is corrupted or unreadable
+static bool checkBuffers(const std::string& dir, std::string& report)
+{
+	std::vector<std::string> files;
+	if (DIR* d = opendir(dir.c_str())) {
+		while (dirent* e = readdir(d)) {
+			const std::string f = e->d_name;
+			if (f.compare(0, 9, "daqBuffer") == 0 && f.size() > 4 && f.compare(f.size() - 4, 4, ".txt") == 0)
+				files.push_back(f);
+		}
+		closedir(d);
+	}
+	std::sort(files.begin(), files.end());
+
+	bool good = true;
+	std::ostringstream out;
+	for (size_t i = 0; i < files.size(); i++) {
+		ctp7buf::BufferCheck check;
+		std::string error;
+		if (!ctp7buf::validateFile(dir + "/" + files[i], check, error)) {
+			out << files[i] << ": " << error << std::endl;
+			good = false;
+			continue;
+		}
+		out << files[i] << ": " << ctp7buf::describe(check) << std::endl;
+		if (check.reason != ctp7buf::Ok) good = false;
+	}
+	report = out.str();
+	return good;
+}
+
+static void usage()
+{
+	std::cout << "usage: ctp7Supervisor [--name D] [--iterations N] [--queue N] [--capture CMD]"
+		" [--dqm CMD] [--plot CMD] [--publish DIR]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	std::string name = "runningL1A", publishDir;
+	unsigned int iterations = 1, queueSize = 2;
+
+	char cwdBuf[4096];
+	const std::string cwd = getcwd(cwdBuf, sizeof(cwdBuf)) ? cwdBuf : ".";
+	std::string captureCmd = "cmsRun " + quote(cwd + "/RCTToDigi_cfg.py") + " > rct.log 2>&1";
+	std::string dqmCmd = "cmsRun " + quote(cwd + "/L1ADQM_cfg.py") + " > dqm.log 2>&1";
+	std::string plotCmd = "root -b -q \"macros/fastplotter.C(\\\"$MERGED\\\")\" > plots.log 2>&1"
+		" && root -b -q \"macros/linkplotter.C(\\\"$MERGED\\\")\" > plots2.log 2>&1";
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (a == "-h" || a == "--help") { usage(); return 0; }
+		else if (a == "--name" && hasValue) name = argv[++i];
+		else if (a == "--iterations" && hasValue) iterations = atoi(argv[++i]);
+		else if (a == "--queue" && hasValue) queueSize = atoi(argv[++i]);
+		else if (a == "--capture" && hasValue) captureCmd = argv[++i];
+		else if (a == "--dqm" && hasValue) dqmCmd = argv[++i];
+		else if (a == "--plot" && hasValue) plotCmd = argv[++i];
+		else if (a == "--publish" && hasValue) publishDir = argv[++i];
+		else { usage(); return 1; }
+	}
+
+	if (exists(name)) {
+		std::cout << "Directory name already in use: renaming it to " << name << "_old for archiving purposes" << std::endl;
+		rename(name.c_str(), (name + "_old").c_str());
+	}
+	if (mkdir(name.c_str(), 0755) != 0) {
+		std::cerr << "ctp7Supervisor: cannot create " << name << ": " << strerror(errno) << std::endl;
+		return 2;
+	}
+
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	StageTimer timer(name + "/supervisor.log");
+	LatencyTracker latency(name + "/latency_summary.txt");
+	PendingCaptures toRender, toRelease;
+	BoundedQueue<Capture> toDqm(queueSize), toHarvest(1000);
+	BoundedQueue<int> toPlot(1), toPublish(1);
+	const std::string merged = name + "/L1ADQMMERGED.root";
+	const double t0 = now();
+
+	// capture: never waits for DQM unless queueSize captures are pending
+	std::thread capture([&] {
+		for (unsigned int n = 1; (iterations == 0 || n <= iterations) && !stopRequested; n++) {
+			Capture c;
+			c.iteration = n;
+			c.time = time(0);
+			c.captured = c.time;
+			char stamp[32];
+			time_t tt = c.time;
+			strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&tt));
+			std::ostringstream dir;
+			dir << name << "/" << n << "_Capture_" << stamp;
+			c.dir = dir.str();
+			mkdir(c.dir.c_str(), 0755);
+
+			const double t = now();
+			int status = runCommand(captureCmd, c.dir);
+			timer.record("capture", c.dir, now() - t, status);
+			if (status != 0) continue;
+
+			// a corrupted buffer would cost a DQM pass and end up in the merged file
+			const double tc = now();
+			std::string report;
+			const bool good = checkBuffers(c.dir, report);
+			timer.record("check", c.dir, now() - tc, good ? 0 : 1);
+			if (!good) {
+				const std::string target = name + "/quarantine/" + c.dir.substr(name.size() + 1);
+				mkdir((name + "/quarantine").c_str(), 0755);
+				std::ofstream out((c.dir + "/bufferCheck.txt").c_str());
+				out << report;
+				out.close();
+				if (rename(c.dir.c_str(), target.c_str()) == 0)
+					std::cerr << "ctp7Supervisor: corrupted buffer, " << c.dir << " quarantined in " << target << std::endl;
+				else
+					std::cerr << "ctp7Supervisor: corrupted buffer in " << c.dir << ", not processed" << std::endl;
+				std::cerr << report;
+				continue;
+			}
+			toDqm.push(c);
+		}
+		toDqm.close();
+	});
+
+	// DQM and archiving, one capture at a time
+	std::thread dqm([&] {
+		Capture c;
+		while (toDqm.pop(c)) {
+			const double t = now();
+			int status = runCommand(dqmCmd + "; rm -f DQM_V0001_R*__L1TMonitor__Calo__CTP7.root", c.dir);
+			timer.record("dqm", c.dir, now() - t, status);
+			if (status != 0 || !exists(c.dir + "/L1ADQM.root")) continue;
+			c.captured = LatencyTracker::captured(c);
+			latency.stamp(std::vector<Capture>(1, c), "dqm");
+
+			std::ofstream list((name + "/archiveList.txt").c_str(), std::ios::app);
+			list << c.dir << "/L1ADQM.root" << std::endl;
+
+			ctp7idx::CaptureRecord r;
+			memset(&r, 0, sizeof(r));
+			strncpy(r.dir, c.dir.c_str(), sizeof(r.dir) - 1);
+			r.captureTime = c.time;
+			std::string error;
+			if (!readCaptureMetadata(c.dir, "L1ADQM.root", r, error))
+				std::cerr << "ctp7Supervisor: " << error << ", indexing without DQM metadata" << std::endl;
+			if (!CaptureIndex(name + "/captureIndex.bin").insert(r, error))
+				std::cerr << "ctp7Supervisor: " << error << std::endl;
+
+			toHarvest.push(c);
+		}
+		toHarvest.close();
+	});
+
+	// merge every new DQM file into the running total in one hadd
+	std::thread harvest([&] {
+		std::vector<Capture> fresh;
+		while (toHarvest.popAll(fresh)) {
+			const double t = now();
+			std::string cmd = "hadd -f " + quote(merged + ".tmp");
+			if (exists(merged)) cmd += " " + quote(merged);
+			for (size_t i = 0; i < fresh.size(); i++) cmd += " " + quote(fresh[i].dir + "/L1ADQM.root");
+			cmd += " > " + quote(name + "/hadd.log") + " 2>&1 && mv -f " + quote(merged + ".tmp") + " " + quote(merged);
+			int status = runCommand(cmd, "");
+			std::ostringstream what;
+			what << fresh.size() << " new capture(s)";
+			timer.record("harvest", what.str(), now() - t, status);
+			if (status != 0) continue;
+			latency.stamp(fresh, "merge");
+			toRender.add(fresh);
+			toPlot.pushOrDrop(1);
+		}
+		toPlot.close();
+	});
+
+	std::thread plot([&] {
+		int trigger;
+		while (toPlot.pop(trigger)) {
+			// everything merged so far is in the file being plotted
+			std::vector<Capture> plotted = toRender.take();
+			const double t = now();
+			int status = runCommand(plotCmd, "", merged);
+			// the plots and logs are moved even after a failure, the logs tell why
+			runCommand("mv -f *.png plots*.log " + quote(name) + "/ 2>/dev/null; true", "");
+			timer.record("plot", merged, now() - t, status);
+			if (status != 0) {
+				toRender.add(plotted);
+				continue;
+			}
+			latency.stamp(plotted, "plot");
+			toRelease.add(plotted);
+			toPublish.pushOrDrop(1);
+		}
+		toPublish.close();
+	});
+
+	std::thread publish([&] {
+		int trigger;
+		while (toPublish.pop(trigger)) {
+			std::vector<Capture> rendered = toRelease.take();
+			std::string error;
+			if (!publishDir.empty()) {
+				const double t = now();
+				// unchanged plots are not written to the web area again
+				ctp7arc::Stats copied;
+				const bool ok = ctp7arc::copyChanged(publishedFiles(name), publishDir, copied, error);
+				timer.record("publish", publishDir, now() - t, ok ? 0 : 1);
+				if (!ok) {
+					std::cerr << "ctp7Supervisor: " << error << std::endl;
+					toRelease.add(rendered);
+					continue;
+				}
+				latency.stamp(rendered, "publish");
+			}
+
+			// nothing is added to these folders any more
+			const double ta = now();
+			CaptureArchive archive(name);
+			ctp7arc::Stats stored;
+			int status = 0;
+			for (std::vector<Capture>::const_iterator c = rendered.begin(); c != rendered.end(); c++) {
+				if (archive.store(c->dir, stored, error)) continue;
+				std::cerr << "ctp7Supervisor: " << c->dir << ": " << error << std::endl;
+				status = 1;
+			}
+			std::ostringstream what;
+			what << rendered.size() << " capture(s), " << stored.linked << " deduplicated";
+			timer.record("archive", what.str(), now() - ta, status);
+		}
+	});
+
+	capture.join();
+	dqm.join();
+	harvest.join();
+	plot.join();
+	publish.join();
+
+	timer.summary(now() - t0);
+	std::cout << latency.summary();
+	return 0;
+}
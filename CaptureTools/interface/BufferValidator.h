@@ -0,0 +1,79 @@
+#ifndef BUFFERVALIDATOR_h
+#define BUFFERVALIDATOR_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Structural check of a CTP7 DAQ buffer (daqBuffer-L1A-<l1a>-nBCs-<n>.txt,
+// 32-bit words in hex) before it is unpacked:
+//
+//   0  bx[31:20] | length[19:0]          length in 64-bit words
+//   1  event counter[23:0]
+//   2,3
+//   4  c0de0100                          marker and format version
+//   5  nBCs[31:16] | l1a[15:0]
+//   per link: crate[15:8] | 0a/0b,  status[19:16] (0xf = good),
+//             nBCs x { ..3c, 4 data words, .. }
+//   length*2-2  event counter[7:0] << 24 | length
+//   length*2-1  CRC, zero in the current firmware
+//
+// The buffer is a fixed-size window and may hold stale words of a longer
+// earlier event beyond length*2. A link status other than 0xf is not a
+// corruption; those links are reported in badLinkMask.
+namespace ctp7buf {
+
+	enum Reason {
+		Ok = 0,
+		TooShort,        // fewer words than the header and trailer
+		BadMagic,        // no c0de0100 marker
+		BadLength,       // header length beyond the buffer
+		BadTrailer,      // trailer length or event counter differs from the header
+		BadBx,           // bx >= 3564
+		BadL1A,          // l1a or nBCs differs from the expected (file name) one
+		BadLayout,       // nBCs is 0 or the payload is not whole link blocks
+		BadLinkHeader,   // unknown link id or non-zero reserved bits
+		DuplicateLink,
+		BadComma,        // a BC word without its 0x3c comma
+		NREASONS
+	};
+
+	const char* reasonName(Reason reason);
+
+	struct BufferCheck {
+		Reason reason;
+		uint32_t word;          // first offending word, when reason != Ok
+		uint32_t words;         // event length in 32-bit words
+		uint32_t bx;
+		uint32_t eventCounter;
+		uint32_t l1a;
+		uint32_t nBCs;
+		uint32_t nLinks;
+		uint64_t badLinkMask;   // bit crate*2 + link set if status != 0xf
+	};
+
+	static const uint32_t MAGIC = 0xc0de0100;
+	static const unsigned int NCRATES = 18;
+	static const unsigned int MAXBCS = 16;
+
+	// expectL1A/expectNBCs < 0 are not checked
+	BufferCheck validate(const uint32_t* buffer, size_t n, int expectL1A = -1, int expectNBCs = -1);
+
+	// the hex words of a daqBuffer text file
+	bool readBufferText(const std::string& file, std::vector<uint32_t>& words, std::string& error);
+
+	// l1a and nBCs of a daqBuffer-L1A-<l1a>-nBCs-<n> file name, -1 if absent
+	void expectedFromName(const std::string& file, int& l1a, int& nBCs);
+
+	// reads file and validates it against its name; false if it cannot be read
+	bool validateFile(const std::string& file, BufferCheck& check, std::string& error);
+
+	// moves file into dir (created if needed) with a <file>.reason next to it
+	bool quarantine(const std::string& file, const BufferCheck& check, const std::string& dir, std::string& error);
+
+	// one line: reason, l1a, bx, nBCs, links, first offending word
+	std::string describe(const BufferCheck& check);
+
+}
+
+#endif
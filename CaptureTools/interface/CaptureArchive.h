@@ -0,0 +1,98 @@
+#ifndef CAPTUREARCHIVE_h
+#define CAPTUREARCHIVE_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Content-addressed store of the archived capture folders. Every file of
+// a stored folder becomes a hard link to <root>/.objects/ab/<md5>, so
+// identical files (the same plots, logs and ROOT files of repeated
+// pattern runs) take the disk space once. The files stay in place and
+// every reader (plotters, hadd, the capture index) sees the folder as
+// before. Each folder gets a manifest, <dir>/.ctp7manifest, with one
+//
+//   <md5> <size> <name>
+//
+// line per file. Objects are read-only, since all their links share the
+// same contents: a folder is stored once nothing more is written to it.
+// A new file is linked into the store, not copied. Cold objects can be
+// gzipped, which removes their links from the folders until restore()
+// puts them back; ROOT files and PNGs, which do not compress, are left
+// as they are. The store must be on the file system
+// of the folders; across file systems the objects are copies.
+namespace ctp7arc {
+
+	struct Entry {
+		std::string hash;
+		uint64_t size;
+		std::string name;
+	};
+
+	struct Stats {
+		Stats() : files(0), skipped(0), linked(0), added(0), compressed(0), bytes(0), savedBytes(0) { }
+		uint64_t files;       // files looked at
+		uint64_t skipped;     // already stored, not read again
+		uint64_t linked;      // replaced by a link to an existing object
+		uint64_t added;       // new objects, or files copied
+		uint64_t compressed;  // objects gzipped
+		uint64_t bytes;       // bytes of the files
+		uint64_t savedBytes;  // bytes no longer stored twice, or saved by gzip
+	};
+
+	const char* const MANIFEST = ".ctp7manifest";
+
+	// md5 of the contents as 32 hex digits
+	bool hashFile(const std::string& path, std::string& hash, std::string& error);
+
+	// absent manifest: no entries
+	bool readManifest(const std::string& dir, std::vector<Entry>& entries, std::string& error);
+	bool writeManifest(const std::string& dir, const std::vector<Entry>& entries, std::string& error);
+
+	// copies the files to destDir, except those whose contents are already
+	// there as recorded in destDir/.ctp7manifest (and not touched since)
+	bool copyChanged(const std::vector<std::string>& files, const std::string& destDir,
+		Stats& stats, std::string& error);
+
+}
+
+class CaptureArchive
+{
+public:
+	explicit CaptureArchive(const std::string& root);
+
+	const std::string& root() const { return root_; }
+
+	// objects/ab/<md5>, and the gzipped cold object
+	std::string objectPath(const std::string& hash) const;
+	std::string coldPath(const std::string& hash) const { return objectPath(hash) + ".gz"; }
+
+	// stores the regular files of dir and writes its manifest; files
+	// listed in the manifest and still linked to their object are skipped
+	bool store(const std::string& dir, ctp7arc::Stats& stats, std::string& error);
+
+	// stores every capture folder directly under the root
+	bool migrate(ctp7arc::Stats& stats, std::string& error);
+
+	// relinks the files of the manifest that are missing, from the objects
+	// or their gzipped copies
+	bool restore(const std::string& dir, std::string& error);
+
+	// gzips the objects not modified for maxAge seconds, if that saves at
+	// least 10%, and removes their links from the capture folders
+	bool compressCold(uint64_t maxAge, ctp7arc::Stats& stats, std::string& error);
+
+	// stored bytes, and bytes the manifests refer to
+	bool usage(uint64_t& objects, uint64_t& stored, uint64_t& referenced, std::string& error) const;
+
+private:
+	// the capture folders under the root, without the store
+	bool folders(std::vector<std::string>& dirs, std::string& error) const;
+	bool storeFile(const std::string& path, const std::string& hash, uint64_t size,
+		ctp7arc::Stats& stats, std::string& error);
+
+	std::string root_;
+	std::string objects_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CAPTUREINDEX_h
+#define CAPTUREINDEX_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Index of the archived captures of runCapture.sh. One fixed-size
+// record per capture, kept sorted by capture time in a binary file:
+//
+//   "CTP7IDX1" | uint32 recordSize | uint32 count | CaptureRecord[count]
+//
+// Queries map the file and binary-search the time range, so selecting
+// captures does not open any ROOT file. Inserts rewrite the file under
+// an exclusive lock and rename it into place; readers always see a
+// complete index.
+namespace ctp7idx {
+
+	enum Flags { AllLinksGood = 1, HasDQM = 2 };
+
+	struct CaptureRecord {
+		uint64_t captureTime;     // unix time of the archive step
+		int32_t run;              // TimeMonitor run number
+		uint32_t date;            // TimeMonitor ddmm of the first event
+		uint32_t clock;           // TimeMonitor hhmmss of the first event
+		uint32_t events;
+		uint32_t triggerTypes;    // bit t set if trigger type t was seen
+		uint32_t badLinkEvents;   // events with at least one link not 0xf
+		uint64_t badLinkMask;     // bit i set if link i was ever not 0xf
+		uint32_t nLinks;
+		uint32_t flags;
+		char dir[208];            // capture folder, as archived
+	};
+
+}
+
+class CaptureIndex
+{
+public:
+	explicit CaptureIndex(const std::string& file);
+	~CaptureIndex();
+
+	// map the index read-only; an absent file is an empty index
+	bool open(std::string& error);
+	void close();
+
+	size_t size() const { return count_; }
+	const ctp7idx::CaptureRecord& operator[](size_t i) const { return records_[i]; }
+
+	// [first, last) of the records with since <= captureTime < until
+	std::pair<size_t, size_t> timeRange(uint64_t since, uint64_t until) const;
+
+	// add (or replace, same dir) one capture; safe against concurrent queries
+	bool insert(const ctp7idx::CaptureRecord& record, std::string& error);
+
+private:
+	CaptureIndex(const CaptureIndex&);
+	CaptureIndex& operator=(const CaptureIndex&);
+
+	std::string file_;
+	void* base_;
+	size_t bytes_;
+	const ctp7idx::CaptureRecord* records_;
+	size_t count_;
+};
+
+// fill the record from <dir>/<dqmFile> (LinkDQM RctCaptureInfo, the
+// RctCapture{Run,Date,Time} scalars and RctLinkMonitor2D, RCTL1A
+// TriggerType); captureTime and dir are not touched. A file hadd'ed from
+// several captures is refused.
+bool readCaptureMetadata(const std::string& dir, const std::string& dqmFile,
+		ctp7idx::CaptureRecord& record, std::string& error);
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * \file BufferValidator.cc
+ *
+ * Structural check of the CTP7 DAQ buffers before unpacking.
+ *
+ */
+
+#include "CTP7Tests/CaptureTools/interface/BufferValidator.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+using namespace ctp7buf;
+
+static const size_t HEADERWORDS = 6;
+static const size_t TRAILERWORDS = 2;
+static const size_t BCWORDS = 6;
+static const uint32_t COMMA = 0x3c;
+static const uint32_t ORBITBX = 3564;
+
+static const char* const REASONS[NREASONS] = {
+	"Ok", "TooShort", "BadMagic", "BadLength", "BadTrailer", "BadBx",
+	"BadL1A", "BadLayout", "BadLinkHeader", "DuplicateLink", "BadComma"
+};
+
+const char* ctp7buf::reasonName(Reason reason)
+{
+	return (reason >= Ok && reason < NREASONS) ? REASONS[reason] : "Unknown";
+}
+
+static BufferCheck& fail(BufferCheck& c, Reason reason, size_t word)
+{
+	c.reason = reason;
+	c.word = word;
+	return c;
+}
+
+// non-zero if the link header words are malformed
+static inline uint32_t linkHeaderError(uint32_t id, uint32_t status)
+{
+	return (id & 0xffff0000) | ((id & 0xfe) ^ 0x0a) | (((id >> 8) & 0xff) >= NCRATES) | (status & 0xfff0ffff);
+}
+
+BufferCheck ctp7buf::validate(const uint32_t* buffer, size_t n, int expectL1A, int expectNBCs)
+{
+	BufferCheck c;
+	memset(&c, 0, sizeof(c));
+	c.reason = Ok;
+
+	if (n < HEADERWORDS + TRAILERWORDS) return fail(c, TooShort, n);
+	if (buffer[4] != MAGIC) return fail(c, BadMagic, 4);
+
+	c.words = (buffer[0] & 0xfffff)*2;
+	c.bx = buffer[0] >> 20;
+	c.eventCounter = buffer[1] & 0xffffff;
+	c.nBCs = buffer[5] >> 16;
+	c.l1a = buffer[5] & 0xffff;
+
+	if (c.words < HEADERWORDS + TRAILERWORDS || c.words > n) return fail(c, BadLength, 0);
+	const uint32_t trailer = buffer[c.words - 2];
+	if ((trailer & 0xffffff) != c.words/2 || (trailer >> 24) != (c.eventCounter & 0xff))
+		return fail(c, BadTrailer, c.words - 2);
+	if (c.bx >= ORBITBX) return fail(c, BadBx, 0);
+	if ((expectL1A >= 0 && c.l1a != uint32_t(expectL1A)) || (expectNBCs >= 0 && c.nBCs != uint32_t(expectNBCs)))
+		return fail(c, BadL1A, 5);
+
+	const size_t payload = c.words - HEADERWORDS - TRAILERWORDS;
+	const size_t block = 2 + BCWORDS*c.nBCs;
+	if (c.nBCs == 0 || c.nBCs > MAXBCS || payload % block != 0 || payload/block > 2*NCRATES)
+		return fail(c, BadLayout, 5);
+	c.nLinks = payload/block;
+
+	// fast pass: OR all the errors together without branching, so a good
+	// buffer costs one sweep over the link and BC header words
+	const uint32_t* links = buffer + HEADERWORDS;
+	uint32_t error = 0;
+	uint64_t seen = 0, duplicate = 0;
+	for (size_t l = 0; l < c.nLinks; l++) {
+		const uint32_t* p = links + l*block;
+		error |= linkHeaderError(p[0], p[1]);
+		const uint64_t bit = (((p[0] >> 8) & 0xff) < NCRATES) ? uint64_t(1) << ((((p[0] >> 8) & 0xff) << 1) | (p[0] & 1)) : 0;
+		duplicate |= seen & bit;
+		seen |= bit;
+		c.badLinkMask |= (((p[1] >> 16) & 0xf) != 0xf) ? bit : 0;
+		for (size_t b = 0; b < c.nBCs; b++) error |= (p[2 + BCWORDS*b] & 0xff) ^ COMMA;
+	}
+	if (!error && !duplicate) return c;
+
+	// slow pass, corrupt buffers only: find the first offending word
+	seen = 0;
+	for (size_t l = 0; l < c.nLinks; l++) {
+		const uint32_t* p = links + l*block;
+		const size_t word = HEADERWORDS + l*block;
+		if (linkHeaderError(p[0], p[1])) return fail(c, BadLinkHeader, word);
+		const uint64_t bit = uint64_t(1) << ((((p[0] >> 8) & 0xff) << 1) | (p[0] & 1));
+		if (seen & bit) return fail(c, DuplicateLink, word);
+		seen |= bit;
+		for (size_t b = 0; b < c.nBCs; b++)
+			if ((p[2 + BCWORDS*b] & 0xff) != COMMA) return fail(c, BadComma, word + 2 + BCWORDS*b);
+	}
+	return c;
+}
+
+bool ctp7buf::readBufferText(const std::string& file, std::vector<uint32_t>& words, std::string& error)
+{
+	words.clear();
+	std::ifstream in(file.c_str(), std::ios::binary);
+	if (!in) {
+		error = file + ": " + strerror(errno);
+		return false;
+	}
+	std::ostringstream text;
+	text << in.rdbuf();
+	const std::string s = text.str();
+
+	uint32_t word = 0;
+	unsigned int digits = 0;
+	for (size_t i = 0; i <= s.size(); i++) {
+		const char ch = i < s.size() ? s[i] : ' ';
+		int v = -1;
+		if (ch >= '0' && ch <= '9') v = ch - '0';
+		else if (ch >= 'a' && ch <= 'f') v = ch - 'a' + 10;
+		else if (ch >= 'A' && ch <= 'F') v = ch - 'A' + 10;
+		if (v >= 0) {
+			if (++digits > 8) {
+				error = file + ": word longer than 32 bits";
+				return false;
+			}
+			word = (word << 4) | v;
+		}
+		else if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
+			if (digits) words.push_back(word);
+			word = 0;
+			digits = 0;
+		}
+		else {
+			error = file + ": not a hex word list";
+			return false;
+		}
+	}
+	return true;
+}
+
+void ctp7buf::expectedFromName(const std::string& file, int& l1a, int& nBCs)
+{
+	const size_t slash = file.rfind('/');
+	const std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+	l1a = nBCs = -1;
+	size_t pos = name.find("L1A-");
+	if (pos != std::string::npos && isdigit(name[pos + 4])) l1a = atoi(name.c_str() + pos + 4);
+	pos = name.find("nBCs-");
+	if (pos != std::string::npos && isdigit(name[pos + 5])) nBCs = atoi(name.c_str() + pos + 5);
+}
+
+bool ctp7buf::validateFile(const std::string& file, BufferCheck& check, std::string& error)
+{
+	std::vector<uint32_t> words;
+	if (!readBufferText(file, words, error)) return false;
+	int l1a, nBCs;
+	expectedFromName(file, l1a, nBCs);
+	check = validate(words.empty() ? 0 : &words[0], words.size(), l1a, nBCs);
+	return true;
+}
+
+bool ctp7buf::quarantine(const std::string& file, const BufferCheck& check, const std::string& dir, std::string& error)
+{
+	if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+		error = dir + ": " + strerror(errno);
+		return false;
+	}
+	const size_t slash = file.rfind('/');
+	const std::string target = dir + "/" + (slash == std::string::npos ? file : file.substr(slash + 1));
+	if (rename(file.c_str(), target.c_str()) != 0) {
+		error = file + ": " + strerror(errno);
+		return false;
+	}
+	std::ofstream reason((target + ".reason").c_str());
+	reason << describe(check) << std::endl;
+	return true;
+}
+
+std::string ctp7buf::describe(const BufferCheck& check)
+{
+	std::ostringstream out;
+	out << reasonName(check.reason);
+	if (check.reason != Ok) out << " at word " << check.word;
+	out << ": l1a " << check.l1a << " bx " << check.bx << " nBCs " << check.nBCs << " links " << check.nLinks;
+	unsigned int bad = 0;
+	for (uint64_t m = check.badLinkMask; m; m &= m - 1) bad++;
+	if (bad) out << " (" << bad << " not 0xf)";
+	return out.str();
+}
@@ -0,0 +1,496 @@
+/*
+ * \file CaptureArchive.cc
+ *
+ * Content-addressed, deduplicated store of the capture folders.
+ *
+ */
+
+#include "CTP7Tests/CaptureTools/interface/CaptureArchive.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "FWCore/Utilities/interface/Digest.h"
+
+using namespace ctp7arc;
+
+static const size_t CHUNK = 1 << 20;
+
+static std::string sysError(const std::string& what, const std::string& path)
+{
+	return what + " " + path + ": " + strerror(errno);
+}
+
+static bool sameInode(const struct stat& a, const struct stat& b)
+{
+	return a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+// names of the entries of dir of the given type, hidden ones excluded
+static bool listDir(const std::string& dir, bool directories, std::vector<std::string>& names, std::string& error)
+{
+	DIR* d = opendir(dir.c_str());
+	if (!d) {
+		error = sysError("cannot open", dir);
+		return false;
+	}
+	while (struct dirent* e = readdir(d)) {
+		if (e->d_name[0] == '.') continue;
+		struct stat st;
+		if (lstat((dir + "/" + e->d_name).c_str(), &st) != 0) continue;
+		if (directories ? S_ISDIR(st.st_mode) : S_ISREG(st.st_mode)) names.push_back(e->d_name);
+	}
+	closedir(d);
+	std::sort(names.begin(), names.end());
+	return true;
+}
+
+static bool copyFile(const std::string& from, const std::string& to, mode_t mode, std::string& error)
+{
+	const std::string tmp = to + ".tmp";
+	const int in = open(from.c_str(), O_RDONLY);
+	if (in < 0) {
+		error = sysError("cannot read", from);
+		return false;
+	}
+	const int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+	if (out < 0) {
+		error = sysError("cannot write", tmp);
+		close(in);
+		return false;
+	}
+	std::vector<char> buf(CHUNK);
+	ssize_t n;
+	bool ok = true;
+	while ((n = read(in, &buf[0], buf.size())) > 0)
+		if (write(out, &buf[0], n) != n) { ok = false; break; }
+	if (n < 0) ok = false;
+	close(in);
+	if (close(out) != 0) ok = false;
+	if (!ok || rename(tmp.c_str(), to.c_str()) != 0) {
+		error = sysError("cannot copy to", to);
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ctp7arc::hashFile(const std::string& path, std::string& hash, std::string& error)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if (!in) {
+		error = sysError("cannot read", path);
+		return false;
+	}
+	cms::Digest digest;
+	std::vector<char> buf(CHUNK);
+	while (in.read(&buf[0], buf.size()) || in.gcount() > 0)
+		digest.append(&buf[0], in.gcount());
+	if (in.bad()) {
+		error = sysError("cannot read", path);
+		return false;
+	}
+	hash = digest.digest().toString();
+	return true;
+}
+
+bool ctp7arc::readManifest(const std::string& dir, std::vector<Entry>& entries, std::string& error)
+{
+	entries.clear();
+	const std::string file = dir + "/" + MANIFEST;
+	std::ifstream in(file.c_str());
+	if (!in) return true;
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		Entry e;
+		if (!(fields >> e.hash >> e.size) || e.hash.size() != 32) {
+			error = file + ": bad line '" + line + "'";
+			return false;
+		}
+		// the name is the rest of the line, it may hold spaces
+		std::getline(fields >> std::ws, e.name);
+		if (e.name.empty() || e.name.find('/') != std::string::npos) {
+			error = file + ": bad line '" + line + "'";
+			return false;
+		}
+		entries.push_back(e);
+	}
+	return true;
+}
+
+bool ctp7arc::writeManifest(const std::string& dir, const std::vector<Entry>& entries, std::string& error)
+{
+	const std::string file = dir + "/" + MANIFEST;
+	const std::string tmp = file + ".tmp";
+	{
+		std::ofstream out(tmp.c_str());
+		for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); e++)
+			out << e->hash << " " << e->size << " " << e->name << "\n";
+		if (!out.flush()) {
+			error = sysError("cannot write", tmp);
+			return false;
+		}
+	}
+	if (rename(tmp.c_str(), file.c_str()) != 0) {
+		error = sysError("cannot write", file);
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ctp7arc::copyChanged(const std::vector<std::string>& files, const std::string& destDir,
+		Stats& stats, std::string& error)
+{
+	std::vector<Entry> list;
+	if (!readManifest(destDir, list, error)) return false;
+	std::map<std::string, Entry> dest;
+	for (std::vector<Entry>::const_iterator e = list.begin(); e != list.end(); e++) dest[e->name] = *e;
+
+	bool ok = true;
+	for (std::vector<std::string>::const_iterator f = files.begin(); f != files.end(); f++) {
+		struct stat st;
+		if (stat(f->c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+		const std::string name = f->substr(f->rfind('/') == std::string::npos ? 0 : f->rfind('/') + 1);
+		stats.files++;
+		stats.bytes += st.st_size;
+
+		std::string hash;
+		if (!hashFile(*f, hash, error)) return false;
+		std::map<std::string, Entry>::const_iterator known = dest.find(name);
+		struct stat ds;
+		if (known != dest.end() && known->second.hash == hash
+		    && stat((destDir + "/" + name).c_str(), &ds) == 0 && uint64_t(ds.st_size) == uint64_t(st.st_size)) {
+			stats.skipped++;
+			stats.savedBytes += st.st_size;
+			continue;
+		}
+		std::string copyError;
+		if (!copyFile(*f, destDir + "/" + name, 0644, copyError)) {
+			// keep copying the others, report the first failure
+			if (ok) error = copyError;
+			ok = false;
+			dest.erase(name);
+			continue;
+		}
+		Entry e;
+		e.hash = hash;
+		e.size = st.st_size;
+		e.name = name;
+		dest[name] = e;
+		stats.added++;
+	}
+
+	list.clear();
+	for (std::map<std::string, Entry>::const_iterator e = dest.begin(); e != dest.end(); e++) list.push_back(e->second);
+	std::string manifestError;
+	if (!writeManifest(destDir, list, manifestError)) {
+		if (ok) error = manifestError;
+		return false;
+	}
+	return ok;
+}
+
+CaptureArchive::CaptureArchive(const std::string& root) :
+	root_(root),
+	objects_(root + "/.objects")
+{
+}
+
+std::string CaptureArchive::objectPath(const std::string& hash) const
+{
+	return objects_ + "/" + hash.substr(0, 2) + "/" + hash;
+}
+
+bool CaptureArchive::folders(std::vector<std::string>& dirs, std::string& error) const
+{
+	std::vector<std::string> names;
+	if (!listDir(root_, true, names, error)) return false;
+	for (std::vector<std::string>::const_iterator n = names.begin(); n != names.end(); n++)
+		dirs.push_back(root_ + "/" + *n);
+	return true;
+}
+
+bool CaptureArchive::storeFile(const std::string& path, const std::string& hash, uint64_t size,
+		Stats& stats, std::string& error)
+{
+	const std::string object = objectPath(hash);
+	for (int attempt = 0; attempt < 2; attempt++) {
+		struct stat os;
+		if (stat(object.c_str(), &os) == 0) {
+			if (uint64_t(os.st_size) != size) {
+				error = object + " does not have the size of " + path;
+				return false;
+			}
+			// the same contents are stored: the file becomes one more link
+			const size_t slash = path.rfind('/') + 1;
+			const std::string tmp = path.substr(0, slash) + "." + path.substr(slash) + ".ctp7link";
+			unlink(tmp.c_str());
+			if (link(object.c_str(), tmp.c_str()) != 0) {
+				if (errno == EXDEV || errno == EMLINK) return true;
+				error = sysError("cannot link", tmp);
+				return false;
+			}
+			if (rename(tmp.c_str(), path.c_str()) != 0) {
+				error = sysError("cannot replace", path);
+				unlink(tmp.c_str());
+				return false;
+			}
+			stats.linked++;
+			stats.savedBytes += size;
+			return true;
+		}
+
+		// new contents: the file itself becomes the object, read-only as
+		// every later link shares it
+		mkdir(objects_.c_str(), 0755);
+		mkdir(object.substr(0, object.rfind('/')).c_str(), 0755);
+		chmod(path.c_str(), 0444);
+		if (link(path.c_str(), object.c_str()) == 0 ||
+		    (errno == EXDEV && copyFile(path, object, 0444, error))) {
+			// a gzipped copy is no longer needed
+			unlink(coldPath(hash).c_str());
+			stats.added++;
+			return true;
+		}
+		// stored meanwhile by another job, link to it
+		if (errno != EEXIST) {
+			if (error.empty()) error = sysError("cannot store", object);
+			return false;
+		}
+	}
+	error = "cannot store " + path;
+	return false;
+}
+
+bool CaptureArchive::store(const std::string& dir, Stats& stats, std::string& error)
+{
+	std::vector<Entry> list;
+	if (!readManifest(dir, list, error)) return false;
+	std::map<std::string, Entry> entries;
+	for (std::vector<Entry>::const_iterator e = list.begin(); e != list.end(); e++) entries[e->name] = *e;
+
+	std::vector<std::string> names;
+	if (!listDir(dir, false, names, error)) return false;
+	std::map<std::string, Entry> stored;
+	for (std::vector<std::string>::const_iterator n = names.begin(); n != names.end(); n++) {
+		const std::string path = dir + "/" + *n;
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) continue;
+		stats.files++;
+		stats.bytes += st.st_size;
+
+		// still the link of the manifest: nothing to read
+		std::map<std::string, Entry>::const_iterator known = entries.find(*n);
+		struct stat os;
+		if (known != entries.end() && known->second.size == uint64_t(st.st_size)
+		    && stat(objectPath(known->second.hash).c_str(), &os) == 0 && sameInode(os, st)) {
+			stored[*n] = known->second;
+			stats.skipped++;
+			continue;
+		}
+
+		Entry e;
+		e.name = *n;
+		e.size = st.st_size;
+		if (!hashFile(path, e.hash, error)) return false;
+		if (!storeFile(path, e.hash, e.size, stats, error)) return false;
+		stored[*n] = e;
+	}
+
+	// files of the manifest removed by compressCold stay listed
+	for (std::map<std::string, Entry>::const_iterator e = entries.begin(); e != entries.end(); e++) {
+		if (stored.count(e->first)) continue;
+		struct stat st;
+		if (stat(coldPath(e->second.hash).c_str(), &st) == 0 || stat(objectPath(e->second.hash).c_str(), &st) == 0)
+			stored[e->first] = e->second;
+	}
+
+	// a folder of folders (quarantine) gets no manifest
+	if (stored.empty() && entries.empty()) return true;
+	list.clear();
+	for (std::map<std::string, Entry>::const_iterator e = stored.begin(); e != stored.end(); e++) list.push_back(e->second);
+	return writeManifest(dir, list, error);
+}
+
+bool CaptureArchive::migrate(Stats& stats, std::string& error)
+{
+	std::vector<std::string> dirs;
+	if (!folders(dirs, error)) return false;
+	bool ok = true;
+	for (std::vector<std::string>::const_iterator d = dirs.begin(); d != dirs.end(); d++) {
+		std::string dirError;
+		if (store(*d, stats, dirError)) continue;
+		// the other folders are still stored, the first failure is reported
+		if (ok) error = dirError;
+		ok = false;
+	}
+	return ok;
+}
+
+bool CaptureArchive::restore(const std::string& dir, std::string& error)
+{
+	std::vector<Entry> entries;
+	if (!readManifest(dir, entries, error)) return false;
+	for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); e++) {
+		const std::string path = dir + "/" + e->name;
+		struct stat st;
+		if (lstat(path.c_str(), &st) == 0) continue;
+
+		const std::string object = objectPath(e->hash);
+		if (stat(object.c_str(), &st) != 0) {
+			// back from the gzipped copy, as a plain object again
+			const std::string cold = coldPath(e->hash);
+			gzFile in = gzopen(cold.c_str(), "rb");
+			if (!in) {
+				error = sysError("cannot read", cold);
+				return false;
+			}
+			const std::string tmp = object + ".tmp";
+			FILE* out = fopen(tmp.c_str(), "wb");
+			if (!out) {
+				gzclose(in);
+				error = sysError("cannot write", tmp);
+				return false;
+			}
+			std::vector<char> buf(CHUNK);
+			int n;
+			uint64_t size = 0;
+			while ((n = gzread(in, &buf[0], buf.size())) > 0) {
+				fwrite(&buf[0], 1, n, out);
+				size += n;
+			}
+			gzclose(in);
+			const bool written = fclose(out) == 0 && n == 0 && size == e->size;
+			if (!written || chmod(tmp.c_str(), 0444) != 0 || rename(tmp.c_str(), object.c_str()) != 0) {
+				error = "cannot restore " + object + " from " + cold;
+				unlink(tmp.c_str());
+				return false;
+			}
+			unlink(cold.c_str());
+		}
+		if (link(object.c_str(), path.c_str()) != 0 && !(errno == EXDEV && copyFile(object, path, 0444, error))) {
+			if (error.empty()) error = sysError("cannot link", path);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CaptureArchive::compressCold(uint64_t maxAge, Stats& stats, std::string& error)
+{
+	// the folder files of every object
+	std::map<std::string, std::vector<std::string> > links;
+	std::vector<std::string> dirs;
+	if (!folders(dirs, error)) return false;
+	for (std::vector<std::string>::const_iterator d = dirs.begin(); d != dirs.end(); d++) {
+		std::vector<Entry> entries;
+		if (!readManifest(*d, entries, error)) return false;
+		for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); e++)
+			links[e->hash].push_back(*d + "/" + e->name);
+	}
+
+	const time_t now = time(0);
+	std::vector<std::string> prefixes;
+	if (!listDir(objects_, true, prefixes, error)) return false;
+	for (std::vector<std::string>::const_iterator p = prefixes.begin(); p != prefixes.end(); p++) {
+		std::vector<std::string> names;
+		if (!listDir(objects_ + "/" + *p, false, names, error)) return false;
+		for (std::vector<std::string>::const_iterator n = names.begin(); n != names.end(); n++) {
+			if (n->size() != 32) continue;
+			const std::string object = objectPath(*n);
+			struct stat os;
+			if (stat(object.c_str(), &os) != 0 || uint64_t(now - os.st_mtime) < maxAge) continue;
+			stats.files++;
+			stats.bytes += os.st_size;
+
+			// only if the manifests know every link, or nothing is freed
+			std::vector<std::string> paths;
+			const std::vector<std::string>& candidates = links[*n];
+			for (std::vector<std::string>::const_iterator l = candidates.begin(); l != candidates.end(); l++) {
+				struct stat st;
+				if (lstat(l->c_str(), &st) == 0 && sameInode(os, st)) paths.push_back(*l);
+			}
+			if (os.st_nlink != paths.size() + 1) continue;
+
+			const std::string cold = coldPath(*n);
+			const std::string tmp = cold + ".tmp";
+			FILE* in = fopen(object.c_str(), "rb");
+			gzFile out = in ? gzopen(tmp.c_str(), "wb") : 0;
+			if (!out) {
+				if (in) fclose(in);
+				error = sysError("cannot compress", object);
+				return false;
+			}
+			std::vector<char> buf(CHUNK);
+			size_t k;
+			bool ok = true;
+			while ((k = fread(&buf[0], 1, buf.size(), in)) > 0)
+				if (gzwrite(out, &buf[0], k) != int(k)) { ok = false; break; }
+			fclose(in);
+			if (gzclose(out) != Z_OK) ok = false;
+
+			struct stat cs;
+			if (!ok || stat(tmp.c_str(), &cs) != 0) {
+				error = sysError("cannot compress", object);
+				unlink(tmp.c_str());
+				return false;
+			}
+			// ROOT files and PNGs are compressed already
+			if (cs.st_size*10 > os.st_size*9) {
+				unlink(tmp.c_str());
+				continue;
+			}
+			chmod(tmp.c_str(), 0444);
+			if (rename(tmp.c_str(), cold.c_str()) != 0) {
+				error = sysError("cannot write", cold);
+				unlink(tmp.c_str());
+				return false;
+			}
+			for (std::vector<std::string>::const_iterator l = paths.begin(); l != paths.end(); l++) unlink(l->c_str());
+			unlink(object.c_str());
+			stats.compressed++;
+			stats.savedBytes += os.st_size - cs.st_size;
+		}
+	}
+	return true;
+}
+
+bool CaptureArchive::usage(uint64_t& objects, uint64_t& stored, uint64_t& referenced, std::string& error) const
+{
+	objects = stored = referenced = 0;
+	std::vector<std::string> prefixes;
+	struct stat st;
+	if (stat(objects_.c_str(), &st) == 0 && !listDir(objects_, true, prefixes, error)) return false;
+	for (std::vector<std::string>::const_iterator p = prefixes.begin(); p != prefixes.end(); p++) {
+		std::vector<std::string> names;
+		if (!listDir(objects_ + "/" + *p, false, names, error)) return false;
+		for (std::vector<std::string>::const_iterator n = names.begin(); n != names.end(); n++) {
+			if (stat((objects_ + "/" + *p + "/" + *n).c_str(), &st) != 0) continue;
+			objects++;
+			stored += st.st_size;
+		}
+	}
+
+	std::vector<std::string> dirs;
+	if (!folders(dirs, error)) return false;
+	for (std::vector<std::string>::const_iterator d = dirs.begin(); d != dirs.end(); d++) {
+		std::vector<Entry> entries;
+		if (!readManifest(*d, entries, error)) return false;
+		for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); e++) referenced += e->size;
+	}
+	return true;
+}
@@ -0,0 +1,227 @@
+/*
+ * \file CaptureIndex.cc
+ *
+ * Sorted binary index of the archived captures.
+ *
+ */
+
+#include "CTP7Tests/CaptureTools/interface/CaptureIndex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TKey.h"
+#include "TList.h"
+
+using namespace ctp7idx;
+
+static const char INDEXMAGIC[8] = { 'C', 'T', 'P', '7', 'I', 'D', 'X', '1' };
+static const size_t HEADERBYTES = 16;
+
+static_assert(sizeof(CaptureRecord) == 256, "CaptureRecord is an on-disk layout");
+
+static bool earlier(const CaptureRecord& a, const CaptureRecord& b)
+{
+	return a.captureTime < b.captureTime;
+}
+
+CaptureIndex::CaptureIndex(const std::string& file) :
+	file_(file),
+	base_(0),
+	bytes_(0),
+	records_(0),
+	count_(0)
+{
+}
+
+CaptureIndex::~CaptureIndex()
+{
+	close();
+}
+
+void CaptureIndex::close()
+{
+	if (base_) munmap(base_, bytes_);
+	base_ = 0;
+	bytes_ = 0;
+	records_ = 0;
+	count_ = 0;
+}
+
+bool CaptureIndex::open(std::string& error)
+{
+	close();
+	int fd = ::open(file_.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT) return true;
+		error = "cannot open " + file_ + ": " + strerror(errno);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t) HEADERBYTES) {
+		::close(fd);
+		error = file_ + " is not a capture index";
+		return false;
+	}
+	void* p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		error = "cannot map " + file_ + ": " + strerror(errno);
+		return false;
+	}
+	base_ = p;
+	bytes_ = st.st_size;
+
+	const char* c = static_cast<const char*>(base_);
+	uint32_t head[2];
+	memcpy(head, c + 8, sizeof(head));
+	if (memcmp(c, INDEXMAGIC, 8) != 0 || head[0] != sizeof(CaptureRecord)
+	    || HEADERBYTES + (size_t) head[1]*sizeof(CaptureRecord) != bytes_) {
+		close();
+		error = file_ + " is not a capture index or is truncated";
+		return false;
+	}
+	records_ = reinterpret_cast<const CaptureRecord*>(c + HEADERBYTES);
+	count_ = head[1];
+	return true;
+}
+
+std::pair<size_t, size_t> CaptureIndex::timeRange(uint64_t since, uint64_t until) const
+{
+	CaptureRecord lo, hi;
+	lo.captureTime = since;
+	hi.captureTime = until;
+	const CaptureRecord* first = std::lower_bound(records_, records_ + count_, lo, earlier);
+	const CaptureRecord* last = std::lower_bound(first, records_ + count_, hi, earlier);
+	return std::make_pair(first - records_, last - records_);
+}
+
+bool CaptureIndex::insert(const CaptureRecord& record, std::string& error)
+{
+	// serialise writers on a lock file; readers only ever see renamed,
+	// complete files
+	const std::string lockName = file_ + ".lock";
+	int lock = ::open(lockName.c_str(), O_CREAT | O_RDWR, 0644);
+	if (lock < 0 || flock(lock, LOCK_EX) != 0) {
+		error = "cannot lock " + lockName + ": " + strerror(errno);
+		if (lock >= 0) ::close(lock);
+		return false;
+	}
+
+	bool ok = open(error);
+	std::vector<CaptureRecord> records;
+	if (ok) {
+		records.reserve(count_ + 1);
+		for (size_t i = 0; i < count_; i++)
+			if (strncmp(records_[i].dir, record.dir, sizeof(record.dir)) != 0) records.push_back(records_[i]);
+		close();
+		// captures are archived in time order, so this is nearly always an append
+		records.insert(std::upper_bound(records.begin(), records.end(), record, earlier), record);
+
+		const std::string tmp = file_ + ".tmp";
+		FILE* f = fopen(tmp.c_str(), "wb");
+		const uint32_t head[2] = { sizeof(CaptureRecord), static_cast<uint32_t>(records.size()) };
+		ok = f && fwrite(INDEXMAGIC, sizeof(INDEXMAGIC), 1, f) == 1
+			&& fwrite(head, sizeof(head), 1, f) == 1
+			&& fwrite(&records[0], sizeof(CaptureRecord), records.size(), f) == records.size();
+		if (f && fclose(f) != 0) ok = false;
+		if (ok) ok = rename(tmp.c_str(), file_.c_str()) == 0;
+		if (!ok) {
+			error = "cannot write " + file_ + ": " + strerror(errno);
+			unlink(tmp.c_str());
+		}
+	}
+
+	flock(lock, LOCK_UN);
+	::close(lock);
+	return ok;
+}
+
+// DQM int elements are stored as TObjStrings named <name>i=value</name>
+static bool readInt(TDirectory* dir, const std::string& name, int64_t& value)
+{
+	if (!dir || !dir->GetListOfKeys()) return false;
+	const std::string prefix = "<" + name + ">i=";
+	TIter next(dir->GetListOfKeys());
+	while (TObject* key = next()) {
+		const std::string tag = key->GetName();
+		if (tag.compare(0, prefix.size(), prefix) != 0) continue;
+		value = strtoll(tag.c_str() + prefix.size(), 0, 10);
+		return true;
+	}
+	return false;
+}
+
+bool readCaptureMetadata(const std::string& dir, const std::string& dqmFile,
+		CaptureRecord& record, std::string& error)
+{
+	const std::string path = dir + "/" + dqmFile;
+	TFile* f = TFile::Open(path.c_str(), "READ");
+	if (!f || f->IsZombie()) {
+		error = "cannot open " + path;
+		delete f;
+		return false;
+	}
+
+	TH1* info = dynamic_cast<TH1*>(f->Get("DQMData/L1T/LinkDQM/RctCaptureInfo"));
+	if (info && info->GetNbinsX() == 3) {
+		// captures, events, bad link events: a merged file describes no capture
+		if (info->GetBinContent(1) > 1) {
+			error = path + " is merged from several captures";
+			f->Close();
+			delete f;
+			return false;
+		}
+		record.events = static_cast<uint32_t>(info->GetBinContent(2));
+		record.badLinkEvents = static_cast<uint32_t>(info->GetBinContent(3));
+		TDirectory* linkDir = f->GetDirectory("DQMData/L1T/LinkDQM");
+		int64_t value;
+		if (readInt(linkDir, "RctCaptureRun", value)) record.run = static_cast<int32_t>(value);
+		if (readInt(linkDir, "RctCaptureDate", value)) record.date = static_cast<uint32_t>(value);
+		if (readInt(linkDir, "RctCaptureTime", value)) record.clock = static_cast<uint32_t>(value);
+	}
+	else if (info) {
+		// files written before the scalars: run, date, time, events, bad
+		// link events as bin contents, valid in per-capture files only
+		record.run = static_cast<int32_t>(info->GetBinContent(1));
+		record.date = static_cast<uint32_t>(info->GetBinContent(2));
+		record.clock = static_cast<uint32_t>(info->GetBinContent(3));
+		record.events = static_cast<uint32_t>(info->GetBinContent(4));
+		record.badLinkEvents = static_cast<uint32_t>(info->GetBinContent(5));
+	}
+
+	// second y bin of RctLinkMonitor2D counts the events with the link not 0xf
+	TH2* links = dynamic_cast<TH2*>(f->Get("DQMData/L1T/LinkDQM/RctLinkMonitor2D"));
+	if (links) {
+		record.nLinks = links->GetNbinsX();
+		for (int i = 0; i < links->GetNbinsX() && i < 64; i++)
+			if (links->GetBinContent(i + 1, 2) > 0) record.badLinkMask |= uint64_t(1) << i;
+	}
+
+	// RCTL1A fills one extra entry per event past ErrorTrigger, skip it
+	TH1* trigger = dynamic_cast<TH1*>(f->Get("DQMData/L1T/RCTL1A/TriggerType"));
+	if (!trigger) trigger = dynamic_cast<TH1*>(f->Get("DQMData/L1T/L1TCTP7/TriggerType"));
+	if (trigger) {
+		for (int t = 0; t < trigger->GetNbinsX() - 1 && t < 32; t++)
+			if (trigger->GetBinContent(t + 1) > 0) record.triggerTypes |= 1u << t;
+		if (!info) record.events = static_cast<uint32_t>(trigger->GetBinContent(trigger->GetNbinsX()));
+	}
+
+	record.flags |= HasDQM;
+	if (info && links && record.badLinkEvents == 0 && record.badLinkMask == 0) record.flags |= AllLinksGood;
+
+	f->Close();
+	delete f;
+	return true;
+}
@@ -0,0 +1,144 @@
+/*
+ * \file ctp7Compare.cc
+ *
+ * Compiled replacement of testFromDigis/macros/comparison.C: compares
+ * every histogram of a live DQM file with the reference (MC) file and
+ * writes a ranked summary and the live/reference ratio maps.
+ *
+ *   ctp7Compare [options] <live.root> <reference.root>
+ *     --folder F     folder inside both files (default DQMData/L1T/L1TCTP7)
+ *     --cache C      reference cache (default <reference.root>.refcache)
+ *     --threads N    worker threads (default: all cores)
+ *     --top N        lines in the printed summary (default 15)
+ *     --summary S    ranked summary text file (default comparison_summary.txt)
+ *     --ratios R     ROOT file with the ratio maps (default CTP7DQMComparison.root)
+ *
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <iostream>
+#include <sys/time.h>
+
+#include "TFile.h"
+#include "TH1F.h"
+#include "TH2F.h"
+
+#include "CTP7Tests/DQMCompare/interface/HistogramShape.h"
+#include "CTP7Tests/DQMCompare/interface/HistogramComparator.h"
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+static void usage()
+{
+	std::cout << "usage: ctp7Compare [--folder F] [--cache C] [--threads N] [--top N]"
+		" [--summary S] [--ratios R] <live.root> <reference.root>" << std::endl;
+}
+
+static void writeRatios(const std::string& file, const HistogramShapeCollection& reference,
+		const std::vector<ComparisonResult>& results)
+{
+	std::map<std::string, const HistogramShape*> byName;
+	for (size_t i = 0; i < reference.size(); i++) byName[reference[i].name] = &reference[i];
+
+	TFile out(file.c_str(), "RECREATE");
+	for (size_t i = 0; i < results.size(); i++) {
+		const ComparisonResult& r = results[i];
+		if (!r.compared) continue;
+		const HistogramShape& s = *byName[r.name];
+		TH1* h = 0;
+		if (s.dimension > 1)
+			h = new TH2F(r.name.c_str(), (r.name + " live/reference").c_str(),
+					s.nbinsX, s.xmin, s.xmax, s.nbinsY, s.ymin, s.ymax);
+		else
+			h = new TH1F(r.name.c_str(), (r.name + " live/reference").c_str(),
+					s.nbinsX, s.xmin, s.xmax);
+		for (size_t c = 0; c < r.ratio.size(); c++) h->SetBinContent(c, r.ratio[c]);
+		h->SetEntries(s.entries);
+		h->Write();
+		delete h;
+	}
+	out.Close();
+}
+
+int main(int argc, char** argv)
+{
+	std::string folder = "DQMData/L1T/L1TCTP7";
+	std::string cache, summary = "comparison_summary.txt", ratios = "CTP7DQMComparison.root";
+	unsigned int nThreads = 0, top = 15;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (a == "-h" || a == "--help") { usage(); return 0; }
+		else if (a == "--folder" && hasValue) folder = argv[++i];
+		else if (a == "--cache" && hasValue) cache = argv[++i];
+		else if (a == "--threads" && hasValue) nThreads = atoi(argv[++i]);
+		else if (a == "--top" && hasValue) top = atoi(argv[++i]);
+		else if (a == "--summary" && hasValue) summary = argv[++i];
+		else if (a == "--ratios" && hasValue) ratios = argv[++i];
+		else files.push_back(a);
+	}
+	if (files.size() != 2) {
+		usage();
+		return 1;
+	}
+	if (cache.empty()) cache = files[1] + ".refcache";
+
+	const double t0 = now();
+	std::string error;
+	HistogramShapeCollection reference, live;
+	if (!shapeio::loadReference(files[1], folder, cache, reference, error)) {
+		std::cerr << "ctp7Compare: " << error << std::endl;
+		return 2;
+	}
+	if (!error.empty()) std::cerr << "ctp7Compare: " << error << std::endl;
+	const double t1 = now();
+	if (!shapeio::readRootFolder(files[0], folder, live, error)) {
+		std::cerr << "ctp7Compare: " << error << std::endl;
+		return 2;
+	}
+	const double t2 = now();
+
+	HistogramComparator comparator(nThreads);
+	std::vector<ComparisonResult> results = comparator.compareAll(live, reference);
+	HistogramComparator::rank(results);
+	const double t3 = now();
+
+	std::ofstream sum(summary.c_str());
+	sum << "# rank name chi2 ndf chi2/ndf ksDistance ksProbability" << std::endl;
+	for (size_t i = 0; i < results.size(); i++) {
+		const ComparisonResult& r = results[i];
+		if (r.compared)
+			sum << i + 1 << " " << r.name << " " << r.chi2 << " " << r.ndf << " "
+				<< (r.ndf > 0 ? r.chi2/r.ndf : 0.) << " " << r.ksDistance << " "
+				<< r.ksProbability << std::endl;
+		else
+			sum << "- " << r.name << " not compared: " << r.reason << std::endl;
+	}
+
+	if (!ratios.empty()) writeRatios(ratios, reference, results);
+	const double t4 = now();
+
+	std::cout << "Most discrepant histograms (" << files[0] << " vs " << files[1] << "):" << std::endl;
+	for (size_t i = 0; i < results.size() && i < top; i++) {
+		const ComparisonResult& r = results[i];
+		if (!r.compared) break;
+		std::cout << std::setw(3) << i + 1 << "  " << std::setw(36) << std::left << r.name << std::right
+			<< "  chi2/ndf " << std::setw(10) << (r.ndf > 0 ? r.chi2/r.ndf : 0.)
+			<< "  KS prob " << r.ksProbability << std::endl;
+	}
+	std::cout << std::fixed << std::setprecision(3)
+		<< "reference " << t1 - t0 << " s, live " << t2 - t1 << " s, compare "
+		<< t3 - t2 << " s, output " << t4 - t3 << " s" << std::endl;
+	return 0;
+}
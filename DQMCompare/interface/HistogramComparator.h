@@ -0,0 +1,45 @@
+#ifndef HISTOGRAMCOMPARATOR_h
+#define HISTOGRAMCOMPARATOR_h
+
+#include <string>
+#include <vector>
+
+#include "CTP7Tests/DQMCompare/interface/HistogramShape.h"
+
+struct ComparisonResult
+{
+	std::string name;
+	bool compared;         // false if missing in one file or binning differs
+	std::string reason;
+	double chi2;           // two-sample chi2 of the unnormalised contents
+	int ndf;
+	double ksDistance;     // max distance of the cumulative shapes
+	double ksProbability;
+	double discrepancy;    // ranking key, larger is worse
+	std::vector<float> ratio; // live/reference per cell, as comparison.C
+
+	ComparisonResult() : compared(false), chi2(0), ndf(0), ksDistance(0),
+		ksProbability(1), discrepancy(0) { }
+};
+
+class HistogramComparator
+{
+public:
+	explicit HistogramComparator(unsigned int nThreads = 0);
+
+	// compare every reference histogram with the live one of the same name;
+	// pairs are spread over the worker threads
+	std::vector<ComparisonResult> compareAll(const HistogramShapeCollection& live,
+			const HistogramShapeCollection& reference) const;
+
+	static void compare(const HistogramShape& live, const HistogramShape& ref,
+			ComparisonResult& out);
+
+	// results sorted by decreasing discrepancy, uncompared ones last
+	static void rank(std::vector<ComparisonResult>& results);
+
+private:
+	unsigned int nThreads_;
+};
+
+#endif
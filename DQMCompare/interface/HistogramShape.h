@@ -0,0 +1,52 @@
+#ifndef HISTOGRAMSHAPE_h
+#define HISTOGRAMSHAPE_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// A histogram reduced to what the comparison needs: binning, integral and
+// the unit-normalised cell contents (ROOT cell order, under/overflow
+// included). Reference shapes are cached on disk in this form.
+struct HistogramShape
+{
+	std::string name;
+	uint32_t dimension;
+	uint32_t nbinsX;
+	uint32_t nbinsY;
+	double xmin;
+	double xmax;
+	double ymin;
+	double ymax;
+	double integral;       // sum of the in-range cells before normalisation
+	double entries;
+	std::vector<float> shape;
+
+	size_t nCells() const { return shape.size(); }
+	bool isInRange(size_t cell) const;
+	bool sameBinning(const HistogramShape& o) const;
+};
+
+typedef std::vector<HistogramShape> HistogramShapeCollection;
+
+namespace shapeio {
+
+// read every TH1/TH2 of folder in a ROOT file (e.g. "DQMData/L1T/L1TCTP7")
+bool readRootFolder(const std::string& file, const std::string& folder,
+		HistogramShapeCollection& out, std::string& error);
+
+// compact binary cache of reference shapes, valid for one source file
+// (size and modification time) and folder
+bool writeCache(const std::string& cache, const std::string& source,
+		const std::string& folder, const HistogramShapeCollection& shapes);
+bool readCache(const std::string& cache, const std::string& source,
+		const std::string& folder, HistogramShapeCollection& out);
+
+// cache if it matches the reference file, otherwise re-read the
+// ROOT file and refresh the cache
+bool loadReference(const std::string& file, const std::string& folder,
+		const std::string& cache, HistogramShapeCollection& out, std::string& error);
+
+}
+
+#endif
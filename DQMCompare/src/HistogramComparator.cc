@@ -0,0 +1,143 @@
+/*
+ * \file HistogramComparator.cc
+ *
+ * Parallel live vs reference comparison of normalised shapes.
+ *
+ */
+
+#include "CTP7Tests/DQMCompare/interface/HistogramComparator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <thread>
+
+#include "TMath.h"
+
+namespace {
+
+bool byDiscrepancy(const ComparisonResult& a, const ComparisonResult& b)
+{
+	if (a.compared != b.compared) return a.compared;
+	return a.discrepancy > b.discrepancy;
+}
+
+// max distance of the cumulative in-range shapes, walking the cells in
+// the given order (x fastest, or y fastest for 2D)
+double ksDistance(const HistogramShape& a, const HistogramShape& b, bool yFirst)
+{
+	const size_t nx = a.nbinsX, ny = a.dimension > 1 ? a.nbinsY : 1;
+	const size_t stride = a.nbinsX + 2;
+	const size_t off = a.dimension > 1 ? stride : 0;
+	double ca = 0, cb = 0, dmax = 0;
+	for (size_t i = 0; i < (yFirst ? nx : ny); i++) {
+		for (size_t j = 0; j < (yFirst ? ny : nx); j++) {
+			const size_t ix = (yFirst ? i : j) + 1;
+			const size_t iy = yFirst ? j : i;
+			const size_t c = off + iy*stride + ix;
+			ca += a.shape[c];
+			cb += b.shape[c];
+			dmax = std::max(dmax, std::fabs(ca - cb));
+		}
+	}
+	return dmax;
+}
+
+}
+
+HistogramComparator::HistogramComparator(unsigned int nThreads) :
+	nThreads_(nThreads)
+{
+	if (nThreads_ == 0) nThreads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void HistogramComparator::compare(const HistogramShape& live, const HistogramShape& ref,
+		ComparisonResult& out)
+{
+	out.name = ref.name;
+	if (!live.sameBinning(ref)) {
+		out.reason = "binning differs";
+		return;
+	}
+	out.compared = true;
+
+	const double n1 = live.integral, n2 = ref.integral;
+	const size_t n = ref.nCells();
+	out.ratio.assign(n, 0.f);
+
+	// two-sample chi2 (unweighted-unweighted) from the normalised shapes:
+	// sum N1*N2*(p-q)^2/(N1*p + N2*q)
+	double chi2 = 0;
+	int nonEmpty = 0;
+	for (size_t c = 0; c < n; c++) {
+		const double p = live.shape[c], q = ref.shape[c];
+		const double liveCount = p*n1, refCount = q*n2;
+		if (refCount > 0) {
+			out.ratio[c] = liveCount/refCount;
+			// empty live bins stay visible in the ratio map, as in comparison.C
+			if (liveCount == 0) out.ratio[c] = 0.01;
+		}
+		if (!live.isInRange(c)) continue;
+		const double sum = liveCount + refCount;
+		if (sum <= 0) continue;
+		nonEmpty++;
+		chi2 += n1*n2*(p - q)*(p - q)/sum;
+	}
+	out.chi2 = chi2;
+	out.ndf = std::max(0, nonEmpty - 1);
+
+	if (n1 > 0 && n2 > 0) {
+		double d = ksDistance(live, ref, false);
+		if (live.dimension > 1) d = 0.5*(d + ksDistance(live, ref, true));
+		out.ksDistance = d;
+		// effective number of entries, as TH1::KolmogorovTest
+		const double e1 = live.entries > 0 ? live.entries : n1;
+		const double e2 = ref.entries > 0 ? ref.entries : n2;
+		out.ksProbability = TMath::KolmogorovProb(d*std::sqrt(e1*e2/(e1 + e2)));
+	}
+	else {
+		out.ksDistance = (n1 > 0) != (n2 > 0) ? 1. : 0.;
+		out.ksProbability = (n1 > 0) != (n2 > 0) ? 0. : 1.;
+	}
+
+	out.discrepancy = out.ndf > 0 ? out.chi2/out.ndf : 0.;
+	if (out.ksProbability < 1e-3) out.discrepancy += 1e3*(1e-3 - out.ksProbability);
+}
+
+std::vector<ComparisonResult> HistogramComparator::compareAll(const HistogramShapeCollection& live,
+		const HistogramShapeCollection& reference) const
+{
+	std::map<std::string, const HistogramShape*> byName;
+	for (size_t i = 0; i < live.size(); i++) byName[live[i].name] = &live[i];
+
+	std::vector<ComparisonResult> results(reference.size());
+	std::vector<const HistogramShape*> partner(reference.size(), 0);
+	for (size_t i = 0; i < reference.size(); i++) {
+		std::map<std::string, const HistogramShape*>::const_iterator it = byName.find(reference[i].name);
+		if (it != byName.end()) partner[i] = it->second;
+		else {
+			results[i].name = reference[i].name;
+			results[i].reason = "missing in live file";
+		}
+	}
+
+	// work stealing over the pairs, the big VsEvt maps dominate the cost
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	const unsigned int nWorkers = std::min<size_t>(nThreads_, std::max<size_t>(1, reference.size()));
+	for (unsigned int t = 0; t < nWorkers; t++) {
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < reference.size(); i = next++)
+				if (partner[i]) compare(*partner[i], reference[i], results[i]);
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+	return results;
+}
+
+void HistogramComparator::rank(std::vector<ComparisonResult>& results)
+{
+	std::stable_sort(results.begin(), results.end(), byDiscrepancy);
+}
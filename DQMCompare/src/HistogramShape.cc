@@ -0,0 +1,198 @@
+/*
+ * \file HistogramShape.cc
+ *
+ * Loading of DQM histograms as normalised shapes, and the binary
+ * reference cache.
+ *
+ */
+
+#include "CTP7Tests/DQMCompare/interface/HistogramShape.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include <sys/stat.h>
+
+#include "TFile.h"
+#include "TDirectory.h"
+#include "TKey.h"
+#include "TH1.h"
+
+namespace {
+
+const char kCacheMagic[8] = { 'C', 'T', 'P', '7', 'R', 'E', 'F', '1' };
+
+struct SourceStamp
+{
+	int64_t size;
+	int64_t mtime;
+};
+
+bool stampOf(const std::string& file, SourceStamp& s)
+{
+	struct stat st;
+	if (stat(file.c_str(), &st) != 0) return false;
+	s.size = st.st_size;
+	s.mtime = st.st_mtime;
+	return true;
+}
+
+template <class T> bool put(FILE* f, const T& v) { return fwrite(&v, sizeof(T), 1, f) == 1; }
+template <class T> bool get(FILE* f, T& v) { return fread(&v, sizeof(T), 1, f) == 1; }
+
+}
+
+bool HistogramShape::isInRange(size_t cell) const
+{
+	const size_t nx = nbinsX + 2;
+	const size_t ix = cell % nx;
+	if (ix == 0 || ix == nx - 1) return false;
+	if (dimension < 2) return true;
+	const size_t iy = cell / nx;
+	return iy != 0 && iy != nbinsY + 1;
+}
+
+bool HistogramShape::sameBinning(const HistogramShape& o) const
+{
+	return dimension == o.dimension && nbinsX == o.nbinsX && nbinsY == o.nbinsY
+		&& xmin == o.xmin && xmax == o.xmax && ymin == o.ymin && ymax == o.ymax;
+}
+
+bool shapeio::readRootFolder(const std::string& file, const std::string& folder,
+		HistogramShapeCollection& out, std::string& error)
+{
+	std::unique_ptr<TFile> f(TFile::Open(file.c_str(), "READ"));
+	if (!f || f->IsZombie()) {
+		error = "cannot open " + file;
+		return false;
+	}
+	TDirectory* dir = f->GetDirectory(folder.c_str());
+	if (!dir) {
+		error = "no folder " + folder + " in " + file;
+		return false;
+	}
+
+	out.clear();
+	TIter next(dir->GetListOfKeys());
+	while (TKey* key = static_cast<TKey*>(next())) {
+		std::unique_ptr<TObject> obj(key->ReadObj());
+		const TH1* h = dynamic_cast<const TH1*>(obj.get());
+		if (!h || h->GetDimension() > 2) continue;
+
+		HistogramShape s;
+		s.name = key->GetName();
+		s.dimension = h->GetDimension();
+		s.nbinsX = h->GetNbinsX();
+		s.nbinsY = s.dimension > 1 ? h->GetNbinsY() : 0;
+		s.xmin = h->GetXaxis()->GetXmin();
+		s.xmax = h->GetXaxis()->GetXmax();
+		s.ymin = s.dimension > 1 ? h->GetYaxis()->GetXmin() : 0.;
+		s.ymax = s.dimension > 1 ? h->GetYaxis()->GetXmax() : 0.;
+		s.entries = h->GetEntries();
+
+		const int n = h->GetNcells();
+		s.shape.resize(n);
+		s.integral = 0.;
+		for (int c = 0; c < n; c++) {
+			s.shape[c] = h->GetBinContent(c);
+			if (s.isInRange(c)) s.integral += s.shape[c];
+		}
+		if (s.integral > 0) {
+			const double norm = 1./s.integral;
+			for (int c = 0; c < n; c++) s.shape[c] *= norm;
+		}
+		out.push_back(s);
+	}
+	return true;
+}
+
+bool shapeio::writeCache(const std::string& cache, const std::string& source,
+		const std::string& folder, const HistogramShapeCollection& shapes)
+{
+	SourceStamp stamp;
+	if (!stampOf(source, stamp)) return false;
+
+	const std::string tmp = cache + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "wb");
+	if (!f) return false;
+
+	bool ok = fwrite(kCacheMagic, sizeof(kCacheMagic), 1, f) == 1
+		&& put(f, stamp) && put(f, uint32_t(folder.size()))
+		&& fwrite(folder.data(), 1, folder.size(), f) == folder.size()
+		&& put(f, uint32_t(shapes.size()));
+	for (size_t i = 0; ok && i < shapes.size(); i++) {
+		const HistogramShape& s = shapes[i];
+		ok = put(f, uint32_t(s.name.size()))
+			&& fwrite(s.name.data(), 1, s.name.size(), f) == s.name.size()
+			&& put(f, s.dimension) && put(f, s.nbinsX) && put(f, s.nbinsY)
+			&& put(f, s.xmin) && put(f, s.xmax) && put(f, s.ymin) && put(f, s.ymax)
+			&& put(f, s.integral) && put(f, s.entries)
+			&& put(f, uint64_t(s.shape.size()))
+			&& (s.shape.empty() || fwrite(&s.shape[0], sizeof(float), s.shape.size(), f) == s.shape.size());
+	}
+	ok = (fclose(f) == 0) && ok;
+	if (!ok || rename(tmp.c_str(), cache.c_str()) != 0) {
+		remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool shapeio::readCache(const std::string& cache, const std::string& source,
+		const std::string& folder, HistogramShapeCollection& out)
+{
+	SourceStamp now;
+	if (!stampOf(source, now)) return false;
+
+	FILE* f = fopen(cache.c_str(), "rb");
+	if (!f) return false;
+
+	char magic[sizeof(kCacheMagic)];
+	SourceStamp stamp;
+	uint32_t folderLen = 0;
+	std::string cachedFolder;
+	uint32_t n = 0;
+	bool ok = fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, kCacheMagic, sizeof(magic))
+		&& get(f, stamp) && stamp.size == now.size && stamp.mtime == now.mtime
+		&& get(f, folderLen) && folderLen == folder.size();
+	if (ok && folderLen) {
+		cachedFolder.resize(folderLen);
+		ok = fread(&cachedFolder[0], 1, folderLen, f) == folderLen && cachedFolder == folder;
+	}
+	ok = ok && get(f, n);
+
+	out.clear();
+	for (uint32_t i = 0; ok && i < n; i++) {
+		HistogramShape s;
+		uint32_t len = 0;
+		uint64_t cells = 0;
+		ok = get(f, len) && len < 4096;
+		if (ok) {
+			s.name.resize(len);
+			ok = fread(&s.name[0], 1, len, f) == len;
+		}
+		ok = ok && get(f, s.dimension) && get(f, s.nbinsX) && get(f, s.nbinsY)
+			&& get(f, s.xmin) && get(f, s.xmax) && get(f, s.ymin) && get(f, s.ymax)
+			&& get(f, s.integral) && get(f, s.entries) && get(f, cells)
+			&& cells == uint64_t(s.nbinsX + 2)*(s.dimension > 1 ? s.nbinsY + 2 : 1);
+		if (ok) {
+			s.shape.resize(cells);
+			ok = cells == 0 || fread(&s.shape[0], sizeof(float), cells, f) == cells;
+		}
+		if (ok) out.push_back(s);
+	}
+	fclose(f);
+	if (!ok) out.clear();
+	return ok;
+}
+
+bool shapeio::loadReference(const std::string& file, const std::string& folder,
+		const std::string& cache, HistogramShapeCollection& out, std::string& error)
+{
+	if (!cache.empty() && readCache(cache, file, folder, out)) return true;
+	if (!readRootFolder(file, folder, out, error)) return false;
+	if (!cache.empty() && !writeCache(cache, file, folder, out))
+		error = "could not write reference cache " + cache;
+	return true;
+}
@@ -0,0 +1,97 @@
+/*
+ * \file ctp7Columns.cc
+ *
+ * Reads the per-event column files written by L1TCTP7 (eventSummaryFile).
+ *
+ *   ctp7Columns <file>                    list the columns and row count
+ *   ctp7Columns --stats <file> [col...]   min/max/mean of the columns
+ *   ctp7Columns <file> col [col...]       print the columns, one row per line
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "CTP7Tests/EventColumns/interface/ColumnFile.h"
+
+static void usage()
+{
+	std::cout << "usage: ctp7Columns [--stats] <file> [column ...]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	bool stats = false;
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) { usage(); return 0; }
+		else if (!strcmp(argv[i], "--stats")) stats = true;
+		else args.push_back(argv[i]);
+	}
+	if (args.empty()) {
+		usage();
+		return 1;
+	}
+
+	ColumnFileReader reader;
+	std::string error;
+	if (!reader.open(args[0], error)) {
+		std::cerr << "ctp7Columns: " << error << std::endl;
+		return 2;
+	}
+
+	const char* typeNames[] = { "uint32", "uint64", "float32" };
+	if (args.size() == 1 && !stats) {
+		std::cout << args[0] << ": " << reader.rows() << " rows" << std::endl;
+		for (size_t c = 0; c < reader.columns().size(); c++)
+			std::cout << "  " << reader.columns()[c].name << " (" << typeNames[reader.columns()[c].type % 3] << ")" << std::endl;
+		return 0;
+	}
+
+	std::vector<unsigned int> selected;
+	if (args.size() == 1)
+		for (size_t c = 0; c < reader.columns().size(); c++) selected.push_back(c);
+	for (size_t i = 1; i < args.size(); i++) {
+		int c = reader.find(args[i]);
+		if (c < 0) {
+			std::cerr << "ctp7Columns: no column " << args[i] << " in " << args[0] << std::endl;
+			return 1;
+		}
+		selected.push_back(c);
+	}
+
+	std::vector<std::vector<double> > values(selected.size());
+	for (size_t i = 0; i < selected.size(); i++) {
+		if (!reader.read(selected[i], values[i])) {
+			std::cerr << "ctp7Columns: cannot read column " << reader.columns()[selected[i]].name << std::endl;
+			return 2;
+		}
+	}
+
+	if (stats) {
+		std::cout << "# column min max mean (" << reader.rows() << " rows)" << std::endl;
+		for (size_t i = 0; i < selected.size(); i++) {
+			const std::vector<double>& v = values[i];
+			double lo = 0., hi = 0., sum = 0.;
+			for (size_t r = 0; r < v.size(); r++) {
+				if (r == 0 || v[r] < lo) lo = v[r];
+				if (r == 0 || v[r] > hi) hi = v[r];
+				sum += v[r];
+			}
+			std::cout << reader.columns()[selected[i]].name << " " << lo << " " << hi << " "
+				<< (v.empty() ? 0. : sum/v.size()) << std::endl;
+		}
+		return 0;
+	}
+
+	std::cout << "#";
+	for (size_t i = 0; i < selected.size(); i++) std::cout << " " << reader.columns()[selected[i]].name;
+	std::cout << std::endl;
+	std::cout.precision(12);
+	for (uint64_t r = 0; r < reader.rows(); r++) {
+		for (size_t i = 0; i < selected.size(); i++) std::cout << (i ? " " : "") << values[i][r];
+		std::cout << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+#ifndef COLUMNFILE_h
+#define COLUMNFILE_h
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Columnar per-event side file. Rows are grouped in blocks; inside a
+// block every column is stored as its own zlib-compressed chunk
+// (integer columns delta-encoded first), so a scan of one column reads
+// and inflates only that column's chunks.
+//
+//   "CTP7COL1" | uint32 nColumns | uint32 blockRows | ColumnInfo[nColumns]
+//   chunks...
+//   footer: uint64 nBlocks | { uint32 nRows | ChunkRef[nColumns] }[nBlocks]
+//   uint64 footerOffset | "CTP7COLE"
+//
+// The reader mmaps the file and only touches the header, the footer and
+// the chunks it is asked for.
+namespace ctp7col {
+
+	enum ColumnType { UInt32 = 0, UInt64 = 1, Float32 = 2 };
+
+	struct ColumnInfo {
+		char name[32];
+		uint32_t type;
+		uint32_t width;   // bytes per value
+	};
+
+	struct ChunkRef {
+		uint64_t offset;
+		uint32_t compressedBytes;
+		uint32_t rawBytes;
+	};
+
+	inline uint32_t typeWidth(ColumnType t) { return t == UInt64 ? 8 : 4; }
+
+}
+
+class ColumnFileWriter
+{
+public:
+	explicit ColumnFileWriter(const std::string& file, unsigned int blockRows = 4096);
+	~ColumnFileWriter();
+
+	// columns are declared before open(); returns the column index
+	unsigned int addColumn(const std::string& name, ctp7col::ColumnType type);
+
+	bool open();
+	bool isOpen() const { return file_ != 0; }
+
+	// values of the current row; unset columns repeat the previous row
+	void set(unsigned int column, uint64_t value);
+	void set(unsigned int column, double value);
+	void endRow();
+
+	// flushes the last block and writes the footer
+	bool close();
+
+	uint64_t rows() const { return rows_; }
+
+private:
+	ColumnFileWriter(const ColumnFileWriter&);
+	ColumnFileWriter& operator=(const ColumnFileWriter&);
+
+	bool flushBlock();
+
+	std::string fileName_;
+	unsigned int blockRows_;
+	FILE* file_;
+	bool failed_;
+	uint64_t rows_;
+
+	std::vector<ctp7col::ColumnInfo> columns_;
+	std::vector<std::vector<unsigned char> > block_;   // raw values per column
+	std::vector<uint64_t> current_;                    // current row, as bits
+	unsigned int blockFill_;
+
+	std::vector<uint32_t> blockRowsIndex_;
+	std::vector<ctp7col::ChunkRef> chunks_;            // [block*nColumns + column]
+};
+
+class ColumnFileReader
+{
+public:
+	ColumnFileReader();
+	~ColumnFileReader();
+
+	bool open(const std::string& file, std::string& error);
+	void close();
+
+	uint64_t rows() const { return rows_; }
+	const std::vector<ctp7col::ColumnInfo>& columns() const { return columns_; }
+	int find(const std::string& name) const;
+
+	// whole column, converted; false if the column is unknown or corrupt
+	bool read(unsigned int column, std::vector<double>& out) const;
+	bool read(unsigned int column, std::vector<uint64_t>& out) const;
+
+private:
+	ColumnFileReader(const ColumnFileReader&);
+	ColumnFileReader& operator=(const ColumnFileReader&);
+
+	bool inflateChunk(unsigned int block, unsigned int column, std::vector<unsigned char>& raw) const;
+
+	const unsigned char* base_;
+	size_t bytes_;
+	uint64_t rows_;
+	std::vector<ctp7col::ColumnInfo> columns_;
+	std::vector<uint32_t> blockRows_;
+	std::vector<ctp7col::ChunkRef> chunks_;
+};
+
+#endif
@@ -0,0 +1,347 @@
+/*
+ * \file ColumnFile.cc
+ *
+ * Block/column compressed per-event side file.
+ *
+ */
+
+#include "CTP7Tests/EventColumns/interface/ColumnFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace ctp7col;
+
+static const char HEADERMAGIC[8] = { 'C', 'T', 'P', '7', 'C', 'O', 'L', '1' };
+static const char FOOTERMAGIC[8] = { 'C', 'T', 'P', '7', 'C', 'O', 'L', 'E' };
+
+// delta-encode integer columns in place; differences of a slowly
+// changing column (run, time, event) compress to almost nothing
+template <class T> static void deltaEncode(unsigned char* data, size_t n)
+{
+	T* v = reinterpret_cast<T*>(data);
+	for (size_t i = n; i-- > 1; ) v[i] -= v[i - 1];
+}
+
+template <class T> static void deltaDecode(unsigned char* data, size_t n)
+{
+	T* v = reinterpret_cast<T*>(data);
+	for (size_t i = 1; i < n; i++) v[i] += v[i - 1];
+}
+
+ColumnFileWriter::ColumnFileWriter(const std::string& file, unsigned int blockRows) :
+	fileName_(file),
+	blockRows_(blockRows ? blockRows : 4096),
+	file_(0),
+	failed_(false),
+	rows_(0),
+	blockFill_(0)
+{
+}
+
+ColumnFileWriter::~ColumnFileWriter()
+{
+	close();
+}
+
+unsigned int ColumnFileWriter::addColumn(const std::string& name, ColumnType type)
+{
+	ColumnInfo c;
+	memset(&c, 0, sizeof(c));
+	strncpy(c.name, name.c_str(), sizeof(c.name) - 1);
+	c.type = type;
+	c.width = typeWidth(type);
+	if (!file_) columns_.push_back(c);
+	return columns_.size() - 1;
+}
+
+bool ColumnFileWriter::open()
+{
+	if (file_) return true;
+	file_ = fopen(fileName_.c_str(), "wb");
+	if (!file_) {
+		std::cout << "ColumnFileWriter: cannot create " << fileName_ << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	const uint32_t head[2] = { static_cast<uint32_t>(columns_.size()), blockRows_ };
+	failed_ = fwrite(HEADERMAGIC, sizeof(HEADERMAGIC), 1, file_) != 1
+		|| fwrite(head, sizeof(head), 1, file_) != 1
+		|| (columns_.size() && fwrite(&columns_[0], sizeof(ColumnInfo), columns_.size(), file_) != columns_.size());
+
+	block_.assign(columns_.size(), std::vector<unsigned char>());
+	for (size_t c = 0; c < columns_.size(); c++) block_[c].reserve(blockRows_*columns_[c].width);
+	current_.assign(columns_.size(), 0);
+	return !failed_;
+}
+
+void ColumnFileWriter::set(unsigned int column, uint64_t value)
+{
+	if (column >= current_.size()) return;
+	if (columns_[column].type == Float32) {
+		set(column, static_cast<double>(value));
+		return;
+	}
+	current_[column] = value;
+}
+
+void ColumnFileWriter::set(unsigned int column, double value)
+{
+	if (column >= current_.size()) return;
+	if (columns_[column].type != Float32) {
+		current_[column] = value > 0 ? static_cast<uint64_t>(value) : 0;
+		return;
+	}
+	float f = value;
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	current_[column] = bits;
+}
+
+void ColumnFileWriter::endRow()
+{
+	if (!file_) return;
+	for (size_t c = 0; c < columns_.size(); c++) {
+		std::vector<unsigned char>& b = block_[c];
+		const size_t at = b.size();
+		b.resize(at + columns_[c].width);
+		if (columns_[c].width == 8) {
+			const uint64_t v = current_[c];
+			memcpy(&b[at], &v, 8);
+		}
+		else {
+			const uint32_t v = current_[c];
+			memcpy(&b[at], &v, 4);
+		}
+	}
+	rows_++;
+	if (++blockFill_ == blockRows_) flushBlock();
+}
+
+bool ColumnFileWriter::flushBlock()
+{
+	if (!file_ || blockFill_ == 0) return !failed_;
+
+	std::vector<unsigned char> packed;
+	for (size_t c = 0; c < columns_.size(); c++) {
+		std::vector<unsigned char>& raw = block_[c];
+		if (columns_[c].type == UInt32) deltaEncode<uint32_t>(&raw[0], blockFill_);
+		else if (columns_[c].type == UInt64) deltaEncode<uint64_t>(&raw[0], blockFill_);
+
+		uLongf packedBytes = compressBound(raw.size());
+		packed.resize(packedBytes);
+		if (compress2(&packed[0], &packedBytes, &raw[0], raw.size(), Z_BEST_SPEED) != Z_OK) failed_ = true;
+
+		ChunkRef ref;
+		ref.offset = ftello(file_);
+		ref.compressedBytes = packedBytes;
+		ref.rawBytes = raw.size();
+		chunks_.push_back(ref);
+		if (fwrite(&packed[0], 1, packedBytes, file_) != packedBytes) failed_ = true;
+		raw.clear();
+	}
+	blockRowsIndex_.push_back(blockFill_);
+	blockFill_ = 0;
+	return !failed_;
+}
+
+bool ColumnFileWriter::close()
+{
+	if (!file_) return !failed_;
+	flushBlock();
+
+	const uint64_t footerOffset = ftello(file_);
+	const uint64_t nBlocks = blockRowsIndex_.size();
+	failed_ |= fwrite(&nBlocks, sizeof(nBlocks), 1, file_) != 1;
+	for (size_t b = 0; b < nBlocks; b++) {
+		failed_ |= fwrite(&blockRowsIndex_[b], sizeof(uint32_t), 1, file_) != 1;
+		failed_ |= fwrite(&chunks_[b*columns_.size()], sizeof(ChunkRef), columns_.size(), file_) != columns_.size();
+	}
+	failed_ |= fwrite(&footerOffset, sizeof(footerOffset), 1, file_) != 1;
+	failed_ |= fwrite(FOOTERMAGIC, sizeof(FOOTERMAGIC), 1, file_) != 1;
+	failed_ |= fclose(file_) != 0;
+	file_ = 0;
+
+	if (failed_)
+		std::cout << "ColumnFileWriter: write error on " << fileName_ << ", file is incomplete" << std::endl;
+	return !failed_;
+}
+
+ColumnFileReader::ColumnFileReader() :
+	base_(0),
+	bytes_(0),
+	rows_(0)
+{
+}
+
+ColumnFileReader::~ColumnFileReader()
+{
+	close();
+}
+
+void ColumnFileReader::close()
+{
+	if (base_) munmap(const_cast<unsigned char*>(base_), bytes_);
+	base_ = 0;
+	bytes_ = 0;
+	rows_ = 0;
+	columns_.clear();
+	blockRows_.clear();
+	chunks_.clear();
+}
+
+bool ColumnFileReader::open(const std::string& file, std::string& error)
+{
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		error = "cannot open " + file + ": " + strerror(errno);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 32) {
+		error = file + " is not a column file";
+		::close(fd);
+		return false;
+	}
+	void* p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		error = "cannot map " + file + ": " + strerror(errno);
+		return false;
+	}
+	base_ = static_cast<const unsigned char*>(p);
+	bytes_ = st.st_size;
+
+	const unsigned char* end = base_ + bytes_;
+	if (memcmp(base_, HEADERMAGIC, 8) != 0 || memcmp(end - 8, FOOTERMAGIC, 8) != 0) {
+		error = file + " is not a complete column file";
+		close();
+		return false;
+	}
+	uint32_t head[2];
+	memcpy(head, base_ + 8, sizeof(head));
+	const size_t nColumns = head[0];
+	if (16 + nColumns*sizeof(ColumnInfo) > bytes_) {
+		error = file + ": corrupt header";
+		close();
+		return false;
+	}
+	columns_.resize(nColumns);
+	if (nColumns) memcpy(&columns_[0], base_ + 16, nColumns*sizeof(ColumnInfo));
+
+	uint64_t footerOffset, nBlocks;
+	memcpy(&footerOffset, end - 16, 8);
+	const size_t blockIndexBytes = sizeof(uint32_t) + nColumns*sizeof(ChunkRef);
+	if (footerOffset + 8 > bytes_ - 16) {
+		error = file + ": corrupt footer";
+		close();
+		return false;
+	}
+	memcpy(&nBlocks, base_ + footerOffset, 8);
+	if (footerOffset + 8 + nBlocks*blockIndexBytes != bytes_ - 16) {
+		error = file + ": corrupt footer";
+		close();
+		return false;
+	}
+	const unsigned char* q = base_ + footerOffset + 8;
+	blockRows_.resize(nBlocks);
+	chunks_.resize(nBlocks*nColumns);
+	for (size_t b = 0; b < nBlocks; b++) {
+		memcpy(&blockRows_[b], q, sizeof(uint32_t));
+		if (nColumns) memcpy(&chunks_[b*nColumns], q + sizeof(uint32_t), nColumns*sizeof(ChunkRef));
+		q += blockIndexBytes;
+		rows_ += blockRows_[b];
+	}
+	return true;
+}
+
+int ColumnFileReader::find(const std::string& name) const
+{
+	for (size_t c = 0; c < columns_.size(); c++)
+		if (name == columns_[c].name) return c;
+	return -1;
+}
+
+bool ColumnFileReader::inflateChunk(unsigned int block, unsigned int column, std::vector<unsigned char>& raw) const
+{
+	const ColumnInfo& info = columns_[column];
+	const ChunkRef& ref = chunks_[block*columns_.size() + column];
+	if (ref.offset + ref.compressedBytes > bytes_ || ref.rawBytes != blockRows_[block]*info.width)
+		return false;
+	raw.resize(ref.rawBytes);
+	uLongf rawBytes = ref.rawBytes;
+	if (uncompress(&raw[0], &rawBytes, base_ + ref.offset, ref.compressedBytes) != Z_OK
+	    || rawBytes != ref.rawBytes)
+		return false;
+	if (info.type == UInt32) deltaDecode<uint32_t>(&raw[0], blockRows_[block]);
+	else if (info.type == UInt64) deltaDecode<uint64_t>(&raw[0], blockRows_[block]);
+	return true;
+}
+
+bool ColumnFileReader::read(unsigned int column, std::vector<double>& out) const
+{
+	out.clear();
+	if (column >= columns_.size()) return false;
+	out.reserve(rows_);
+	std::vector<unsigned char> raw;
+	const uint32_t type = columns_[column].type;
+	for (size_t b = 0; b < blockRows_.size(); b++) {
+		if (!inflateChunk(b, column, raw)) return false;
+		for (size_t i = 0; i < blockRows_[b]; i++) {
+			if (type == Float32) {
+				float f;
+				memcpy(&f, &raw[4*i], 4);
+				out.push_back(f);
+			}
+			else if (type == UInt64) {
+				uint64_t v;
+				memcpy(&v, &raw[8*i], 8);
+				out.push_back(v);
+			}
+			else {
+				uint32_t v;
+				memcpy(&v, &raw[4*i], 4);
+				out.push_back(v);
+			}
+		}
+	}
+	return true;
+}
+
+bool ColumnFileReader::read(unsigned int column, std::vector<uint64_t>& out) const
+{
+	out.clear();
+	if (column >= columns_.size()) return false;
+	if (columns_[column].type == Float32) {
+		std::vector<double> values;
+		if (!read(column, values)) return false;
+		out.assign(values.begin(), values.end());
+		return true;
+	}
+	out.reserve(rows_);
+	std::vector<unsigned char> raw;
+	const bool wide = columns_[column].type == UInt64;
+	for (size_t b = 0; b < blockRows_.size(); b++) {
+		if (!inflateChunk(b, column, raw)) return false;
+		for (size_t i = 0; i < blockRows_[b]; i++) {
+			if (wide) {
+				uint64_t v;
+				memcpy(&v, &raw[8*i], 8);
+				out.push_back(v);
+			}
+			else {
+				uint32_t v;
+				memcpy(&v, &raw[4*i], 4);
+				out.push_back(v);
+			}
+		}
+	}
+	return true;
+}
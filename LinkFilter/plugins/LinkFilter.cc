@@ -8,7 +8,8 @@
  Description: [one line class summary]
 
  Implementation:
-     [Notes on implementation]
+     Keeps the events in which every link is 0xf. With a ctp7Sources
+     list, every link of every card.
 */
 //
 // Original Author:  Laura Dodd
@@ -19,6 +20,7 @@
 
 // system include files
 #include <memory>
+#include <vector>
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -45,7 +47,7 @@ class LinkFilter : public edm::EDFilter {
       virtual void beginJob() override;
       virtual bool filter(edm::Event&, const edm::EventSetup&) override;
       virtual void endJob() override;
-      edm::EDGetTokenT<LinkMonitorCollection> ctp7Source_LMCollection_;
+      std::vector<edm::EDGetTokenT<LinkMonitorCollection> > ctp7Source_LMCollection_;
       
       //virtual void beginRun(edm::Run const&, edm::EventSetup const&) override;
       //virtual void endRun(edm::Run const&, edm::EventSetup const&) override;
@@ -66,11 +68,14 @@ class LinkFilter : public edm::EDFilter {
 //
 // constructors and destructor
 //
-LinkFilter::LinkFilter(const edm::ParameterSet& iConfig):
-        ctp7Source_LMCollection_( consumes<LinkMonitorCollection>(iConfig.getParameter< edm::InputTag >("ctp7Source") ))
+LinkFilter::LinkFilter(const edm::ParameterSet& iConfig)
 {
    //now do what ever initialization is needed
-
+   std::vector<edm::InputTag> sources =
+      iConfig.getUntrackedParameter< std::vector<edm::InputTag> >("ctp7Sources", std::vector<edm::InputTag>());
+   if (sources.empty()) sources.push_back(iConfig.getParameter< edm::InputTag >("ctp7Source"));
+   for (unsigned int i = 0; i < sources.size(); i++)
+      ctp7Source_LMCollection_.push_back(consumes<LinkMonitorCollection>(sources[i]));
 }
 
 
@@ -92,15 +97,15 @@ bool
 LinkFilter::filter(edm::Event& iEvent, const edm::EventSetup& iSetup)
 {
    using namespace edm;
-   Handle < LinkMonitorCollection > lm;
-   iEvent.getByToken(ctp7Source_LMCollection_,lm);
+   for (unsigned int card = 0; card < ctp7Source_LMCollection_.size(); card++) {
+      Handle < LinkMonitorCollection > lm;
+      iEvent.getByToken(ctp7Source_LMCollection_[card],lm);
 
-   bool goodLinks = true;
-   for (LinkMonitorCollection::const_iterator link = lm->begin(); link != lm->end(); link++) {
-         if (link->raw()!=15) {goodLinks=false;}
+      for (LinkMonitorCollection::const_iterator link = lm->begin(); link != lm->end(); link++) {
+            if (link->raw()!=15) return false;
+      }
    }
-   if (!goodLinks) return false;
-   else{ return true;}
+   return true;
 }
 
 // ------------ method called once each job just before starting event loop  ------------
@@ -0,0 +1,81 @@
+/*
+ * \file ctp7ShmDump.cc
+ *
+ * Dump the live histograms that L1TCTP7, RCTL1A and LinkDQM mirror into
+ * shared memory (shmSegment parameter).
+ *
+ *   ctp7ShmDump <segment>                  list the histograms
+ *   ctp7ShmDump <segment> <histogram>      print the non-empty bins
+ *   ctp7ShmDump <segment> <histogram> -a   print all bins
+ *
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "CTP7Tests/LiveExport/interface/ShmHistogramReader.h"
+
+static void usage()
+{
+	std::cout << "usage: ctp7ShmDump <segment> [histogram] [-a]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
+		usage();
+		return 1;
+	}
+
+	ShmHistogramReader reader(argv[1]);
+	if (!reader.isOpen()) {
+		std::cerr << "ctp7ShmDump: " << reader.error() << std::endl;
+		return 2;
+	}
+
+	if (argc < 3) {
+		std::cout << "module " << reader.header().module << " (pid " << reader.header().writerPid
+			<< "), " << reader.size() << " histograms" << std::endl;
+		for (size_t i = 0; i < reader.size(); i++) {
+			ShmHistogramReader::Snapshot snap;
+			const ctp7shm::HistogramEntry& e = reader.entry(i);
+			bool ok = reader.snapshot(i, snap);
+			std::cout << std::setw(40) << std::left << e.name << std::right
+				<< " " << e.nbinsX;
+			if (e.dimension > 1) std::cout << "x" << e.nbinsY;
+			std::cout << " bins, seq " << (ok ? snap.seq : 0)
+				<< ", entries " << (ok ? snap.entries : 0.) << std::endl;
+		}
+		return 0;
+	}
+
+	int i = reader.find(argv[2]);
+	if (i < 0) {
+		std::cerr << "ctp7ShmDump: no histogram " << argv[2] << " in " << argv[1] << std::endl;
+		return 3;
+	}
+	bool all = argc > 3 && !strcmp(argv[3], "-a");
+
+	ShmHistogramReader::Snapshot snap;
+	if (!reader.snapshot(i, snap)) {
+		std::cerr << "ctp7ShmDump: writer too busy, no consistent snapshot of " << argv[2] << std::endl;
+		return 4;
+	}
+
+	const ctp7shm::HistogramEntry& e = reader.entry(i);
+	std::cout << "# " << e.name << " seq " << snap.seq << " entries " << snap.entries
+		<< " updated " << snap.updateTimeNs/1000000000LL << std::endl;
+
+	// cells include under/overflow: (nbinsX+2) per row, ROOT ordering
+	const unsigned int nx = e.nbinsX + 2;
+	for (size_t c = 0; c < snap.bins.size(); c++) {
+		if (!all && snap.bins[c] == 0) continue;
+		if (e.dimension > 1)
+			std::cout << c % nx << " " << c / nx << " " << snap.bins[c] << std::endl;
+		else
+			std::cout << c << " " << snap.bins[c] << std::endl;
+	}
+	return 0;
+}
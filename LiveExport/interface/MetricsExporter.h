@@ -0,0 +1,46 @@
+#ifndef METRICSEXPORTER_h
+#define METRICSEXPORTER_h
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Serves MetricsRegistry::render() from a background thread, for a local
+// agent to scrape; the event path never sees it.
+//  - socket: a Unix stream socket. Every connection gets the current text
+//    and is closed. A client that sends an HTTP request first
+//    (curl --unix-socket <path> http://localhost/metrics) gets an HTTP
+//    response, any other client the bare text (socat - UNIX-CONNECT:<path>).
+//  - file:   rewritten every period seconds through a rename, as read by
+//    the textfile collector of node_exporter.
+// There is one exporter per process. The first module that asks for one
+// starts it; the others must name the same socket and file or are ignored
+// with a message. The socket is removed at the end of the job, the file
+// keeps the last values.
+class MetricsExporter
+{
+public:
+	static void start(const std::string& module, const std::string& socket,
+		const std::string& file, double period);
+
+	~MetricsExporter();
+
+private:
+	MetricsExporter(const std::string& socket, const std::string& file, double period);
+	MetricsExporter(const MetricsExporter&);
+	MetricsExporter& operator=(const MetricsExporter&);
+
+	bool listen();
+	void loop();
+	void serve(int fd) const;
+	void writeFile() const;
+
+	std::string socket_;
+	std::string file_;
+	double period_;
+	int listenFd_;
+	std::atomic<bool> stop_;
+	std::thread thread_;
+};
+
+#endif
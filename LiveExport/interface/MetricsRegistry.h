@@ -0,0 +1,96 @@
+#ifndef METRICSREGISTRY_h
+#define METRICSREGISTRY_h
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+// Process-wide counters and gauges for the monitoring dashboards. A metric
+// is registered once, from a module constructor, and the handle is then
+// updated on the event path with a single relaxed atomic add or store: no
+// lock, no allocation, no system call. The slots live in a fixed array
+// that never moves, so MetricsExporter reads them from its own thread
+// without stopping the writers. Every slot has its own cache line, modules
+// updating their counters do not contend with each other.
+//
+// Names and labels follow the Prometheus conventions, counters end in
+// _total:
+//
+//   ctp7_dqm_events_total{module="RCTL1A"} 12000
+
+namespace ctp7metrics {
+
+struct Slot
+{
+	Slot() : gauge(false), count(0), value(0.) { }
+
+	// set once before the slot is published
+	std::string name;
+	std::string help;
+	std::string labels;
+	bool gauge;
+
+	std::atomic<uint64_t> count;
+	std::atomic<double> value;
+} __attribute__((aligned(64)));
+
+class Counter
+{
+public:
+	Counter() : slot_(0) { }
+	explicit Counter(Slot* slot) : slot_(slot) { }
+
+	void inc(uint64_t n = 1) { if (slot_) slot_->count.fetch_add(n, std::memory_order_relaxed); }
+
+private:
+	Slot* slot_;
+};
+
+class Gauge
+{
+public:
+	Gauge() : slot_(0) { }
+	explicit Gauge(Slot* slot) : slot_(slot) { }
+
+	void set(double v) { if (slot_) slot_->value.store(v, std::memory_order_relaxed); }
+
+private:
+	Slot* slot_;
+};
+
+}
+
+class MetricsRegistry
+{
+public:
+	static MetricsRegistry& instance();
+
+	// the same name and labels give the same slot; a full registry gives a
+	// handle that counts nothing
+	ctp7metrics::Counter counter(const std::string& name, const std::string& help,
+		const std::string& module, const std::string& label = "", const std::string& value = "");
+	ctp7metrics::Gauge gauge(const std::string& name, const std::string& help,
+		const std::string& module, const std::string& label = "", const std::string& value = "");
+
+	// every metric in the Prometheus text format, one HELP/TYPE per name
+	std::string render() const;
+
+	size_t size() const { return size_.load(std::memory_order_acquire); }
+
+private:
+	MetricsRegistry() : size_(0) { }
+	MetricsRegistry(const MetricsRegistry&);
+	MetricsRegistry& operator=(const MetricsRegistry&);
+
+	ctp7metrics::Slot* slot(const std::string& name, const std::string& help, bool gauge,
+		const std::string& module, const std::string& label, const std::string& value);
+
+	static const size_t kMaxMetrics = 256;
+
+	ctp7metrics::Slot slots_[kMaxMetrics];
+	std::atomic<size_t> size_;
+	std::mutex registerLock_;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SHMHISTOGRAMLAYOUT_h
+#define SHMHISTOGRAMLAYOUT_h
+
+#include <atomic>
+#include <stdint.h>
+
+// Layout of the POSIX shared-memory segment written by ShmHistogramWriter.
+//
+//   [SegmentHeader][HistogramEntry x nHistograms][bins of histogram 0][bins of histogram 1]...
+//
+// Bins are stored as float, including under/overflow, in the same order
+// as the ROOT TH1/TH2 cell array ((nbinsX+2)*(nbinsY+2) cells for 2D).
+// Each entry carries its own sequence counter (seqlock): the writer makes
+// it odd before touching the bins and even again afterwards, a reader
+// copies the bins and accepts the copy only if the counter was even and
+// unchanged. The writer never waits for readers.
+
+namespace ctp7shm {
+
+const uint32_t kMagic   = 0x43545037; // "CTP7"
+const uint32_t kVersion = 1;
+
+const unsigned int kNameSize = 96;
+
+struct SegmentHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nHistograms;
+	uint32_t entrySize;
+	uint64_t totalBytes;
+	int64_t  writerPid;
+	char     module[kNameSize];
+};
+
+struct HistogramEntry
+{
+	std::atomic<uint64_t> seq;   // odd while the writer copies the bins
+	char     name[kNameSize];
+	uint32_t dimension;
+	uint32_t nbinsX;
+	uint32_t nbinsY;
+	uint32_t reserved;
+	double   xmin;
+	double   xmax;
+	double   ymin;
+	double   ymax;
+	uint64_t nCells;
+	uint64_t dataOffset;         // bytes from the start of the segment
+	// the following are only valid together with an even, unchanged seq
+	double   entries;
+	int64_t  updateTimeNs;       // CLOCK_REALTIME of the last mirror
+};
+
+// round up to a cache line so that entries and bin blocks do not share lines
+inline uint64_t alignCacheLine(uint64_t n) { return (n + 63) & ~uint64_t(63); }
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SHMHISTOGRAMREADER_h
+#define SHMHISTOGRAMREADER_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "CTP7Tests/LiveExport/interface/ShmHistogramLayout.h"
+
+// Read-only view of a segment produced by ShmHistogramWriter. Snapshots
+// never block the writer: a copy that raced with an update is retried,
+// and given up after maxRetries attempts.
+class ShmHistogramReader
+{
+public:
+	explicit ShmHistogramReader(const std::string& segmentName);
+	~ShmHistogramReader();
+
+	bool isOpen() const { return base_ != 0; }
+	const std::string& error() const { return error_; }
+
+	const ctp7shm::SegmentHeader& header() const;
+	size_t size() const;
+	const ctp7shm::HistogramEntry& entry(size_t i) const;
+
+	// index of the histogram called name, or -1
+	int find(const std::string& name) const;
+
+	struct Snapshot
+	{
+		uint64_t seq;
+		double entries;
+		int64_t updateTimeNs;
+		std::vector<float> bins;
+	};
+
+	bool snapshot(size_t i, Snapshot& out, unsigned int maxRetries = 1000) const;
+
+private:
+	ShmHistogramReader(const ShmHistogramReader&);
+	ShmHistogramReader& operator=(const ShmHistogramReader&);
+
+	const char* base_;
+	uint64_t bytes_;
+	std::string error_;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SHMHISTOGRAMWRITER_h
+#define SHMHISTOGRAMWRITER_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "CTP7Tests/LiveExport/interface/ShmHistogramLayout.h"
+
+class TH1;
+
+// Mirrors the bins of a fixed set of histograms into a named POSIX
+// shared-memory segment (see ShmHistogramLayout.h). Histograms are
+// registered with add() before open(); update() copies the histograms
+// whose entry count changed since the last mirror. Histograms written with
+// SetBinContent keep their entry count, so they are registered byContent
+// and their bins are checksummed instead; the others are never scanned.
+class ShmHistogramWriter
+{
+public:
+	ShmHistogramWriter(const std::string& segmentName, const std::string& module);
+	~ShmHistogramWriter();
+
+	void add(const std::string& name, const TH1* histo, bool byContent = false);
+
+	// create (or replace) the segment; returns false and logs on failure
+	bool open();
+	bool isOpen() const { return base_ != 0; }
+
+	void update();
+	void update(size_t i);
+
+	size_t size() const { return histos_.size(); }
+	const std::string& segmentName() const { return segmentName_; }
+
+	// remove the segment name when the writer goes away (default: keep it,
+	// so the last state stays readable after the job)
+	void setUnlinkOnClose(bool unlink) { unlinkOnClose_ = unlink; }
+
+private:
+	ShmHistogramWriter(const ShmHistogramWriter&);
+	ShmHistogramWriter& operator=(const ShmHistogramWriter&);
+
+	struct Source {
+		std::string name;
+		const TH1* histo;
+		bool byContent;
+		uint64_t checksum;  // of the bins last mirrored, byContent only
+	};
+
+	void copyBins(const TH1* h, float* dst, uint64_t nCells) const;
+	static uint64_t checksum(const TH1* h, uint64_t nCells);
+
+	std::string segmentName_;
+	std::string module_;
+	std::vector<Source> histos_;
+
+	char* base_;
+	uint64_t bytes_;
+	bool unlinkOnClose_;
+};
+
+#endif
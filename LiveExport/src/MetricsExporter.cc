@@ -0,0 +1,182 @@
+/*
+ * \file MetricsExporter.cc
+ *
+ * Metrics of MetricsRegistry on a Unix socket and in a text file.
+ *
+ */
+
+#include "CTP7Tests/LiveExport/interface/MetricsExporter.h"
+#include "CTP7Tests/LiveExport/interface/MetricsRegistry.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+	// the longest wait of the thread, and so of the end of the job
+	const int kPollMs = 200;
+
+	std::mutex startLock;
+
+}
+
+void MetricsExporter::start(const std::string& module, const std::string& socket,
+	const std::string& file, double period)
+{
+	if (socket.empty() && file.empty()) return;
+
+	std::lock_guard<std::mutex> guard(startLock);
+	// created after the registry, so the thread is stopped before the
+	// registry goes away at exit
+	MetricsRegistry::instance();
+	static std::unique_ptr<MetricsExporter> exporter;
+
+	if (exporter) {
+		if (exporter->socket_ != socket || exporter->file_ != file)
+			std::cout << "MetricsExporter: " << module << " asks for socket '" << socket
+				<< "' and file '" << file << "', the metrics already go to '" << exporter->socket_
+				<< "' and '" << exporter->file_ << "'" << std::endl;
+		return;
+	}
+	exporter.reset(new MetricsExporter(socket, file, period));
+}
+
+MetricsExporter::MetricsExporter(const std::string& socket, const std::string& file, double period) :
+	socket_(socket),
+	file_(file),
+	period_(period < 0.1 ? 0.1 : period),
+	listenFd_(-1),
+	stop_(false)
+{
+	if (!socket_.empty() && !listen()) socket_.clear();
+	if (socket_.empty() && file_.empty()) return;
+	thread_ = std::thread(&MetricsExporter::loop, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	stop_ = true;
+	if (thread_.joinable()) thread_.join();
+	if (listenFd_ >= 0) {
+		close(listenFd_);
+		unlink(socket_.c_str());
+	}
+}
+
+bool MetricsExporter::listen()
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_.size() >= sizeof(addr.sun_path)) {
+		std::cout << "MetricsExporter: socket path " << socket_ << " is too long" << std::endl;
+		return false;
+	}
+	strncpy(addr.sun_path, socket_.c_str(), sizeof(addr.sun_path) - 1);
+
+	// the socket of an earlier job, never anything else
+	struct stat st;
+	if (lstat(socket_.c_str(), &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			std::cout << "MetricsExporter: " << socket_ << " exists and is not a socket" << std::endl;
+			return false;
+		}
+		unlink(socket_.c_str());
+	}
+
+	listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listenFd_ < 0 || bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+	    || ::listen(listenFd_, 8) != 0) {
+		std::cout << "MetricsExporter: cannot listen on " << socket_ << ": " << strerror(errno) << std::endl;
+		if (listenFd_ >= 0) close(listenFd_);
+		listenFd_ = -1;
+		return false;
+	}
+	return true;
+}
+
+void MetricsExporter::loop()
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period_));
+	Clock::time_point next = Clock::now();
+
+	while (!stop_) {
+		int wait = kPollMs;
+		if (!file_.empty()) {
+			const Clock::time_point now = Clock::now();
+			if (now >= next) {
+				writeFile();
+				next = now + period;
+			}
+			const long long left = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+			if (left < wait) wait = left < 1 ? 1 : left;
+		}
+
+		if (listenFd_ < 0) {
+			usleep(wait*1000);
+			continue;
+		}
+		pollfd p = { listenFd_, POLLIN, 0 };
+		if (poll(&p, 1, wait) <= 0 || !(p.revents & POLLIN)) continue;
+		const int fd = accept(listenFd_, 0, 0);
+		if (fd < 0) continue;
+		serve(fd);
+		close(fd);
+	}
+
+	// the file keeps the values at the end of the job
+	if (!file_.empty()) writeFile();
+}
+
+void MetricsExporter::serve(int fd) const
+{
+	// an HTTP client sends its request first, socat sends nothing
+	char request[1024];
+	ssize_t n = 0;
+	pollfd p = { fd, POLLIN, 0 };
+	if (poll(&p, 1, 50) > 0) n = recv(fd, request, sizeof(request), 0);
+	const bool http = n >= 4 && memcmp(request, "GET ", 4) == 0;
+
+	const std::string body = MetricsRegistry::instance().render();
+	std::string reply;
+	if (http) {
+		std::ostringstream header;
+		header << "HTTP/1.0 200 OK\r\n"
+			<< "Content-Type: text/plain; version=0.0.4\r\n"
+			<< "Content-Length: " << body.size() << "\r\n"
+			<< "Connection: close\r\n\r\n";
+		reply = header.str();
+	}
+	reply += body;
+
+	for (size_t sent = 0; sent < reply.size(); ) {
+		const ssize_t k = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+		if (k <= 0) return;
+		sent += k;
+	}
+}
+
+void MetricsExporter::writeFile() const
+{
+	const std::string tmp = file_ + ".tmp";
+	{
+		std::ofstream out(tmp.c_str());
+		if (!out) return;
+		out << MetricsRegistry::instance().render();
+	}
+	rename(tmp.c_str(), file_.c_str());
+}
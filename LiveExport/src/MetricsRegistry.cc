@@ -0,0 +1,107 @@
+/*
+ * \file MetricsRegistry.cc
+ *
+ * Lock-free process-wide counters and gauges, Prometheus text rendering.
+ *
+ */
+
+#include "CTP7Tests/LiveExport/interface/MetricsRegistry.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace ctp7metrics;
+
+namespace {
+
+	// label values may hold any character but \, " and newline
+	std::string escape(const std::string& s)
+	{
+		std::string out;
+		for (size_t i = 0; i < s.size(); i++) {
+			if (s[i] == '\\' || s[i] == '"') out += '\\';
+			if (s[i] == '\n') out += "\\n";
+			else out += s[i];
+		}
+		return out;
+	}
+
+	bool byName(const Slot* a, const Slot* b) { return a->name < b->name; }
+
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+Counter MetricsRegistry::counter(const std::string& name, const std::string& help,
+	const std::string& module, const std::string& label, const std::string& value)
+{
+	return Counter(slot(name, help, false, module, label, value));
+}
+
+Gauge MetricsRegistry::gauge(const std::string& name, const std::string& help,
+	const std::string& module, const std::string& label, const std::string& value)
+{
+	return Gauge(slot(name, help, true, module, label, value));
+}
+
+Slot* MetricsRegistry::slot(const std::string& name, const std::string& help, bool gauge,
+	const std::string& module, const std::string& label, const std::string& value)
+{
+	std::string labels = "module=\"" + escape(module) + "\"";
+	if (!label.empty()) labels += "," + label + "=\"" + escape(value) + "\"";
+
+	std::lock_guard<std::mutex> guard(registerLock_);
+	const size_t n = size_.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < n; i++) {
+		if (slots_[i].name != name || slots_[i].labels != labels) continue;
+		if (slots_[i].gauge != gauge) {
+			std::cout << "MetricsRegistry: " << name << " is already registered as a "
+				<< (slots_[i].gauge ? "gauge" : "counter") << std::endl;
+			return 0;
+		}
+		return &slots_[i];
+	}
+	if (n == kMaxMetrics) {
+		std::cout << "MetricsRegistry: more than " << kMaxMetrics << " metrics, "
+			<< name << "{" << labels << "} is not exported" << std::endl;
+		return 0;
+	}
+
+	Slot& s = slots_[n];
+	s.name = name;
+	s.help = help;
+	s.labels = labels;
+	s.gauge = gauge;
+	// the exporter reads slots below size_ only
+	size_.store(n + 1, std::memory_order_release);
+	return &s;
+}
+
+std::string MetricsRegistry::render() const
+{
+	const size_t n = size();
+	std::vector<const Slot*> slots;
+	for (size_t i = 0; i < n; i++) slots.push_back(&slots_[i]);
+	std::stable_sort(slots.begin(), slots.end(), byName);
+
+	std::ostringstream out;
+	out.precision(17);
+	for (size_t i = 0; i < slots.size(); i++) {
+		const Slot& s = *slots[i];
+		if (i == 0 || slots[i - 1]->name != s.name) {
+			out << "# HELP " << s.name << " " << s.help << "\n"
+				<< "# TYPE " << s.name << " " << (s.gauge ? "gauge" : "counter") << "\n";
+		}
+		out << s.name << "{" << s.labels << "} ";
+		if (s.gauge) out << s.value.load(std::memory_order_relaxed);
+		else out << s.count.load(std::memory_order_relaxed);
+		out << "\n";
+	}
+	return out.str();
+}
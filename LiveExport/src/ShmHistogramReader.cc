@@ -0,0 +1,106 @@
+/*
+ * \file ShmHistogramReader.cc
+ *
+ * Lock-free reader for segments written by ShmHistogramWriter.
+ *
+ */
+
+#include "CTP7Tests/LiveExport/interface/ShmHistogramReader.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ctp7shm;
+
+ShmHistogramReader::ShmHistogramReader(const std::string& segmentName) :
+	base_(0),
+	bytes_(0)
+{
+	std::string name = segmentName;
+	if (name.empty() || name[0] != '/') name = "/" + name;
+
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		error_ = "cannot open " + name + ": " + strerror(errno);
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || uint64_t(st.st_size) < sizeof(SegmentHeader)) {
+		error_ = "segment " + name + " is too small";
+		close(fd);
+		return;
+	}
+	void* p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		error_ = "cannot map " + name + ": " + strerror(errno);
+		return;
+	}
+
+	const SegmentHeader* hdr = static_cast<const SegmentHeader*>(p);
+	if (hdr->magic != kMagic || hdr->version != kVersion || hdr->totalBytes > uint64_t(st.st_size)) {
+		error_ = "segment " + name + " is not a CTP7 histogram segment (or not initialised yet)";
+		munmap(p, st.st_size);
+		return;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	base_ = static_cast<const char*>(p);
+	bytes_ = st.st_size;
+}
+
+ShmHistogramReader::~ShmHistogramReader()
+{
+	if (base_) munmap(const_cast<char*>(base_), bytes_);
+}
+
+const SegmentHeader& ShmHistogramReader::header() const
+{
+	return *reinterpret_cast<const SegmentHeader*>(base_);
+}
+
+size_t ShmHistogramReader::size() const
+{
+	return base_ ? header().nHistograms : 0;
+}
+
+const HistogramEntry& ShmHistogramReader::entry(size_t i) const
+{
+	return *reinterpret_cast<const HistogramEntry*>(
+		base_ + alignCacheLine(sizeof(SegmentHeader)) + uint64_t(header().entrySize)*i);
+}
+
+int ShmHistogramReader::find(const std::string& name) const
+{
+	for (size_t i = 0; i < size(); i++)
+		if (name == entry(i).name) return i;
+	return -1;
+}
+
+bool ShmHistogramReader::snapshot(size_t i, Snapshot& out, unsigned int maxRetries) const
+{
+	if (i >= size()) return false;
+	const HistogramEntry& e = entry(i);
+	out.bins.resize(e.nCells);
+
+	for (unsigned int attempt = 0; attempt <= maxRetries; attempt++) {
+		const uint64_t before = e.seq.load(std::memory_order_acquire);
+		if (before & 1) continue;
+
+		memcpy(&out.bins[0], base_ + e.dataOffset, sizeof(float)*e.nCells);
+		out.entries = e.entries;
+		out.updateTimeNs = e.updateTimeNs;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (e.seq.load(std::memory_order_relaxed) == before) {
+			out.seq = before;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,203 @@
+/*
+ * \file ShmHistogramWriter.cc
+ *
+ * Mirror of DQM histogram bins into POSIX shared memory.
+ *
+ */
+
+#include "CTP7Tests/LiveExport/interface/ShmHistogramWriter.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "TH1.h"
+#include "TArrayF.h"
+#include "TArrayD.h"
+
+using namespace ctp7shm;
+
+ShmHistogramWriter::ShmHistogramWriter(const std::string& segmentName, const std::string& module) :
+	segmentName_(segmentName),
+	module_(module),
+	base_(0),
+	bytes_(0),
+	unlinkOnClose_(false)
+{
+	// shm_open wants a single leading slash
+	if (segmentName_.empty() || segmentName_[0] != '/')
+		segmentName_ = "/" + segmentName_;
+}
+
+ShmHistogramWriter::~ShmHistogramWriter()
+{
+	if (base_) munmap(base_, bytes_);
+	if (unlinkOnClose_) shm_unlink(segmentName_.c_str());
+}
+
+void ShmHistogramWriter::add(const std::string& name, const TH1* histo, bool byContent)
+{
+	if (base_ || !histo) return;
+	Source src;
+	src.name = name;
+	src.histo = histo;
+	src.byContent = byContent;
+	src.checksum = 0;
+	histos_.push_back(src);
+}
+
+bool ShmHistogramWriter::open()
+{
+	if (base_) return true;
+
+	const uint64_t headerBytes = alignCacheLine(sizeof(SegmentHeader));
+	const uint64_t entryBytes = alignCacheLine(sizeof(HistogramEntry));
+
+	uint64_t total = headerBytes + entryBytes*histos_.size();
+	std::vector<uint64_t> offsets;
+	for (size_t i = 0; i < histos_.size(); i++) {
+		offsets.push_back(total);
+		total += alignCacheLine(sizeof(float)*histos_[i].histo->GetNcells());
+	}
+
+	// start from a fresh segment so readers never see a stale layout
+	shm_unlink(segmentName_.c_str());
+	int fd = shm_open(segmentName_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) {
+		std::cout << "ShmHistogramWriter: cannot create " << segmentName_
+			<< ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	if (ftruncate(fd, total) != 0) {
+		std::cout << "ShmHistogramWriter: cannot size " << segmentName_
+			<< " to " << total << " bytes: " << strerror(errno) << std::endl;
+		close(fd);
+		shm_unlink(segmentName_.c_str());
+		return false;
+	}
+	void* p = mmap(0, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		std::cout << "ShmHistogramWriter: cannot map " << segmentName_
+			<< ": " << strerror(errno) << std::endl;
+		shm_unlink(segmentName_.c_str());
+		return false;
+	}
+	base_ = static_cast<char*>(p);
+	bytes_ = total;
+
+	for (size_t i = 0; i < histos_.size(); i++) {
+		const TH1* h = histos_[i].histo;
+		HistogramEntry* e = new (base_ + headerBytes + entryBytes*i) HistogramEntry();
+		e->seq.store(0, std::memory_order_relaxed);
+		strncpy(e->name, histos_[i].name.c_str(), kNameSize - 1);
+		e->dimension = h->GetDimension();
+		e->nbinsX = h->GetNbinsX();
+		e->nbinsY = h->GetDimension() > 1 ? h->GetNbinsY() : 0;
+		e->xmin = h->GetXaxis()->GetXmin();
+		e->xmax = h->GetXaxis()->GetXmax();
+		e->ymin = h->GetDimension() > 1 ? h->GetYaxis()->GetXmin() : 0.;
+		e->ymax = h->GetDimension() > 1 ? h->GetYaxis()->GetXmax() : 0.;
+		e->nCells = h->GetNcells();
+		e->dataOffset = offsets[i];
+		e->entries = 0.;
+		e->updateTimeNs = 0;
+	}
+	// the header goes last: a reader that sees the magic sees a complete layout
+	SegmentHeader* hdr = reinterpret_cast<SegmentHeader*>(base_);
+	hdr->version = kVersion;
+	hdr->nHistograms = histos_.size();
+	hdr->entrySize = entryBytes;
+	hdr->totalBytes = total;
+	hdr->writerPid = getpid();
+	strncpy(hdr->module, module_.c_str(), kNameSize - 1);
+	std::atomic_thread_fence(std::memory_order_release);
+	hdr->magic = kMagic;
+
+	update();
+	return true;
+}
+
+void ShmHistogramWriter::update()
+{
+	for (size_t i = 0; i < histos_.size(); i++) update(i);
+}
+
+void ShmHistogramWriter::update(size_t i)
+{
+	if (!base_ || i >= histos_.size()) return;
+
+	Source& src = histos_[i];
+	const TH1* h = src.histo;
+	const double entries = h->GetEntries();
+
+	HistogramEntry* e = reinterpret_cast<HistogramEntry*>(
+		base_ + alignCacheLine(sizeof(SegmentHeader)) + alignCacheLine(sizeof(HistogramEntry))*i);
+	float* data = reinterpret_cast<float*>(base_ + e->dataOffset);
+
+	// Fill changes the entry count; only the few byContent histograms,
+	// whose count does not move, are checksummed
+	const uint64_t sum = src.byContent ? checksum(h, e->nCells) : 0;
+	if (e->updateTimeNs != 0 && entries == e->entries && sum == src.checksum) return;
+
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	const uint64_t seq = e->seq.load(std::memory_order_relaxed);
+	e->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	copyBins(h, data, e->nCells);
+	e->entries = entries;
+	e->updateTimeNs = int64_t(now.tv_sec)*1000000000LL + now.tv_nsec;
+
+	e->seq.store(seq + 2, std::memory_order_release);
+	src.checksum = sum;
+}
+
+void ShmHistogramWriter::copyBins(const TH1* h, float* dst, uint64_t nCells) const
+{
+	// DQM books TH1F/TH2F, whose cells are a contiguous float array
+	const TArrayF* af = dynamic_cast<const TArrayF*>(h);
+	if (af && uint64_t(af->GetSize()) >= nCells) {
+		memcpy(dst, af->GetArray(), sizeof(float)*nCells);
+		return;
+	}
+	const TArrayD* ad = dynamic_cast<const TArrayD*>(h);
+	if (ad && uint64_t(ad->GetSize()) >= nCells) {
+		const double* src = ad->GetArray();
+		for (uint64_t c = 0; c < nCells; c++) dst[c] = src[c];
+		return;
+	}
+	for (uint64_t c = 0; c < nCells; c++) dst[c] = h->GetBinContent(c);
+}
+
+uint64_t ShmHistogramWriter::checksum(const TH1* h, uint64_t nCells)
+{
+	// FNV-1a over the cell bit patterns: one pass, no copy
+	uint64_t sum = 14695981039346656037ULL;
+	const TArrayF* af = dynamic_cast<const TArrayF*>(h);
+	if (af && uint64_t(af->GetSize()) >= nCells) {
+		const float* src = af->GetArray();
+		for (uint64_t c = 0; c < nCells; c++) {
+			uint32_t bits;
+			memcpy(&bits, &src[c], sizeof(bits));
+			sum = (sum ^ bits)*1099511628211ULL;
+		}
+		return sum;
+	}
+	for (uint64_t c = 0; c < nCells; c++) {
+		const double v = h->GetBinContent(c);
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		sum = (sum ^ bits)*1099511628211ULL;
+	}
+	return sum;
+}
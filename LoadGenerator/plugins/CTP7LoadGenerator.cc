@@ -0,0 +1,438 @@
+// -*- C++ -*-
+//
+// Package:    CTP7Tests/LoadGenerator
+// Class:      CTP7LoadGenerator
+//
+/**\class CTP7LoadGenerator CTP7LoadGenerator.cc CTP7Tests/LoadGenerator/plugins/CTP7LoadGenerator.cc
+
+ Description: synthetic CTP7 digis to drive L1TCTP7, RCTL1A and LinkDQM
+              without hardware
+
+ Implementation:
+     Puts the four products of the CTP7 unpacker (L1CaloRegionCollection,
+     L1CaloEmCollection, LinkMonitorCollection, TimeMonitorCollection), so
+     the module can replace ctp7ToDigi/rctToDigi in any DQM configuration.
+
+     Synthetic mode: the number of interactions is Poisson(pileup); each
+     region is non-zero with probability 1 - exp(-(pu + 1) * occupancyPerPileup),
+     with an exponential E_T of mean meanRegionEt. HF regions have both
+     scaled by hfActivity. EM candidates are Poisson(emMultiplicity) with
+     an exponential rank of mean meanEmRank. Every link is bad (not 0xf)
+     with probability linkErrorRate.
+
+     Resampling mode (resampleFile set): the non-zero count, the region
+     positions and E_T, the EM multiplicity and ranks and the per-link error
+     rates are drawn from the histograms of an existing DQM output
+     (L1TCTP7 and LinkDQM folders). Histograms that are missing fall back
+     to the synthetic parameters.
+
+     occupancyScale multiplies the number of non-zero regions in both modes,
+     for extreme loads. The sequence is fixed by seed.
+*/
+//
+
+
+// system include files
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <sys/time.h>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/EDProducer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "DataFormats/L1CaloTrigger/interface/L1CaloCollections.h"
+#include "CTP7Tests/LinkMonitor/interface/LinkMonitor.h"
+#include "CTP7Tests/TimeMonitor/interface/TimeMonitor.h"
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TH2.h"
+
+//
+// constants, enums and typedefs
+//
+
+const unsigned int NETA = 22;
+const unsigned int NPHI = 18;
+const unsigned int NCRATES = 18;
+const unsigned int MAXREGIONET = 1023;
+const unsigned int MAXEMRANK = 63;
+// 4 iso + 4 non-iso candidates per crate
+const unsigned int EMPERCRATE = 4;
+
+//
+// inverse-cdf sampling of a binned distribution
+//
+class BinnedSampler {
+   public:
+      BinnedSampler() { }
+
+      // from the bins of h centred at or above xmin; false if they are all empty
+      bool load(const TH1* h, double xmin = -1e30) {
+         cdf_.clear();
+         x_.clear();
+         if (!h) return false;
+         double sum = 0;
+         for (int i = 1; i <= h->GetNbinsX(); i++) {
+            const double x = h->GetXaxis()->GetBinCenter(i);
+            if (x < xmin || h->GetBinContent(i) <= 0) continue;
+            sum += h->GetBinContent(i);
+            cdf_.push_back(sum);
+            x_.push_back(x);
+         }
+         if (sum <= 0) {
+            cdf_.clear();
+            x_.clear();
+            return false;
+         }
+         for (size_t i = 0; i < cdf_.size(); i++) cdf_[i] /= sum;
+         return true;
+      }
+
+      bool empty() const { return cdf_.empty(); }
+
+      template <class Rng> double sample(Rng& rng) const {
+         const double u = std::uniform_real_distribution<double>(0., 1.)(rng);
+         size_t i = std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+         return x_[std::min(i, x_.size() - 1)];
+      }
+
+   private:
+      std::vector<double> cdf_;
+      std::vector<double> x_;
+};
+
+//
+// class declaration
+//
+
+class CTP7LoadGenerator : public edm::EDProducer {
+   public:
+      explicit CTP7LoadGenerator(const edm::ParameterSet&);
+      ~CTP7LoadGenerator();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void beginJob() override;
+      virtual void produce(edm::Event&, const edm::EventSetup&) override;
+      virtual void endJob() override;
+
+      void loadResample(const std::string& file);
+      void generateRegions(L1CaloRegionCollection& regions, int16_t bx, double scale);
+      void generateEm(L1CaloEmCollection& em, int16_t bx, double scale);
+      void generateLinks(LinkMonitorCollection& links);
+
+      static bool isHf(unsigned int ieta) { return ieta < 4 || ieta > 17; }
+
+      // ----------member data ---------------------------
+      std::mt19937 rng_;
+
+      double pileup_;
+      double occupancyPerPileup_;
+      double occupancyScale_;
+      double meanRegionEt_;
+      double hfActivity_;
+      double emMultiplicity_;
+      double isoFraction_;
+      double meanEmRank_;
+      unsigned int nLinks_;
+      double linkErrorRate_;
+      int nBx_;
+      int centralBx_;
+      double offBxScale_;
+      int runNumber_;
+
+      // resampled distributions, empty if not available
+      BinnedSampler nonZero_;
+      BinnedSampler regionEt_;
+      std::vector<double> cellWeight_;   // [ieta*NPHI + iphi], cumulative
+      BinnedSampler emCount_;
+      BinnedSampler isoRank_;
+      BinnedSampler nonIsoRank_;
+      std::vector<double> linkErrorRates_;
+      BinnedSampler badLinkValue_;
+
+      unsigned long long events_;
+      unsigned long long regions_;
+      unsigned long long emCands_;
+      unsigned long long badLinks_;
+
+      // wall time of the first and the last event, for the event loop rate
+      double firstEvent_;
+      double lastEvent_;
+};
+
+//
+// constructors and destructor
+//
+CTP7LoadGenerator::CTP7LoadGenerator(const edm::ParameterSet& iConfig):
+   rng_(iConfig.getUntrackedParameter<unsigned int>("seed", 12345)),
+   pileup_(iConfig.getUntrackedParameter<double>("pileup", 20.)),
+   occupancyPerPileup_(iConfig.getUntrackedParameter<double>("occupancyPerPileup", 0.005)),
+   occupancyScale_(iConfig.getUntrackedParameter<double>("occupancyScale", 1.)),
+   meanRegionEt_(iConfig.getUntrackedParameter<double>("meanRegionEt", 8.)),
+   hfActivity_(iConfig.getUntrackedParameter<double>("hfActivity", 2.)),
+   emMultiplicity_(iConfig.getUntrackedParameter<double>("emMultiplicity", 4.)),
+   isoFraction_(iConfig.getUntrackedParameter<double>("isoFraction", 0.3)),
+   meanEmRank_(iConfig.getUntrackedParameter<double>("meanEmRank", 10.)),
+   nLinks_(iConfig.getUntrackedParameter<unsigned int>("nLinks", 36)),
+   linkErrorRate_(iConfig.getUntrackedParameter<double>("linkErrorRate", 0.)),
+   nBx_(iConfig.getUntrackedParameter<int>("nBx", 1)),
+   centralBx_(iConfig.getUntrackedParameter<int>("centralBx", 2)),
+   offBxScale_(iConfig.getUntrackedParameter<double>("offBxScale", 0.05)),
+   runNumber_(iConfig.getUntrackedParameter<int>("runNumber", 1)),
+   events_(0),
+   regions_(0),
+   emCands_(0),
+   badLinks_(0),
+   firstEvent_(0.),
+   lastEvent_(0.)
+{
+   if (nBx_ < 1) nBx_ = 1;
+
+   produces<L1CaloRegionCollection>();
+   produces<L1CaloEmCollection>();
+   produces<LinkMonitorCollection>();
+   produces<TimeMonitorCollection>();
+
+   std::string resampleFile = iConfig.getUntrackedParameter<std::string>("resampleFile", "");
+   if (resampleFile.size() != 0) loadResample(resampleFile);
+}
+
+
+CTP7LoadGenerator::~CTP7LoadGenerator()
+{
+}
+
+
+//
+// member functions
+//
+
+void
+CTP7LoadGenerator::loadResample(const std::string& file)
+{
+   TFile* f = TFile::Open(file.c_str(), "READ");
+   if (!f || f->IsZombie()) {
+      edm::LogWarning("CTP7LoadGenerator") << "cannot open " << file << ", using the synthetic distributions";
+      delete f;
+      return;
+   }
+   const std::string ctp7 = "DQMData/L1T/L1TCTP7/", link = "DQMData/L1T/LinkDQM/";
+
+   nonZero_.load(dynamic_cast<TH1*>(f->Get((ctp7 + "RctRegionsNonZero").c_str())));
+   regionEt_.load(dynamic_cast<TH1*>(f->Get((ctp7 + "RctRegionRank").c_str())), 1.);
+   isoRank_.load(dynamic_cast<TH1*>(f->Get((ctp7 + "RctEmIsoEmRank").c_str())), 1.);
+   nonIsoRank_.load(dynamic_cast<TH1*>(f->Get((ctp7 + "RctEmNonIsoEmRank").c_str())), 1.);
+
+   // non-zero positions: the E_T map has no threshold, unlike RctRegionsOccEtaPhi
+   TH2* map = dynamic_cast<TH2*>(f->Get((ctp7 + "RctRegionsEtEtaPhi").c_str()));
+   if (map && map->GetNbinsX() == (int) NETA && map->GetNbinsY() == (int) NPHI) {
+      cellWeight_.assign(NETA*NPHI, 0.);
+      double sum = 0;
+      for (unsigned int ieta = 0; ieta < NETA; ieta++)
+         for (unsigned int iphi = 0; iphi < NPHI; iphi++) {
+            // a small weight on every cell, so that any of them can be hit
+            sum += map->GetBinContent(ieta + 1, iphi + 1) + 1e-3;
+            cellWeight_[ieta*NPHI + iphi] = sum;
+         }
+      for (size_t i = 0; i < cellWeight_.size(); i++) cellWeight_[i] /= sum;
+   }
+
+   TH2* emVsEvt = dynamic_cast<TH2*>(f->Get((ctp7 + "RctEmIsoNonZeroVsEvt").c_str()));
+   if (emVsEvt) {
+      TH1* projection = emVsEvt->ProjectionY("_emMultiplicity");
+      projection->SetDirectory(0);
+      emCount_.load(projection);
+      delete projection;
+   }
+
+   // second y bin of RctLinkMonitor2D counts the events with the link not 0xf
+   TH2* links = dynamic_cast<TH2*>(f->Get((link + "RctLinkMonitor2D").c_str()));
+   if (links) {
+      linkErrorRates_.assign(links->GetNbinsX(), 0.);
+      for (int i = 0; i < links->GetNbinsX(); i++) {
+         const double good = links->GetBinContent(i + 1, 1), bad = links->GetBinContent(i + 1, 2);
+         if (good + bad > 0) linkErrorRates_[i] = bad/(good + bad);
+      }
+   }
+   badLinkValue_.load(dynamic_cast<TH1*>(f->Get((link + "RctLinkMonitorNot15").c_str())));
+
+   edm::LogInfo("CTP7LoadGenerator") << "resampling from " << file << ":"
+      << (nonZero_.empty() ? "" : " nonZero") << (regionEt_.empty() ? "" : " regionEt")
+      << (cellWeight_.empty() ? "" : " positions") << (emCount_.empty() ? "" : " emMultiplicity")
+      << (isoRank_.empty() ? "" : " isoRank") << (nonIsoRank_.empty() ? "" : " nonIsoRank")
+      << (linkErrorRates_.empty() ? "" : " linkErrors");
+
+   f->Close();
+   delete f;
+}
+
+void
+CTP7LoadGenerator::generateRegions(L1CaloRegionCollection& regions, int16_t bx, double scale)
+{
+   std::uniform_real_distribution<double> uniform(0., 1.);
+   std::vector<unsigned int> et(NETA*NPHI, 0);
+
+   if (!nonZero_.empty() && !cellWeight_.empty()) {
+      // resampled count, positions drawn without replacement from the E_T map
+      unsigned int n = std::min<unsigned int>(NETA*NPHI,
+         static_cast<unsigned int>(nonZero_.sample(rng_)*scale + 0.5));
+      for (unsigned int placed = 0, tries = 0; placed < n && tries < 20*NETA*NPHI; tries++) {
+         size_t c = std::lower_bound(cellWeight_.begin(), cellWeight_.end(), uniform(rng_)) - cellWeight_.begin();
+         if (c >= et.size() || et[c] != 0) continue;
+         et[c] = regionEt_.empty() ? 1 + static_cast<unsigned int>(std::exponential_distribution<double>(1./meanRegionEt_)(rng_))
+                                   : static_cast<unsigned int>(regionEt_.sample(rng_));
+         placed++;
+      }
+   }
+   else {
+      const double pu = std::poisson_distribution<int>(pileup_)(rng_);
+      for (unsigned int ieta = 0; ieta < NETA; ieta++) {
+         const double activity = isHf(ieta) ? hfActivity_ : 1.;
+         const double p = std::min(1., scale*(1. - std::exp(-(pu + 1.)*occupancyPerPileup_*activity)));
+         std::exponential_distribution<double> spectrum(1./(meanRegionEt_*activity));
+         for (unsigned int iphi = 0; iphi < NPHI; iphi++) {
+            if (uniform(rng_) >= p) continue;
+            et[ieta*NPHI + iphi] = regionEt_.empty() ? 1 + static_cast<unsigned int>(spectrum(rng_))
+                                                     : static_cast<unsigned int>(regionEt_.sample(rng_));
+         }
+      }
+   }
+
+   // every region is sent, as by the CTP7, zero or not
+   for (unsigned int ieta = 0; ieta < NETA; ieta++)
+      for (unsigned int iphi = 0; iphi < NPHI; iphi++) {
+         const unsigned int e = et[ieta*NPHI + iphi];
+         L1CaloRegion r = L1CaloRegion::makeRegionFromGctIndices(std::min(e, MAXREGIONET), e > MAXREGIONET,
+                                                                  false, false, e == 0, ieta, iphi);
+         r.setBx(bx);
+         regions.push_back(r);
+         if (e) regions_++;
+      }
+}
+
+void
+CTP7LoadGenerator::generateEm(L1CaloEmCollection& em, int16_t bx, double scale)
+{
+   std::uniform_real_distribution<double> uniform(0., 1.);
+   unsigned int n = emCount_.empty()
+      ? std::poisson_distribution<int>(emMultiplicity_*scale)(rng_)
+      : static_cast<unsigned int>(emCount_.sample(rng_)*scale + 0.5);
+   n = std::min(n, 2*EMPERCRATE*NCRATES);
+
+   std::vector<unsigned int> used(2*NCRATES, 0);   // [crate*2 + iso]
+   std::exponential_distribution<double> spectrum(1./meanEmRank_);
+   for (unsigned int placed = 0, tries = 0; placed < n && tries < 20*n; tries++) {
+      const unsigned int crate = static_cast<unsigned int>(uniform(rng_)*NCRATES) % NCRATES;
+      const bool iso = uniform(rng_) < isoFraction_;
+      unsigned int& index = used[crate*2 + iso];
+      if (index >= EMPERCRATE) continue;
+      const BinnedSampler& ranks = iso ? isoRank_ : nonIsoRank_;
+      const unsigned int rank = std::min(MAXEMRANK, ranks.empty() ? 1 + static_cast<unsigned int>(spectrum(rng_))
+                                                                  : static_cast<unsigned int>(ranks.sample(rng_)));
+      const unsigned int card = static_cast<unsigned int>(uniform(rng_)*7) % 7;
+      const unsigned int region = uniform(rng_) < 0.5 ? 0 : 1;
+      em.push_back(L1CaloEmCand(rank, region, card, crate, iso, index, bx));
+      index++;
+      placed++;
+      emCands_++;
+   }
+}
+
+void
+CTP7LoadGenerator::generateLinks(LinkMonitorCollection& links)
+{
+   std::uniform_real_distribution<double> uniform(0., 1.);
+   for (unsigned int i = 0; i < nLinks_; i++) {
+      const double rate = i < linkErrorRates_.size() ? linkErrorRates_[i] : linkErrorRate_;
+      uint32_t value = 15;
+      if (rate > 0 && uniform(rng_) < rate) {
+         value = badLinkValue_.empty() ? static_cast<uint32_t>(uniform(rng_)*15) % 15
+                                       : static_cast<uint32_t>(badLinkValue_.sample(rng_));
+         if (value == 15) value = 0;
+         badLinks_++;
+      }
+      links.push_back(LinkMonitor(value));
+   }
+}
+
+// ------------ method called to produce the data  ------------
+void
+CTP7LoadGenerator::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+   std::auto_ptr<L1CaloRegionCollection> regions(new L1CaloRegionCollection);
+   std::auto_ptr<L1CaloEmCollection> em(new L1CaloEmCollection);
+   std::auto_ptr<LinkMonitorCollection> links(new LinkMonitorCollection);
+   std::auto_ptr<TimeMonitorCollection> time(new TimeMonitorCollection);
+
+   regions->reserve(nBx_*NETA*NPHI);
+   for (int i = 0; i < nBx_; i++) {
+      // the central BX of the window carries the full load
+      const int16_t bx = centralBx_ - nBx_/2 + i;
+      const double scale = occupancyScale_*(bx == centralBx_ || nBx_ == 1 ? 1. : offBxScale_);
+      generateRegions(*regions, nBx_ == 1 ? centralBx_ : bx, scale);
+      generateEm(*em, nBx_ == 1 ? centralBx_ : bx, scale);
+   }
+   generateLinks(*links);
+
+   // stamped now, so the capture latency of the DQM modules stays small
+   const time_t now = ::time(0);
+   struct tm local;
+   localtime_r(&now, &local);
+   time->push_back(TimeMonitor(local.tm_mday*100 + local.tm_mon + 1,
+                               local.tm_hour*10000 + local.tm_min*100 + local.tm_sec, runNumber_));
+
+   iEvent.put(regions);
+   iEvent.put(em);
+   iEvent.put(links);
+   iEvent.put(time);
+   events_++;
+
+   timeval tv;
+   gettimeofday(&tv, 0);
+   lastEvent_ = tv.tv_sec + 1e-6*tv.tv_usec;
+   if (events_ == 1) firstEvent_ = lastEvent_;
+}
+
+// ------------ method called once each job just before starting event loop  ------------
+void
+CTP7LoadGenerator::beginJob()
+{
+}
+
+// ------------ method called once each job just after ending the event loop  ------------
+void
+CTP7LoadGenerator::endJob() {
+   edm::LogInfo("CTP7LoadGenerator") << events_ << " events, "
+      << (events_ ? double(regions_)/events_ : 0.) << " non-zero regions/event, "
+      << (events_ ? double(emCands_)/events_ : 0.) << " EM candidates/event, "
+      << badLinks_ << " bad links";
+   // the first event carries the booking, it is left out of the rate
+   if (events_ > 1)
+      edm::LogInfo("CTP7LoadGenerator") << "event loop: " << events_ - 1 << " events in "
+         << lastEvent_ - firstEvent_ << " s";
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+CTP7LoadGenerator::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+//define this as a plug-in
+DEFINE_FWK_MODULE(CTP7LoadGenerator);
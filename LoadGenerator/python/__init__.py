@@ -0,0 +1,3 @@
+#Automatically created by SCRAM
+import os
+__path__.append(os.path.dirname(os.path.abspath(__file__).rsplit('/CTP7Tests/LoadGenerator/',1)[0])+'/cfipython/slc6_amd64_gcc481/CTP7Tests/LoadGenerator')
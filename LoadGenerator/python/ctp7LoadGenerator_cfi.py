@@ -0,0 +1,32 @@
+#flake8: noqa
+import FWCore.ParameterSet.Config as cms
+
+'''
+Synthetic CTP7 digis (regions, EM, links, time) for scaling tests,
+drop-in replacement of ctp7ToDigi / rctToDigi
+'''
+
+ctp7LoadGenerator = cms.EDProducer(
+    "CTP7LoadGenerator",
+    seed = cms.untracked.uint32(12345),
+    # regions: occupancy 1 - exp(-(pu + 1) * occupancyPerPileup), exponential E_T
+    pileup = cms.untracked.double(20.),
+    occupancyPerPileup = cms.untracked.double(0.005),
+    occupancyScale = cms.untracked.double(1.),
+    meanRegionEt = cms.untracked.double(8.),
+    hfActivity = cms.untracked.double(2.),
+    # EM candidates: Poisson multiplicity, exponential rank
+    emMultiplicity = cms.untracked.double(4.),
+    isoFraction = cms.untracked.double(0.3),
+    meanEmRank = cms.untracked.double(10.),
+    # links: probability per link and event of a value other than 0xf
+    nLinks = cms.untracked.uint32(36),
+    linkErrorRate = cms.untracked.double(0.),
+    # BX window, the other BXs get offBxScale of the central occupancy
+    nBx = cms.untracked.int32(1),
+    centralBx = cms.untracked.int32(2),
+    offBxScale = cms.untracked.double(0.05),
+    runNumber = cms.untracked.int32(1),
+    # DQM output (L1TCTP7 and LinkDQM folders) to resample the distributions from
+    resampleFile = cms.untracked.string(''),
+)
@@ -0,0 +1,95 @@
+import FWCore.ParameterSet.Config as cms
+import FWCore.ParameterSet.VarParsing as VarParsing
+
+# one point of the runBenchmark.py matrix
+# cmsRun benchmark_cfg.py workflow=ctp7 threads=4 profile=full events=20000
+# cmsRun benchmark_cfg.py workflow=l1a input=file:CTP7ToDigi.root
+#   workflow l1a:  LinkDQM + RCTL1A    (as l1a/L1ADQM_cfg.py)
+#   workflow ctp7: LinkDQM + L1TCTP7   (as test/CTP7DQM_cfg.py)
+options = VarParsing.VarParsing('analysis')
+options.register('workflow', 'ctp7', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "l1a or ctp7")
+options.register('events', 10000, VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.int, "events to process")
+options.register('threads', 1, VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.int, "framework threads and streams")
+options.register('profile', 'full', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "L1TCTP7 histogramProfile")
+options.register('input', '', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "replayed CTP7ToDigi file, generated events if empty")
+options.register('inputLabel', 'ctp7ToDigi', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "module label of the replayed digis (rctToDigi for l1a captures)")
+options.register('seed', 12345, VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.int, "generator seed")
+options.register('output', 'benchmark.root', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "DQM output file")
+options.parseArguments()
+
+process = cms.Process("benchmark")
+process.load("DQMServices.Core.DQM_cfg")
+process.load("DQMServices.Components.DQMEnvironment_cfi")
+
+process.options = cms.untracked.PSet(
+    numberOfThreads = cms.untracked.uint32(options.threads),
+    numberOfStreams = cms.untracked.uint32(options.threads)
+)
+
+process.maxEvents = cms.untracked.PSet(
+    input = cms.untracked.int32(options.events)
+)
+
+# runBenchmark.py reads the SaveTime and CTP7LoadGenerator lines
+process.MessageLogger = cms.Service("MessageLogger",
+    destinations = cms.untracked.vstring('cout'),
+    categories = cms.untracked.vstring('SaveTime', 'CTP7LoadGenerator', 'FwkReport'),
+    cout = cms.untracked.PSet(
+        threshold = cms.untracked.string('INFO'),
+        default = cms.untracked.PSet( limit = cms.untracked.int32(0) ),
+        FwkReport = cms.untracked.PSet( limit = cms.untracked.int32(0) ),
+        SaveTime = cms.untracked.PSet( limit = cms.untracked.int32(-1) ),
+        CTP7LoadGenerator = cms.untracked.PSet( limit = cms.untracked.int32(-1) )
+    )
+)
+
+if options.input != '':
+    process.source = cms.Source("PoolSource",
+        fileNames = cms.untracked.vstring(options.input)
+    )
+    source = options.inputLabel
+    process.generate = cms.Sequence()
+else:
+    process.source = cms.Source("EmptySource")
+    process.load("CTP7Tests.LoadGenerator.ctp7LoadGenerator_cfi")
+    process.ctp7ToDigi = process.ctp7LoadGenerator.clone(
+        seed = cms.untracked.uint32(options.seed),
+        nBx = cms.untracked.int32(5)
+    )
+    source = "ctp7ToDigi"
+    process.generate = cms.Sequence(process.ctp7ToDigi)
+
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+process.regionSummary.ctp7Source = cms.InputTag(source)
+
+# every module saves to its own file, the save times are added up
+process.ctp7link = cms.EDAnalyzer("LinkDQM",
+    DQMStore = cms.untracked.bool(True),
+    disableROOToutput = cms.untracked.bool(False),
+    outputFile = cms.untracked.string(options.output.replace('.root', '_link.root')),
+    ctp7Source = cms.InputTag(source),
+    verbose = cms.untracked.bool(False)
+)
+
+if options.workflow == 'l1a':
+    process.dqm = cms.EDAnalyzer("RCTL1A",
+        DQMStore = cms.untracked.bool(True),
+        disableROOToutput = cms.untracked.bool(False),
+        outputFile = cms.untracked.string(options.output),
+        ctp7Source = cms.InputTag(source),
+        verbose = cms.untracked.bool(False),
+        filterTriggerType  = cms.int32(-1)
+    )
+else:
+    process.dqm = cms.EDAnalyzer("L1TCTP7",
+        DQMStore = cms.untracked.bool(True),
+        disableROOToutput = cms.untracked.bool(False),
+        outputFile = cms.untracked.string(options.output),
+        histogramProfile = cms.untracked.string(options.profile),
+        ctp7Source = cms.InputTag(source),
+        verbose = cms.untracked.bool(False),
+        filterTriggerType  = cms.int32(-1)
+    )
+
+process.p = cms.Path(process.generate+process.regionSummary+process.ctp7link+process.dqm)
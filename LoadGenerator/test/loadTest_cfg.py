@@ -0,0 +1,83 @@
+import FWCore.ParameterSet.Config as cms
+import FWCore.ParameterSet.VarParsing as VarParsing
+
+# cmsRun loadTest_cfg.py events=10000 pileup=50 occupancyScale=1 linkErrorRate=0.001 profile=full
+# cmsRun loadTest_cfg.py events=10000 resample=CTP7DQM.root
+options = VarParsing.VarParsing('analysis')
+options.register('events', 1000, VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.int, "events to generate")
+options.register('seed', 12345, VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.int, "generator seed")
+options.register('pileup', 20., VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.float, "mean pile-up")
+options.register('occupancyScale', 1., VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.float, "non-zero region multiplier")
+options.register('hfActivity', 2., VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.float, "HF occupancy and E_T multiplier")
+options.register('emMultiplicity', 4., VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.float, "mean EM candidates per event")
+options.register('linkErrorRate', 0., VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.float, "bad link probability per link and event")
+options.register('resample', '', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "DQM file to resample from")
+options.register('profile', 'full', VarParsing.VarParsing.multiplicity.singleton, VarParsing.VarParsing.varType.string, "L1TCTP7 histogramProfile")
+options.parseArguments()
+
+process = cms.Process("loadTest")
+process.load("DQMServices.Core.DQM_cfg")
+process.load("DQMServices.Components.DQMEnvironment_cfi")
+
+process.maxEvents = cms.untracked.PSet(
+    input = cms.untracked.int32(options.events)
+)
+
+process.source = cms.Source("EmptySource")
+
+process.load("FWCore.MessageLogger.MessageLogger_cfi")
+process.MessageLogger.cerr.FwkReport.reportEvery = 1000
+
+# per-module time and the process memory, for the scaling numbers
+process.Timing = cms.Service("Timing",
+    summaryOnly = cms.untracked.bool(True)
+)
+process.SimpleMemoryCheck = cms.Service("SimpleMemoryCheck",
+    ignoreTotal = cms.untracked.int32(1)
+)
+
+process.load("CTP7Tests.LoadGenerator.ctp7LoadGenerator_cfi")
+process.ctp7ToDigi = process.ctp7LoadGenerator.clone(
+    seed = cms.untracked.uint32(options.seed),
+    pileup = cms.untracked.double(options.pileup),
+    occupancyScale = cms.untracked.double(options.occupancyScale),
+    hfActivity = cms.untracked.double(options.hfActivity),
+    emMultiplicity = cms.untracked.double(options.emMultiplicity),
+    linkErrorRate = cms.untracked.double(options.linkErrorRate),
+    resampleFile = cms.untracked.string(options.resample),
+    nBx = cms.untracked.int32(5)
+)
+
+process.dqmSaver.workflow = cms.untracked.string('/L1TMonitor/Calo/CTP7')
+
+process.l1tctp7 = cms.EDAnalyzer("L1TCTP7",
+    DQMStore = cms.untracked.bool(True),
+    disableROOToutput = cms.untracked.bool(False),
+    outputFile = cms.untracked.string('./loadTest_L1TCTP7.root'),
+    histogramProfile = cms.untracked.string(options.profile),
+    ctp7Source = cms.InputTag("ctp7ToDigi"),
+    verbose = cms.untracked.bool(False),
+    filterTriggerType  = cms.int32(-1)
+)
+
+process.rctl1a = cms.EDAnalyzer("RCTL1A",
+    DQMStore = cms.untracked.bool(True),
+    disableROOToutput = cms.untracked.bool(False),
+    outputFile = cms.untracked.string('./loadTest_RCTL1A.root'),
+    ctp7Source = cms.InputTag("ctp7ToDigi"),
+    verbose = cms.untracked.bool(False),
+    filterTriggerType  = cms.int32(-1)
+)
+
+process.ctp7link = cms.EDAnalyzer("LinkDQM",
+    DQMStore = cms.untracked.bool(True),
+    disableROOToutput = cms.untracked.bool(False),
+    outputFile = cms.untracked.string('./loadTest_link.root'),
+    ctp7Source = cms.InputTag("ctp7ToDigi"),
+    verbose = cms.untracked.bool(False)
+)
+
+# regions, EM and links decoded once for the DQM modules
+process.load("CTP7Tests.RegionSummary.regionSummary_cfi")
+
+process.p = cms.Path(process.ctp7ToDigi+process.regionSummary+process.ctp7link+process.l1tctp7+process.rctl1a)
@@ -0,0 +1,152 @@
+#!/usr/bin/env python
+'''
+Throughput benchmark matrix of the DQM workflows, one cmsRun of
+benchmark_cfg.py per combination of workflow, thread count, histogram
+profile and event count.
+
+  ./runBenchmark.py --workflows l1a,ctp7 --threads 1,4 --profiles minimal,full \\
+                    --events 5000,50000 --report benchmark.json
+  ./runBenchmark.py ... --baseline baseline.json          # compare, exit 1 on regression
+  ./runBenchmark.py ... --save-baseline baseline.json     # store this run as the baseline
+  ./runBenchmark.py ... --input file:CTP7ToDigi.root      # replay instead of generating
+
+For every point the report has events/s, peak RSS, output file size and
+the dbe->save time (sum over the modules). With generated events the rate
+is the event loop of CTP7LoadGenerator, without the first event and
+endJob; with a replayed input it is events over the cmsRun wall time.
+'''
+
+from __future__ import print_function
+
+import json
+import optparse
+import os
+import re
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+SAVE = re.compile(r'(\w+) saved (\S+) in ([0-9.eE+-]+) s')
+LOOP = re.compile(r'event loop: (\d+) events in ([0-9.eE+-]+) s')
+
+# higher is better for events_per_s, lower for the others
+METRICS = [('events_per_s', +1), ('peak_rss_mb', -1), ('output_mb', -1), ('save_s', -1)]
+
+
+def run_point(workflow, threads, profile, events, opts):
+    output = 'benchmark_%s_t%d_%s_%d.root' % (workflow, threads, profile, events)
+    log = output.replace('.root', '.log')
+    cmd = ['cmsRun', os.path.join(HERE, 'benchmark_cfg.py'),
+           'workflow=%s' % workflow, 'threads=%d' % threads, 'profile=%s' % profile,
+           'events=%d' % events, 'output=%s' % output, 'seed=%d' % opts.seed]
+    if opts.input:
+        cmd += ['input=%s' % opts.input, 'inputLabel=%s' % opts.input_label]
+
+    start = time.time()
+    with open(log, 'w') as out:
+        proc = subprocess.Popen(cmd, stdout=out, stderr=subprocess.STDOUT)
+        # rusage of this child only, so the peak RSS is per point
+        _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+
+    text = open(log).read()
+    saves = SAVE.findall(text)
+    files = set(f for _, f, _ in saves)
+    point = {
+        'workflow': workflow, 'threads': threads, 'profile': profile, 'events': events,
+        'input': opts.input or 'generated',
+        'status': os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1,
+        'wall_s': round(wall, 3),
+        'peak_rss_mb': round(usage.ru_maxrss/1024., 1),
+        'save_s': round(sum(float(s) for _, _, s in saves), 4),
+        'output_mb': round(sum(os.path.getsize(f) for f in files if os.path.exists(f))/1048576., 3),
+        'log': log,
+    }
+    loop = LOOP.findall(text)
+    if loop and not opts.input and float(loop[-1][1]) > 0:
+        point['events_per_s'] = round(int(loop[-1][0])/float(loop[-1][1]), 1)
+    else:
+        point['events_per_s'] = round(events/wall, 1) if wall > 0 else 0.
+    if not opts.keep:
+        for f in files:
+            if os.path.exists(f):
+                os.remove(f)
+    return point
+
+
+def key(point):
+    return '%(workflow)s/t%(threads)d/%(profile)s/%(events)d/%(input)s' % point
+
+
+def compare(points, baseline, tolerance):
+    '''prints the ratios to the baseline, returns the number of regressions'''
+    reference = dict((key(p), p) for p in baseline)
+    regressions = 0
+    print('%-40s %14s %12s %12s %10s' % ('point', 'events/s', 'peak RSS', 'output', 'save'))
+    for p in points:
+        b = reference.get(key(p))
+        if not b:
+            print('%-40s   (no baseline)' % key(p))
+            continue
+        cells = []
+        for metric, sign in METRICS:
+            if not b.get(metric):
+                cells.append('-')
+                continue
+            ratio = p[metric]/float(b[metric])
+            worse = (ratio < 1. - tolerance) if sign > 0 else (ratio > 1. + tolerance)
+            regressions += worse
+            cells.append('%.2fx%s' % (ratio, ' !' if worse else ''))
+        print('%-40s %14s %12s %12s %10s' % tuple([key(p)] + cells))
+    return regressions
+
+
+def main():
+    parser = optparse.OptionParser(usage=__doc__)
+    parser.add_option('--workflows', default='l1a,ctp7')
+    parser.add_option('--threads', default='1')
+    parser.add_option('--profiles', default='full', help='L1TCTP7 histogramProfile values, ignored by l1a')
+    parser.add_option('--events', default='10000')
+    parser.add_option('--input', default='', help='replayed CTP7ToDigi file instead of generated events')
+    parser.add_option('--input-label', default='ctp7ToDigi')
+    parser.add_option('--seed', type='int', default=12345)
+    parser.add_option('--report', default='benchmark.json')
+    parser.add_option('--baseline', default='', help='compare against this report')
+    parser.add_option('--save-baseline', default='', help='also write the report here')
+    parser.add_option('--tolerance', type='float', default=0.05, help='relative change flagged as regression')
+    parser.add_option('--keep', action='store_true', help='keep the DQM output files')
+    opts, _ = parser.parse_args()
+
+    points = []
+    for workflow in opts.workflows.split(','):
+        # the l1a workflow has no profiles
+        profiles = opts.profiles.split(',') if workflow == 'ctp7' else ['full']
+        for threads in [int(t) for t in opts.threads.split(',')]:
+            for profile in profiles:
+                for events in [int(e) for e in opts.events.split(',')]:
+                    p = run_point(workflow, threads, profile, events, opts)
+                    print('%-40s %8.1f ev/s %8.1f MB RSS %8.3f MB out %7.3f s save%s'
+                          % (key(p), p['events_per_s'], p['peak_rss_mb'], p['output_mb'], p['save_s'],
+                             '' if p['status'] == 0 else '  FAILED, see ' + p['log']))
+                    points.append(p)
+
+    report = {'date': time.strftime('%Y-%m-%d %H:%M:%S'), 'host': os.uname()[1],
+              'cmssw': os.environ.get('CMSSW_VERSION', ''), 'points': points}
+    for name in [opts.report, opts.save_baseline]:
+        if name:
+            with open(name, 'w') as f:
+                json.dump(report, f, indent=1, sort_keys=True)
+
+    failed = sum(1 for p in points if p['status'] != 0)
+    regressions = 0
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            regressions = compare(points, json.load(f)['points'], opts.tolerance)
+        print('%d regression(s) beyond %.0f%%' % (regressions, 100*opts.tolerance))
+    return 1 if failed or regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,124 @@
+/*
+ * \file ctp7MapHistory.cc
+ *
+ * Reads the per-lumi map history written by L1TCTP7 and RCTL1A (mapHistory).
+ *
+ *   ctp7MapHistory <file>                              list the maps, lumis and sizes
+ *   ctp7MapHistory <file> <map> [first [last]]         map summed over the lumi window
+ *   ctp7MapHistory --animate [--step n] [--delay ms] <file> <map> [first [last]]
+ *                                                      one map per n lumis, redrawn in place
+ *
+ * The maps are printed with eta along x and phi along y, phi 17 on top.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <unistd.h>
+
+#include "CTP7Tests/MapHistory/interface/MapHistory.h"
+
+static void usage()
+{
+	std::cout << "usage: ctp7MapHistory [--animate] [--step n] [--delay ms] <file> [map [first [last]]]" << std::endl;
+}
+
+static void print(const MapHistory& history, const std::vector<double>& contents)
+{
+	for (int iy = history.ny() - 1; iy >= 0; iy--) {
+		std::cout << std::setw(3) << iy << " |";
+		for (unsigned int ix = 0; ix < history.nx(); ix++)
+			std::cout << std::setw(7) << contents[ix*history.ny() + iy];
+		std::cout << std::endl;
+	}
+	std::cout << "     ";
+	for (unsigned int ix = 0; ix < history.nx(); ix++) std::cout << std::setw(7) << ix;
+	std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	bool animate = false;
+	unsigned int step = 1;
+	unsigned int delay = 500;
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) { usage(); return 0; }
+		else if (!strcmp(argv[i], "--animate")) animate = true;
+		else if (!strcmp(argv[i], "--step") && i + 1 < argc) step = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--delay") && i + 1 < argc) delay = atoi(argv[++i]);
+		else args.push_back(argv[i]);
+	}
+	if (args.empty()) {
+		usage();
+		return 1;
+	}
+
+	MapHistory history;
+	std::string error;
+	if (!history.read(args[0], error)) {
+		std::cerr << "ctp7MapHistory: " << error << std::endl;
+		return 2;
+	}
+
+	if (args.size() == 1) {
+		// a TH2F of the same map booked per lumi: (nx+2)*(ny+2) floats
+		const double th2Bytes = (history.nx() + 2)*(history.ny() + 2)*sizeof(float);
+		std::cout << args[0] << ": " << history.nx() << "x" << history.ny() << " maps" << std::endl;
+		for (unsigned int m = 0; m < history.maps(); m++) {
+			const std::vector<MapHistory::Frame>& frames = history.frames(m);
+			std::cout << "  " << history.name(m) << ": " << frames.size() << " lumis";
+			if (!frames.empty())
+				std::cout << " (" << frames.front().lumi << "-" << frames.back().lumi << "), "
+				          << history.bytes(m) << " bytes, "
+				          << std::setprecision(3) << history.bytes(m)/(th2Bytes*frames.size())
+				          << " of per-lumi TH2F contents";
+			std::cout << std::endl;
+		}
+		return 0;
+	}
+
+	const int map = history.find(args[1]);
+	if (map < 0) {
+		std::cerr << "ctp7MapHistory: no map " << args[1] << " in " << args[0] << std::endl;
+		return 1;
+	}
+	const std::vector<MapHistory::Frame>& frames = history.frames(map);
+	if (frames.empty()) {
+		std::cerr << "ctp7MapHistory: " << args[1] << " has no lumis" << std::endl;
+		return 1;
+	}
+	const uint32_t first = args.size() > 2 ? strtoul(args[2].c_str(), 0, 10) : frames.front().lumi;
+	const uint32_t last = args.size() > 3 ? strtoul(args[3].c_str(), 0, 10) : frames.back().lumi;
+
+	std::vector<double> contents;
+	if (!animate) {
+		if (!history.window(map, first, last, contents)) {
+			std::cerr << "ctp7MapHistory: corrupt frame in " << args[1] << std::endl;
+			return 2;
+		}
+		std::cout << "# " << args[1] << ", lumis " << first << "-" << last << std::endl;
+		print(history, contents);
+		return 0;
+	}
+
+	// redraw in place on a terminal, one frame after the other otherwise
+	const bool tty = isatty(STDOUT_FILENO);
+	for (uint32_t lumi = first; lumi <= last; lumi += step) {
+		const uint32_t end = std::min<uint64_t>(uint64_t(lumi) + step - 1, last);
+		if (!history.window(map, lumi, end, contents)) {
+			std::cerr << "ctp7MapHistory: corrupt frame in " << args[1] << std::endl;
+			return 2;
+		}
+		if (tty) std::cout << "\033[H\033[2J";
+		std::cout << "# " << args[1] << ", lumis " << lumi << "-" << end << std::endl;
+		print(history, contents);
+		std::cout << std::flush;
+		if (tty && end < last) usleep(delay*1000);
+		if (end == last) break;
+	}
+	return 0;
+}
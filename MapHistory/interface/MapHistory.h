@@ -0,0 +1,78 @@
+#ifndef MAPHISTORY_h
+#define MAPHISTORY_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Per-lumi history of small fixed-size maps (the 22x18 eta-phi maps of
+// the DQM modules). At every lumi boundary the cumulative contents of a
+// map are quantized to integers and stored as the change since the
+// previous lumi: a zigzag varint per non-zero cell, and a 0x00 byte
+// followed by a varint count for a run of unchanged cells (a non-zero
+// varint never starts with 0x00). A quiet detector costs a few bytes per
+// lumi and map; any lumi window is rebuilt by adding up its frames.
+//
+//   "CTP7MAP1" | uint32 nx | uint32 ny | double scale | uint32 nMaps
+//   { uint32 nameLength | name | uint32 nFrames
+//     { uint32 lumi | uint32 bytes }[nFrames] | frame bytes }[nMaps]
+//
+// Cells are stored x-major, index ix*ny + iy (ix = eta, iy = phi).
+namespace ctp7map {
+
+	// encodes/decodes one frame; decode returns false on a corrupt frame
+	void encode(const int64_t* delta, unsigned int n, std::vector<unsigned char>& out);
+	bool decode(const unsigned char* data, size_t bytes, unsigned int n, int64_t* delta);
+
+}
+
+class MapHistory
+{
+public:
+	struct Frame {
+		uint32_t lumi;
+		uint32_t offset;   // in the map's byte buffer
+		uint32_t bytes;
+	};
+
+	// scale multiplies the contents before rounding (1 for counts and ranks)
+	MapHistory(unsigned int nx = 22, unsigned int ny = 18, double scale = 1.);
+
+	unsigned int addMap(const std::string& name);
+	int find(const std::string& name) const;
+
+	// cumulative contents of the map at the end of lumi, nx*ny values;
+	// only the change since the previous call is stored
+	void record(unsigned int map, uint32_t lumi, const double* cumulative);
+
+	bool write(const std::string& file) const;
+	bool read(const std::string& file, std::string& error);
+
+	unsigned int nx() const { return nx_; }
+	unsigned int ny() const { return ny_; }
+	unsigned int cells() const { return nx_*ny_; }
+	double scale() const { return scale_; }
+	unsigned int maps() const { return names_.size(); }
+	const std::string& name(unsigned int map) const { return names_[map]; }
+	const std::vector<Frame>& frames(unsigned int map) const { return frames_[map]; }
+	size_t bytes(unsigned int map) const { return data_[map].size(); }
+
+	// contents gained in the lumis first..last (inclusive), nx*ny values
+	bool window(unsigned int map, uint32_t first, uint32_t last, std::vector<double>& contents) const;
+
+	// contents gained in one stored frame
+	bool frame(unsigned int map, unsigned int index, std::vector<double>& contents) const;
+
+private:
+	unsigned int nx_;
+	unsigned int ny_;
+	double scale_;
+
+	std::vector<std::string> names_;
+	std::vector<std::vector<Frame> > frames_;
+	std::vector<std::vector<unsigned char> > data_;
+	// last recorded cumulative contents, quantized
+	std::vector<std::vector<int64_t> > last_;
+};
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * \file MapHistory.cc
+ *
+ * Delta, zigzag varint and zero-run encoded per-lumi map history.
+ *
+ */
+
+#include "CTP7Tests/MapHistory/interface/MapHistory.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static const char MAGIC[8] = { 'C', 'T', 'P', '7', 'M', 'A', 'P', '1' };
+
+static void putVarint(uint64_t v, std::vector<unsigned char>& out)
+{
+	while (v >= 0x80) {
+		out.push_back(static_cast<unsigned char>(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(v));
+}
+
+static bool getVarint(const unsigned char*& p, const unsigned char* end, uint64_t& v)
+{
+	v = 0;
+	for (unsigned int shift = 0; p < end && shift < 64; shift += 7) {
+		const unsigned char b = *p++;
+		v |= static_cast<uint64_t>(b & 0x7f) << shift;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+static uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+void ctp7map::encode(const int64_t* delta, unsigned int n, std::vector<unsigned char>& out)
+{
+	for (unsigned int i = 0; i < n; ) {
+		if (delta[i] != 0) {
+			putVarint(zigzag(delta[i]), out);
+			i++;
+			continue;
+		}
+		unsigned int run = 1;
+		while (i + run < n && delta[i + run] == 0) run++;
+		out.push_back(0);
+		putVarint(run, out);
+		i += run;
+	}
+}
+
+bool ctp7map::decode(const unsigned char* data, size_t bytes, unsigned int n, int64_t* delta)
+{
+	const unsigned char* p = data;
+	const unsigned char* end = data + bytes;
+	unsigned int i = 0;
+	while (i < n) {
+		if (p >= end) return false;
+		uint64_t v;
+		if (*p == 0) {
+			p++;
+			if (!getVarint(p, end, v) || v == 0 || v > n - i) return false;
+			for (uint64_t k = 0; k < v; k++) delta[i++] = 0;
+		}
+		else {
+			if (!getVarint(p, end, v)) return false;
+			delta[i++] = unzigzag(v);
+		}
+	}
+	return p == end;
+}
+
+MapHistory::MapHistory(unsigned int nx, unsigned int ny, double scale) :
+	nx_(nx),
+	ny_(ny),
+	scale_(scale > 0 ? scale : 1.)
+{
+}
+
+unsigned int MapHistory::addMap(const std::string& name)
+{
+	names_.push_back(name);
+	frames_.push_back(std::vector<Frame>());
+	data_.push_back(std::vector<unsigned char>());
+	last_.push_back(std::vector<int64_t>(cells(), 0));
+	return names_.size() - 1;
+}
+
+int MapHistory::find(const std::string& name) const
+{
+	for (unsigned int m = 0; m < names_.size(); m++)
+		if (names_[m] == name) return m;
+	return -1;
+}
+
+void MapHistory::record(unsigned int map, uint32_t lumi, const double* cumulative)
+{
+	if (map >= names_.size()) return;
+	std::vector<int64_t>& last = last_[map];
+	std::vector<int64_t> delta(cells());
+	for (unsigned int i = 0; i < cells(); i++) {
+		const int64_t v = static_cast<int64_t>(llround(cumulative[i]*scale_));
+		delta[i] = v - last[i];
+		last[i] = v;
+	}
+
+	std::vector<unsigned char>& data = data_[map];
+	Frame f;
+	f.lumi = lumi;
+	f.offset = data.size();
+	ctp7map::encode(&delta[0], cells(), data);
+	f.bytes = data.size() - f.offset;
+	frames_[map].push_back(f);
+}
+
+bool MapHistory::window(unsigned int map, uint32_t first, uint32_t last, std::vector<double>& contents) const
+{
+	contents.assign(cells(), 0.);
+	if (map >= names_.size()) return false;
+	std::vector<int64_t> delta(cells()), sum(cells(), 0);
+	const std::vector<Frame>& frames = frames_[map];
+	for (std::vector<Frame>::const_iterator f = frames.begin(); f != frames.end(); f++) {
+		if (f->lumi < first || f->lumi > last) continue;
+		if (!ctp7map::decode(&data_[map][f->offset], f->bytes, cells(), &delta[0])) return false;
+		for (unsigned int i = 0; i < cells(); i++) sum[i] += delta[i];
+	}
+	for (unsigned int i = 0; i < cells(); i++) contents[i] = sum[i]/scale_;
+	return true;
+}
+
+bool MapHistory::frame(unsigned int map, unsigned int index, std::vector<double>& contents) const
+{
+	contents.assign(cells(), 0.);
+	if (map >= names_.size() || index >= frames_[map].size()) return false;
+	const Frame& f = frames_[map][index];
+	std::vector<int64_t> delta(cells());
+	if (!ctp7map::decode(&data_[map][f.offset], f.bytes, cells(), &delta[0])) return false;
+	for (unsigned int i = 0; i < cells(); i++) contents[i] = delta[i]/scale_;
+	return true;
+}
+
+bool MapHistory::write(const std::string& file) const
+{
+	FILE* f = fopen(file.c_str(), "wb");
+	if (!f) return false;
+
+	bool ok = fwrite(MAGIC, sizeof(MAGIC), 1, f) == 1;
+	const uint32_t header[2] = { nx_, ny_ };
+	const uint32_t nMaps = names_.size();
+	ok = ok && fwrite(header, sizeof(header), 1, f) == 1;
+	ok = ok && fwrite(&scale_, sizeof(scale_), 1, f) == 1;
+	ok = ok && fwrite(&nMaps, sizeof(nMaps), 1, f) == 1;
+	for (unsigned int m = 0; ok && m < nMaps; m++) {
+		const uint32_t length = names_[m].size();
+		const uint32_t nFrames = frames_[m].size();
+		ok = fwrite(&length, sizeof(length), 1, f) == 1
+			&& fwrite(names_[m].data(), 1, length, f) == length
+			&& fwrite(&nFrames, sizeof(nFrames), 1, f) == 1;
+		for (unsigned int i = 0; ok && i < nFrames; i++) {
+			const uint32_t entry[2] = { frames_[m][i].lumi, frames_[m][i].bytes };
+			ok = fwrite(entry, sizeof(entry), 1, f) == 1;
+		}
+		if (ok && !data_[m].empty())
+			ok = fwrite(&data_[m][0], 1, data_[m].size(), f) == data_[m].size();
+	}
+	return (fclose(f) == 0) && ok;
+}
+
+bool MapHistory::read(const std::string& file, std::string& error)
+{
+	FILE* f = fopen(file.c_str(), "rb");
+	if (!f) {
+		error = file + ": " + strerror(errno);
+		return false;
+	}
+
+	char magic[sizeof(MAGIC)];
+	uint32_t header[2];
+	uint32_t nMaps = 0;
+	double scale = 1.;
+	bool ok = fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, MAGIC, sizeof(MAGIC))
+		&& fread(header, sizeof(header), 1, f) == 1
+		&& fread(&scale, sizeof(scale), 1, f) == 1
+		&& fread(&nMaps, sizeof(nMaps), 1, f) == 1
+		&& header[0] > 0 && header[1] > 0 && header[0]*header[1] <= 65536;
+	if (!ok) {
+		error = file + ": not a map history file";
+		fclose(f);
+		return false;
+	}
+
+	*this = MapHistory(header[0], header[1], scale);
+	for (unsigned int m = 0; ok && m < nMaps; m++) {
+		uint32_t length = 0, nFrames = 0;
+		ok = fread(&length, sizeof(length), 1, f) == 1 && length < 4096;
+		std::string name(ok ? length : 0, ' ');
+		ok = ok && (length == 0 || fread(&name[0], 1, length, f) == length)
+			&& fread(&nFrames, sizeof(nFrames), 1, f) == 1;
+		if (!ok) break;
+
+		const unsigned int map = addMap(name);
+		std::vector<Frame>& frames = frames_[map];
+		uint32_t offset = 0;
+		for (unsigned int i = 0; ok && i < nFrames; i++) {
+			uint32_t entry[2];
+			ok = fread(entry, sizeof(entry), 1, f) == 1;
+			Frame fr;
+			fr.lumi = entry[0];
+			fr.offset = offset;
+			fr.bytes = entry[1];
+			offset += fr.bytes;
+			frames.push_back(fr);
+		}
+		data_[map].resize(offset);
+		ok = ok && (offset == 0 || fread(&data_[map][0], 1, offset, f) == offset);
+	}
+	fclose(f);
+	if (!ok) error = file + ": truncated map history";
+	return ok;
+}
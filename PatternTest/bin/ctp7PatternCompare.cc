@@ -0,0 +1,56 @@
+/*
+ * \file ctp7PatternCompare.cc
+ *
+ * Compares a pattern capture (PatternRecorder) with the expected pattern.
+ *
+ *   ctp7PatternCompare [--failures n] <definition> <pattern.cap>
+ *
+ * Prints the mismatches per region, EM slot and link, the flipped bit
+ * positions and the first failing words (n, default 10). Exit status 0 if
+ * every event matches, 1 if any differs, 2 if a file cannot be read.
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "CTP7Tests/PatternTest/interface/PatternSet.h"
+
+static void usage()
+{
+	std::cout << "usage: ctp7PatternCompare [--failures n] <definition> <pattern.cap>" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int maxFailures = 10;
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "-h" || a == "--help") { usage(); return 0; }
+		else if (a == "--failures" && i + 1 < argc) maxFailures = atoi(argv[++i]);
+		else args.push_back(a);
+	}
+	if (args.size() != 2) {
+		usage();
+		return 2;
+	}
+
+	PatternDefinition pattern;
+	PatternCapture capture;
+	std::string error;
+	if (!pattern.read(args[0], error) || !capture.read(args[1], error)) {
+		std::cerr << "ctp7PatternCompare: " << error << std::endl;
+		return 2;
+	}
+	if (capture.events() == 0) {
+		std::cerr << "ctp7PatternCompare: " << args[1] << " has no events" << std::endl;
+		return 2;
+	}
+
+	PatternComparator comparator(pattern);
+	for (unsigned int i = 0; i < capture.events(); i++) comparator.compare(i, capture.id(i), capture.event(i));
+	comparator.report(std::cout, maxFailures);
+	return comparator.passed() ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#ifndef PATTERNSET_h
+#define PATTERNSET_h
+
+#include <cstdio>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Pattern tests of runPattern.sh. Every event is one flat array of raw
+// 32-bit words, so an expected and a captured event compare with one XOR
+// (and a popcount for the bit statistics) per word:
+//
+//   [0, 396)    regions, L1CaloRegion::raw(), index gctEta*18 + gctPhi
+//   [396, 540)  EM candidates, L1CaloEmCand::raw(), index crate*8 + slot,
+//               slot 0-3 isolated, 4-7 non-isolated (by index())
+//   [540, 604)  link words, LinkMonitor::raw()
+//
+// Captured events (PatternRecorder) are stored as
+//
+//   "CTP7PAT1" | uint32 wordsPerEvent | { uint32 event | words }[]
+//
+// The expected pattern is a text definition; later lines override
+// earlier ones, '*' stands for every value and words are hex:
+//
+//   events 64                      pattern length, event i is compared
+//                                  with pattern event i % 64
+//   region <event> <gctEta> <gctPhi> <word>
+//   em     <event> <crate> <slot> <word>
+//   link   <event> <link> <word>
+//   mask   region|em|link <word>   bits compared (default all)
+//   links  <n>                     links compared (default 36)
+//
+// A section without any line is not compared.
+namespace ctp7pat {
+
+	enum Section { Regions = 0, Em, Links, NSECTIONS };
+
+	static const unsigned int NREGIONS = 22*18;
+	static const unsigned int NEM = 18*8;
+	static const unsigned int NLINKS = 64;
+	static const unsigned int OFFSET[NSECTIONS + 1] = { 0, NREGIONS, NREGIONS + NEM, NREGIONS + NEM + NLINKS };
+	static const unsigned int NWORDS = NREGIONS + NEM + NLINKS;
+
+	const char* sectionName(Section s);
+
+	// section and index inside it of a word of the event
+	Section section(unsigned int word);
+
+}
+
+class PatternDefinition
+{
+public:
+	PatternDefinition();
+
+	bool read(const std::string& file, std::string& error);
+
+	unsigned int events() const { return words_.size()/ctp7pat::NWORDS; }
+	const uint32_t* event(unsigned int i) const { return &words_[(i % events())*ctp7pat::NWORDS]; }
+	bool compared(ctp7pat::Section s) const { return used_[s]; }
+	uint32_t mask(ctp7pat::Section s) const { return mask_[s]; }
+	unsigned int links() const { return links_; }
+
+private:
+	std::vector<uint32_t> words_;
+	bool used_[ctp7pat::NSECTIONS];
+	uint32_t mask_[ctp7pat::NSECTIONS];
+	unsigned int links_;
+};
+
+// writer and reader of the captured events
+class PatternCapture
+{
+public:
+	PatternCapture();
+	~PatternCapture();
+
+	bool create(const std::string& file);
+	bool write(uint32_t event, const uint32_t* words);
+	bool close();
+
+	// the whole file; false if it is not a capture of this layout
+	bool read(const std::string& file, std::string& error);
+	unsigned int events() const { return ids_.size(); }
+	uint32_t id(unsigned int i) const { return ids_[i]; }
+	const uint32_t* event(unsigned int i) const { return &words_[i*ctp7pat::NWORDS]; }
+
+private:
+	PatternCapture(const PatternCapture&);
+	PatternCapture& operator=(const PatternCapture&);
+
+	FILE* file_;
+	bool failed_;
+	std::vector<uint32_t> ids_;
+	std::vector<uint32_t> words_;
+};
+
+// mismatch statistics of captured events against a definition
+class PatternComparator
+{
+public:
+	struct Failure {
+		uint32_t event;       // captured event id
+		unsigned int word;    // in the flat event
+		uint32_t expected;
+		uint32_t captured;
+	};
+
+	explicit PatternComparator(const PatternDefinition& pattern);
+
+	// pattern event = event index in the capture, modulo the pattern length
+	void compare(unsigned int index, uint32_t event, const uint32_t* captured);
+
+	bool passed() const { return badEvents_ == 0; }
+	unsigned int events() const { return events_; }
+	unsigned int badEvents() const { return badEvents_; }
+	// events in which the word differed, per word of the flat event
+	unsigned int wordMismatches(unsigned int word) const { return words_[word]; }
+	// flipped bits per section and bit position
+	unsigned int bitMismatches(ctp7pat::Section s, unsigned int bit) const { return bits_[s][bit]; }
+	uint64_t flippedBits(ctp7pat::Section s) const { return flipped_[s]; }
+	const std::vector<Failure>& failures() const { return failures_; }
+
+	void report(std::ostream& out, unsigned int maxFailures = 10) const;
+
+private:
+	const PatternDefinition& pattern_;
+	uint32_t mask_[ctp7pat::NWORDS];
+	unsigned int events_;
+	unsigned int badEvents_;
+	std::vector<unsigned int> words_;
+	unsigned int bits_[ctp7pat::NSECTIONS][32];
+	uint64_t flipped_[ctp7pat::NSECTIONS];
+	std::vector<Failure> failures_;   // first mismatching word of the first events
+};
+
+#endif
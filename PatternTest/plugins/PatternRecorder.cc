@@ -0,0 +1,170 @@
+// -*- C++ -*-
+//
+// Package:    CTP7Tests/PatternTest
+// Class:      PatternRecorder
+//
+/**\class PatternRecorder PatternRecorder.cc CTP7Tests/PatternTest/plugins/PatternRecorder.cc
+
+ Description: records the raw region, EM and link words of a pattern
+              capture, and compares them with the expected pattern
+
+ Implementation:
+     Every event is flattened into the fixed word layout of PatternSet.h
+     (regions of the bx BX by gctEta/gctPhi, EM candidates by crate and
+     slot, link words by position) and appended to file. With definition
+     set, the events are also compared with the pattern at once and the
+     report is logged at endJob; ctp7PatternCompare gives the same report
+     from the file, with a pass/fail exit status for runPattern.sh.
+*/
+//
+
+
+// system include files
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/EDAnalyzer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "DataFormats/L1CaloTrigger/interface/L1CaloCollections.h"
+#include "CTP7Tests/LinkMonitor/interface/LinkMonitor.h"
+#include "CTP7Tests/PatternTest/interface/PatternSet.h"
+
+//
+// class declaration
+//
+
+class PatternRecorder : public edm::EDAnalyzer {
+   public:
+      explicit PatternRecorder(const edm::ParameterSet&);
+      ~PatternRecorder();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void analyze(const edm::Event&, const edm::EventSetup&) override;
+      virtual void endJob() override;
+
+      // ----------member data ---------------------------
+      edm::EDGetTokenT<L1CaloRegionCollection> ctp7Source_L1CRCollection_;
+      edm::EDGetTokenT<L1CaloEmCollection> ctp7Source_L1CEMCollection_;
+      edm::EDGetTokenT<LinkMonitorCollection> ctp7Source_LMCollection_;
+
+      std::string file_;
+      int bx_;
+      PatternCapture capture_;
+      PatternDefinition pattern_;
+      std::unique_ptr<PatternComparator> comparator_;
+      std::vector<uint32_t> words_;
+      unsigned int nev_;
+};
+
+//
+// constructors and destructor
+//
+PatternRecorder::PatternRecorder(const edm::ParameterSet& iConfig):
+   ctp7Source_L1CRCollection_( consumes<L1CaloRegionCollection>(iConfig.getParameter< edm::InputTag >("ctp7Source") )),
+   ctp7Source_L1CEMCollection_( consumes<L1CaloEmCollection>(iConfig.getParameter< edm::InputTag >("ctp7Source") )),
+   ctp7Source_LMCollection_( consumes<LinkMonitorCollection>(iConfig.getParameter< edm::InputTag >("ctp7Source") )),
+   file_(iConfig.getUntrackedParameter< std::string >("file", "pattern.cap")),
+   bx_(iConfig.getUntrackedParameter< int >("bx", 0)),
+   words_(ctp7pat::NWORDS, 0),
+   nev_(0)
+{
+   if (!file_.empty() && !capture_.create(file_))
+      edm::LogWarning("PatternRecorder") << "cannot create " << file_ << ", events are not recorded";
+
+   const std::string definition = iConfig.getUntrackedParameter< std::string >("definition", "");
+   std::string error;
+   if (definition.empty()) return;
+   if (pattern_.read(definition, error)) comparator_.reset(new PatternComparator(pattern_));
+   else edm::LogWarning("PatternRecorder") << error << ", no comparison";
+}
+
+
+PatternRecorder::~PatternRecorder()
+{
+}
+
+
+//
+// member functions
+//
+
+// ------------ method called for each event  ------------
+void
+PatternRecorder::analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+   using namespace edm;
+   using namespace ctp7pat;
+
+   words_.assign(NWORDS, 0);
+
+   Handle < L1CaloRegionCollection > rgn;
+   iEvent.getByToken(ctp7Source_L1CRCollection_,rgn);
+   if (rgn.isValid()) {
+      for (L1CaloRegionCollection::const_iterator ireg = rgn->begin(); ireg != rgn->end(); ireg++) {
+         if (ireg->bx() != bx_ || ireg->gctEta() >= 22 || ireg->gctPhi() >= 18) continue;
+         words_[OFFSET[Regions] + ireg->gctEta()*18 + ireg->gctPhi()] = ireg->raw();
+      }
+   }
+
+   Handle < L1CaloEmCollection > em;
+   iEvent.getByToken(ctp7Source_L1CEMCollection_,em);
+   if (em.isValid()) {
+      for (L1CaloEmCollection::const_iterator iem = em->begin(); iem != em->end(); iem++) {
+         if (iem->bx() != bx_ || iem->rctCrate() >= 18 || iem->index() >= 4) continue;
+         const unsigned int slot = (iem->isolated() ? 0 : 4) + iem->index();
+         words_[OFFSET[Em] + iem->rctCrate()*8 + slot] = iem->raw();
+      }
+   }
+
+   Handle < LinkMonitorCollection > lm;
+   iEvent.getByToken(ctp7Source_LMCollection_,lm);
+   if (lm.isValid()) {
+      for (unsigned int i = 0; i < lm->size() && i < NLINKS; i++)
+         words_[OFFSET[Links] + i] = (*lm)[i].raw();
+   }
+
+   const uint32_t event = iEvent.id().event();
+   capture_.write(event, &words_[0]);
+   if (comparator_) comparator_->compare(nev_, event, &words_[0]);
+   nev_++;
+}
+
+// ------------ method called once each job just after ending the event loop  ------------
+void
+PatternRecorder::endJob()
+{
+   if (!capture_.close())
+      edm::LogWarning("PatternRecorder") << "error writing " << file_;
+   else if (!file_.empty())
+      edm::LogInfo("PatternRecorder") << nev_ << " events recorded in " << file_;
+
+   if (!comparator_) return;
+   std::ostringstream report;
+   comparator_->report(report);
+   if (comparator_->passed()) edm::LogInfo("PatternRecorder") << report.str();
+   else edm::LogWarning("PatternRecorder") << report.str();
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+PatternRecorder::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(PatternRecorder);
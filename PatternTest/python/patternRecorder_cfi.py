@@ -0,0 +1,15 @@
+#flake8: noqa
+import FWCore.ParameterSet.Config as cms
+
+'''
+Raw region, EM and link words of a pattern capture, for ctp7PatternCompare;
+with definition set the events are also compared in the job
+'''
+
+patternRecorder = cms.EDAnalyzer(
+    "PatternRecorder",
+    ctp7Source = cms.InputTag("ctp7ToDigi"),
+    file = cms.untracked.string("pattern.cap"),
+    definition = cms.untracked.string(""),
+    bx = cms.untracked.int32(0),
+)
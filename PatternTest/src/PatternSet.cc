@@ -0,0 +1,325 @@
+/*
+ * \file PatternSet.cc
+ *
+ * Pattern definitions, captured events and their word-wise comparison.
+ *
+ */
+
+#include "CTP7Tests/PatternTest/interface/PatternSet.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace ctp7pat;
+
+static const char MAGIC[8] = { 'C', 'T', 'P', '7', 'P', 'A', 'T', '1' };
+static const unsigned int MAXFAILURES = 100;
+
+static const char* const SECTIONS[NSECTIONS] = { "region", "em", "link" };
+
+const char* ctp7pat::sectionName(Section s)
+{
+	return (s >= Regions && s < NSECTIONS) ? SECTIONS[s] : "?";
+}
+
+Section ctp7pat::section(unsigned int word)
+{
+	if (word < OFFSET[Em]) return Regions;
+	if (word < OFFSET[Links]) return Em;
+	return Links;
+}
+
+// index of a word of the event in readable form, "region eta 4 phi 17"
+static std::string wordName(unsigned int word)
+{
+	std::ostringstream out;
+	const Section s = section(word);
+	const unsigned int i = word - OFFSET[s];
+	if (s == Regions) out << "region eta " << i/18 << " phi " << i%18;
+	else if (s == Em) out << "em crate " << i/8 << " slot " << i%8;
+	else out << "link " << i;
+	return out.str();
+}
+
+//
+// PatternDefinition
+//
+
+PatternDefinition::PatternDefinition() :
+	links_(36)
+{
+	for (unsigned int s = 0; s < NSECTIONS; s++) {
+		used_[s] = false;
+		mask_[s] = 0xffffffff;
+	}
+}
+
+// "*" is [0, n), a number v is [v, v + 1); false if out of range
+static bool parseRange(const std::string& field, unsigned int n, unsigned int& first, unsigned int& last)
+{
+	if (field == "*") {
+		first = 0;
+		last = n;
+		return true;
+	}
+	char* end = 0;
+	const unsigned long v = strtoul(field.c_str(), &end, 10);
+	if (field.empty() || *end || v >= n) return false;
+	first = v;
+	last = v + 1;
+	return true;
+}
+
+static bool parseWord(const std::string& field, uint32_t& word)
+{
+	char* end = 0;
+	const unsigned long long v = strtoull(field.c_str(), &end, 16);
+	if (field.empty() || *end || v > 0xffffffffULL) return false;
+	word = v;
+	return true;
+}
+
+bool PatternDefinition::read(const std::string& file, std::string& error)
+{
+	std::ifstream in(file.c_str());
+	if (!in) {
+		error = file + ": " + strerror(errno);
+		return false;
+	}
+
+	std::string line;
+	for (unsigned int n = 1; std::getline(in, line); n++) {
+		const size_t hash = line.find('#');
+		if (hash != std::string::npos) line.erase(hash);
+		std::istringstream fields(line);
+		std::vector<std::string> f;
+		std::string token;
+		while (fields >> token) f.push_back(token);
+		if (f.empty()) continue;
+
+		std::ostringstream where;
+		where << file << ":" << n << ": ";
+		bool ok = true;
+		unsigned int e0 = 0, e1 = 0, a0 = 0, a1 = 0, b0 = 0, b1 = 0;
+		uint32_t word = 0;
+
+		if (f[0] == "events" && f.size() == 2) {
+			const unsigned int events = atoi(f[1].c_str());
+			ok = events > 0 && words_.empty();
+			if (ok) words_.assign(events*NWORDS, 0);
+		}
+		else if (f[0] == "links" && f.size() == 2) {
+			links_ = atoi(f[1].c_str());
+			ok = links_ <= NLINKS;
+		}
+		else if (f[0] == "mask" && f.size() == 3) {
+			ok = parseWord(f[2], word);
+			unsigned int s = 0;
+			while (s < NSECTIONS && f[1] != SECTIONS[s]) s++;
+			ok = ok && s < NSECTIONS;
+			if (ok) mask_[s] = word;
+		}
+		else if (words_.empty()) {
+			error = where.str() + "'events' must come first";
+			return false;
+		}
+		else if (f[0] == "region" && f.size() == 5) {
+			ok = parseRange(f[1], events(), e0, e1) && parseRange(f[2], 22, a0, a1)
+				&& parseRange(f[3], 18, b0, b1) && parseWord(f[4], word);
+			for (unsigned int e = e0; ok && e < e1; e++)
+				for (unsigned int a = a0; a < a1; a++)
+					for (unsigned int b = b0; b < b1; b++) words_[e*NWORDS + OFFSET[Regions] + a*18 + b] = word;
+			used_[Regions] = used_[Regions] || ok;
+		}
+		else if (f[0] == "em" && f.size() == 5) {
+			ok = parseRange(f[1], events(), e0, e1) && parseRange(f[2], 18, a0, a1)
+				&& parseRange(f[3], 8, b0, b1) && parseWord(f[4], word);
+			for (unsigned int e = e0; ok && e < e1; e++)
+				for (unsigned int a = a0; a < a1; a++)
+					for (unsigned int b = b0; b < b1; b++) words_[e*NWORDS + OFFSET[Em] + a*8 + b] = word;
+			used_[Em] = used_[Em] || ok;
+		}
+		else if (f[0] == "link" && f.size() == 4) {
+			ok = parseRange(f[1], events(), e0, e1) && parseRange(f[2], NLINKS, a0, a1) && parseWord(f[3], word);
+			for (unsigned int e = e0; ok && e < e1; e++)
+				for (unsigned int a = a0; a < a1; a++) words_[e*NWORDS + OFFSET[Links] + a] = word;
+			used_[Links] = used_[Links] || ok;
+		}
+		else ok = false;
+
+		if (!ok) {
+			error = where.str() + "cannot parse '" + line + "'";
+			return false;
+		}
+	}
+	if (words_.empty()) {
+		error = file + ": no 'events' line";
+		return false;
+	}
+	return true;
+}
+
+//
+// PatternCapture
+//
+
+PatternCapture::PatternCapture() :
+	file_(0),
+	failed_(false)
+{
+}
+
+PatternCapture::~PatternCapture()
+{
+	close();
+}
+
+bool PatternCapture::create(const std::string& file)
+{
+	close();
+	file_ = fopen(file.c_str(), "wb");
+	if (!file_) return false;
+	const uint32_t words = NWORDS;
+	failed_ = fwrite(MAGIC, sizeof(MAGIC), 1, file_) != 1 || fwrite(&words, sizeof(words), 1, file_) != 1;
+	return !failed_;
+}
+
+bool PatternCapture::write(uint32_t event, const uint32_t* words)
+{
+	if (!file_ || failed_) return false;
+	failed_ = fwrite(&event, sizeof(event), 1, file_) != 1 || fwrite(words, sizeof(uint32_t), NWORDS, file_) != NWORDS;
+	return !failed_;
+}
+
+bool PatternCapture::close()
+{
+	if (!file_) return true;
+	const bool ok = fclose(file_) == 0 && !failed_;
+	file_ = 0;
+	return ok;
+}
+
+bool PatternCapture::read(const std::string& file, std::string& error)
+{
+	ids_.clear();
+	words_.clear();
+	FILE* f = fopen(file.c_str(), "rb");
+	if (!f) {
+		error = file + ": " + strerror(errno);
+		return false;
+	}
+	char magic[sizeof(MAGIC)];
+	uint32_t words = 0;
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+			|| fread(&words, sizeof(words), 1, f) != 1 || words != NWORDS) {
+		fclose(f);
+		error = file + ": not a pattern capture of this layout";
+		return false;
+	}
+	std::vector<uint32_t> event(NWORDS);
+	uint32_t id;
+	while (fread(&id, sizeof(id), 1, f) == 1) {
+		if (fread(&event[0], sizeof(uint32_t), NWORDS, f) != NWORDS) {
+			fclose(f);
+			error = file + ": truncated event";
+			return false;
+		}
+		ids_.push_back(id);
+		words_.insert(words_.end(), event.begin(), event.end());
+	}
+	fclose(f);
+	return true;
+}
+
+//
+// PatternComparator
+//
+
+PatternComparator::PatternComparator(const PatternDefinition& pattern) :
+	pattern_(pattern),
+	events_(0),
+	badEvents_(0),
+	words_(NWORDS, 0)
+{
+	for (unsigned int i = 0; i < NWORDS; i++) {
+		const Section s = section(i);
+		mask_[i] = pattern.compared(s) ? pattern.mask(s) : 0;
+		if (s == Links && i - OFFSET[Links] >= pattern.links()) mask_[i] = 0;
+	}
+	memset(bits_, 0, sizeof(bits_));
+	memset(flipped_, 0, sizeof(flipped_));
+}
+
+void PatternComparator::compare(unsigned int index, uint32_t event, const uint32_t* captured)
+{
+	const uint32_t* expected = pattern_.event(index);
+	events_++;
+
+	// one XOR per word, no branch: a passing event costs a single sweep
+	uint32_t any = 0;
+	for (unsigned int i = 0; i < NWORDS; i++) any |= (expected[i] ^ captured[i]) & mask_[i];
+	if (!any) return;
+
+	badEvents_++;
+	bool first = true;
+	for (unsigned int i = 0; i < NWORDS; i++) {
+		uint32_t diff = (expected[i] ^ captured[i]) & mask_[i];
+		if (!diff) continue;
+		const Section s = section(i);
+		words_[i]++;
+		flipped_[s] += __builtin_popcount(diff);
+		for (; diff; diff &= diff - 1) bits_[s][__builtin_ctz(diff)]++;
+		if (first && failures_.size() < MAXFAILURES) {
+			Failure f = { event, i, expected[i], captured[i] };
+			failures_.push_back(f);
+		}
+		first = false;
+	}
+}
+
+static bool moreMismatches(const std::pair<unsigned int, unsigned int>& a, const std::pair<unsigned int, unsigned int>& b)
+{
+	return a.second > b.second || (a.second == b.second && a.first < b.first);
+}
+
+void PatternComparator::report(std::ostream& out, unsigned int maxFailures) const
+{
+	out << "pattern test: " << events_ << " events, " << badEvents_ << " with mismatches: "
+		<< (passed() ? "PASS" : "FAIL") << std::endl;
+
+	for (unsigned int s = 0; s < NSECTIONS; s++) {
+		if (!pattern_.compared(Section(s))) {
+			out << "  " << std::setw(6) << SECTIONS[s] << ": not compared" << std::endl;
+			continue;
+		}
+		std::vector<std::pair<unsigned int, unsigned int> > worst;
+		for (unsigned int i = OFFSET[s]; i < OFFSET[s + 1]; i++)
+			if (words_[i]) worst.push_back(std::make_pair(i, words_[i]));
+		out << "  " << std::setw(6) << SECTIONS[s] << ": " << worst.size() << " words differ, "
+			<< flipped_[s] << " bits flipped" << std::endl;
+		if (worst.empty()) continue;
+
+		out << "          bits:";
+		for (unsigned int b = 0; b < 32; b++)
+			if (bits_[s][b]) out << " " << b << ":" << bits_[s][b];
+		out << std::endl;
+		std::sort(worst.begin(), worst.end(), moreMismatches);
+		for (unsigned int k = 0; k < worst.size() && k < 10; k++)
+			out << "          " << std::setw(24) << std::left << wordName(worst[k].first) << std::right
+				<< " in " << worst[k].second << " events" << std::endl;
+	}
+
+	for (unsigned int k = 0; k < failures_.size() && k < maxFailures; k++) {
+		const Failure& f = failures_[k];
+		out << (k == 0 ? "first failures:" : "               ") << " event " << f.event << ", "
+			<< wordName(f.word) << std::hex << std::setfill('0') << ": expected 0x" << std::setw(8) << f.expected
+			<< " captured 0x" << std::setw(8) << f.captured << " xor 0x" << std::setw(8) << (f.expected ^ f.captured)
+			<< std::dec << std::setfill(' ') << std::endl;
+	}
+}
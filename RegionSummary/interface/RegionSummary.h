@@ -0,0 +1,104 @@
+#ifndef REGIONSUMMARY_h
+#define REGIONSUMMARY_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// the RCT regions, EM candidates and link status of one event, decoded
+// once by RegionSummaryProducer for all the DQM modules of the path
+struct RegionSummary
+{
+	static const unsigned int NETA = 22;
+	static const unsigned int NPHI = 18;
+	static const unsigned int NREGIONS = NETA*NPHI;
+	// BXs kept from the readout window
+	static const unsigned int MAXBX = 16;
+
+	// bits of flags_
+	enum { Present = 1, OverFlow = 2, TauVeto = 4, Mip = 8, Quiet = 16, FineGrain = 32 };
+	// bits of valid_, which input collections were found
+	enum { Regions = 1, Em = 2, Links = 4 };
+
+	RegionSummary():
+		valid_(0),
+		firstBx_(0),
+		nBx_(0),
+		nonZero_(0),
+		nonZeroBarrel_(0),
+		nonZeroHF_(0),
+		totalEt_(0),
+		maxEt_(0),
+		maxEtBarrel_(0),
+		maxEtHF_(0),
+		emTotalEt_(0),
+		emMaxRank_(0),
+		badLinkMask_(0),
+		nLinks_(0),
+		nBadLinks_(0) { }
+
+	uint8_t valid_;
+
+	// regions in canonical order, index (bx - firstBx_)*NREGIONS + gctEta*NPHI + gctPhi
+	int16_t firstBx_;
+	uint16_t nBx_;
+	std::vector<uint16_t> et_;
+	std::vector<uint8_t> flags_;
+	// indices of the regions with et > 0, increasing
+	std::vector<uint16_t> nonZeroIndex_;
+
+	// over all BXs; barrel is gctEta 10-11, HF gctEta < 4 or > 17
+	uint16_t nonZero_;
+	uint16_t nonZeroBarrel_;
+	uint16_t nonZeroHF_;
+	uint32_t totalEt_;
+	uint16_t maxEt_;
+	uint16_t maxEtBarrel_;
+	uint16_t maxEtHF_;
+
+	// EM candidates with rank > 0, in collection order
+	std::vector<uint16_t> emRank_;
+	std::vector<int16_t> emBx_;
+	std::vector<uint8_t> emEta_;
+	std::vector<uint8_t> emPhi_;
+	std::vector<uint8_t> emCrate_;
+	std::vector<uint8_t> emIso_;
+	uint32_t emTotalEt_;
+	uint16_t emMaxRank_;
+
+	// bit i set if link i is not 0xf, as in LinkDQM
+	uint64_t badLinkMask_;
+	uint16_t nLinks_;
+	uint16_t nBadLinks_;
+
+	bool hasRegions() const { return valid_ & Regions; }
+	bool hasEm() const { return valid_ & Em; }
+	bool hasLinks() const { return valid_ & Links; }
+
+	static unsigned int index(unsigned int slot, unsigned int gctEta, unsigned int gctPhi) {
+		return slot*NREGIONS + gctEta*NPHI + gctPhi;
+	}
+	static bool barrel(unsigned int gctEta) { return gctEta == 10 || gctEta == 11; }
+	static bool hf(unsigned int gctEta) { return gctEta < 4 || gctEta > 17; }
+
+	unsigned int size() const { return et_.size(); }
+	uint16_t et(unsigned int i) const { return et_[i]; }
+	bool present(unsigned int i) const { return flags_[i] & Present; }
+	bool flag(unsigned int i, uint8_t bit) const { return flags_[i] & bit; }
+	unsigned int gctEta(unsigned int i) const { return (i % NREGIONS) / NPHI; }
+	unsigned int gctPhi(unsigned int i) const { return i % NPHI; }
+	// position in the BX, 0 - 395
+	unsigned int regionId(unsigned int i) const { return i % NREGIONS; }
+	int bx(unsigned int i) const { return firstBx_ + int(i / NREGIONS); }
+
+	unsigned int emSize() const { return emRank_.size(); }
+
+	// product instance (and DQM subfolder) of one card of a ctp7Sources
+	// list, "ctp7ToDigi" or "ctp7ToDigi:B" -> "ctp7ToDigiB"
+	static std::string cardName(const std::string& label, const std::string& instance) {
+		return label + instance;
+	}
+
+};
+
+#endif
@@ -0,0 +1,337 @@
+// -*- C++ -*-
+//
+// Package:    CTP7Tests/RegionSummary
+// Class:      RegionSummaryProducer
+//
+/**\class RegionSummaryProducer RegionSummaryProducer.cc CTP7Tests/RegionSummary/plugins/RegionSummaryProducer.cc
+
+ Description: decodes the CTP7 digis of an event once into a RegionSummary
+
+ Implementation:
+     One pass over L1CaloRegionCollection, L1CaloEmCollection and
+     LinkMonitorCollection of ctp7Source. The regions go to flat E_T and
+     flag arrays in canonical (bx, gctEta, gctPhi) order, with the non-zero
+     counts, totals and maxima (all, barrel, HF) that L1TCTP7 and RCTL1A
+     used to compute each on their own. EM candidates with rank > 0 are
+     kept as flat arrays, links as a bad-link mask. A missing input leaves
+     its part empty and its bit of valid_ unset.
+
+     With a ctp7Sources list (one unpacker per card) every card is decoded
+     on its own, the cards in parallel on cardThreads worker threads (0:
+     one per card, 1: in the module), and put as the instance
+     RegionSummary::cardName of its source. The unlabelled product is a
+     copy of the first card, for the modules that read only one.
+*/
+//
+
+
+// system include files
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/EDProducer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "DataFormats/L1CaloTrigger/interface/L1CaloCollections.h"
+#include "CTP7Tests/LinkMonitor/interface/LinkMonitor.h"
+#include "CTP7Tests/RegionSummary/interface/RegionSummary.h"
+
+//
+// class declaration
+//
+
+// runs the per-card work of an event on persistent threads; the calling
+// thread takes its share, so with one thread everything runs inline
+class CardWorkers {
+   public:
+      explicit CardWorkers(unsigned int threads);
+      ~CardWorkers();
+
+      void run(unsigned int n, const std::function<void(unsigned int)>& work);
+
+   private:
+      void drain();
+      void loop();
+
+      std::vector<std::thread> threads_;
+      std::mutex mutex_;
+      std::condition_variable wake_;
+      std::condition_variable done_;
+      const std::function<void(unsigned int)>* work_;
+      unsigned int n_;
+      std::atomic<unsigned int> next_;
+      unsigned int busy_;
+      unsigned long generation_;
+      bool stop_;
+};
+
+CardWorkers::CardWorkers(unsigned int threads) :
+   work_(0),
+   n_(0),
+   next_(0),
+   busy_(0),
+   generation_(0),
+   stop_(false)
+{
+   for (unsigned int t = 1; t < threads; t++) threads_.push_back(std::thread(&CardWorkers::loop, this));
+}
+
+CardWorkers::~CardWorkers()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+   }
+   wake_.notify_all();
+   for (unsigned int t = 0; t < threads_.size(); t++) threads_[t].join();
+}
+
+void CardWorkers::drain()
+{
+   for (unsigned int i = next_++; i < n_; i = next_++) (*work_)(i);
+}
+
+void CardWorkers::run(unsigned int n, const std::function<void(unsigned int)>& work)
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      work_ = &work;
+      n_ = n;
+      next_ = 0;
+      busy_ = threads_.size();
+      generation_++;
+   }
+   wake_.notify_all();
+   drain();
+   std::unique_lock<std::mutex> lock(mutex_);
+   done_.wait(lock, [this] { return busy_ == 0; });
+}
+
+void CardWorkers::loop()
+{
+   unsigned long seen = 0;
+   for (;;) {
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+         if (stop_) return;
+         seen = generation_;
+      }
+      drain();
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) done_.notify_one();
+   }
+}
+
+class RegionSummaryProducer : public edm::EDProducer {
+   public:
+      explicit RegionSummaryProducer(const edm::ParameterSet&);
+      ~RegionSummaryProducer();
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      virtual void produce(edm::Event&, const edm::EventSetup&) override;
+
+      void summarizeRegions(const L1CaloRegionCollection& rgn, RegionSummary& s);
+      void summarizeEm(const L1CaloEmCollection& em, RegionSummary& s);
+      void summarizeLinks(const LinkMonitorCollection& lm, RegionSummary& s);
+
+      // ----------member data ---------------------------
+      // one entry per card, a single one without ctp7Sources
+      std::vector<edm::EDGetTokenT<L1CaloRegionCollection> > ctp7Source_L1CRCollection_;
+      std::vector<edm::EDGetTokenT<L1CaloEmCollection> > ctp7Source_L1CEMCollection_;
+      std::vector<edm::EDGetTokenT<LinkMonitorCollection> > ctp7Source_LMCollection_;
+      // product instance of each card, empty without ctp7Sources
+      std::vector<std::string> cards_;
+
+      std::unique_ptr<CardWorkers> workers_;
+      std::atomic<bool> warnedBx_;
+};
+
+//
+// constructors and destructor
+//
+RegionSummaryProducer::RegionSummaryProducer(const edm::ParameterSet& iConfig):
+   warnedBx_(false)
+{
+   std::vector<edm::InputTag> sources =
+      iConfig.getUntrackedParameter< std::vector<edm::InputTag> >("ctp7Sources", std::vector<edm::InputTag>());
+   const bool listed = !sources.empty();
+   if (!listed) sources.push_back(iConfig.getParameter< edm::InputTag >("ctp7Source"));
+
+   for (std::vector<edm::InputTag>::const_iterator src = sources.begin(); src != sources.end(); src++) {
+      ctp7Source_L1CRCollection_.push_back(consumes<L1CaloRegionCollection>(*src));
+      ctp7Source_L1CEMCollection_.push_back(consumes<L1CaloEmCollection>(*src));
+      ctp7Source_LMCollection_.push_back(consumes<LinkMonitorCollection>(*src));
+      if (!listed) continue;
+      cards_.push_back(RegionSummary::cardName(src->label(), src->instance()));
+      produces<RegionSummary>(cards_.back());
+   }
+   produces<RegionSummary>();
+
+   unsigned int threads = iConfig.getUntrackedParameter< unsigned int >("cardThreads", 0);
+   if (threads == 0) threads = std::min<unsigned int>(sources.size(), std::max(1u, std::thread::hardware_concurrency()));
+   if (threads > 1 && sources.size() > 1) workers_.reset(new CardWorkers(threads));
+}
+
+
+RegionSummaryProducer::~RegionSummaryProducer()
+{
+}
+
+
+//
+// member functions
+//
+
+void
+RegionSummaryProducer::summarizeRegions(const L1CaloRegionCollection& rgn, RegionSummary& s)
+{
+   s.valid_ |= RegionSummary::Regions;
+   if (rgn.empty()) return;
+
+   // the BX window of the capture
+   int16_t firstBx = rgn.front().bx(), lastBx = firstBx;
+   for (L1CaloRegionCollection::const_iterator ireg = rgn.begin(); ireg != rgn.end(); ireg++) {
+      firstBx = std::min(firstBx, ireg->bx());
+      lastBx = std::max(lastBx, ireg->bx());
+   }
+   unsigned int nBx = lastBx - firstBx + 1;
+   if (nBx > RegionSummary::MAXBX) {
+      if (!warnedBx_.exchange(true)) edm::LogWarning("RegionSummaryProducer") << "BX window " << firstBx << "-" << lastBx
+         << " is longer than " << RegionSummary::MAXBX << ", the later BXs are dropped";
+      nBx = RegionSummary::MAXBX;
+   }
+   s.firstBx_ = firstBx;
+   s.nBx_ = nBx;
+   s.et_.assign(nBx*RegionSummary::NREGIONS, 0);
+   s.flags_.assign(nBx*RegionSummary::NREGIONS, 0);
+
+   for (L1CaloRegionCollection::const_iterator ireg = rgn.begin(); ireg != rgn.end(); ireg++) {
+      const unsigned int slot = ireg->bx() - firstBx;
+      const unsigned int eta = ireg->gctEta(), phi = ireg->gctPhi();
+      if (slot >= nBx || eta >= RegionSummary::NETA || phi >= RegionSummary::NPHI) continue;
+
+      const unsigned int i = RegionSummary::index(slot, eta, phi);
+      const uint16_t et = ireg->et();
+      s.et_[i] = et;
+      s.flags_[i] = RegionSummary::Present
+         | (ireg->overFlow() ? RegionSummary::OverFlow : 0)
+         | (ireg->tauVeto() ? RegionSummary::TauVeto : 0)
+         | (ireg->mip() ? RegionSummary::Mip : 0)
+         | (ireg->quiet() ? RegionSummary::Quiet : 0)
+         | (ireg->fineGrain() ? RegionSummary::FineGrain : 0);
+      if (et == 0) continue;
+
+      s.nonZero_++;
+      s.totalEt_ += et;
+      s.maxEt_ = std::max(s.maxEt_, et);
+      if (RegionSummary::barrel(eta)) {
+         s.nonZeroBarrel_++;
+         s.maxEtBarrel_ = std::max(s.maxEtBarrel_, et);
+      }
+      if (RegionSummary::hf(eta)) {
+         s.nonZeroHF_++;
+         s.maxEtHF_ = std::max(s.maxEtHF_, et);
+      }
+   }
+
+   // canonical order, whatever the order of the unpacker
+   s.nonZeroIndex_.reserve(s.nonZero_);
+   for (unsigned int i = 0; i < s.et_.size(); i++)
+      if (s.et_[i] > 0) s.nonZeroIndex_.push_back(i);
+}
+
+void
+RegionSummaryProducer::summarizeEm(const L1CaloEmCollection& em, RegionSummary& s)
+{
+   s.valid_ |= RegionSummary::Em;
+   for (L1CaloEmCollection::const_iterator iem = em.begin(); iem != em.end(); iem++) {
+      const uint16_t rank = iem->rank();
+      if (rank == 0) continue;
+
+      const L1CaloRegionDetId id = iem->regionId();
+      s.emRank_.push_back(rank);
+      s.emBx_.push_back(iem->bx());
+      s.emEta_.push_back(id.ieta());
+      s.emPhi_.push_back(id.iphi());
+      s.emCrate_.push_back(iem->rctCrate());
+      s.emIso_.push_back(iem->isolated());
+      s.emTotalEt_ += rank;
+      s.emMaxRank_ = std::max(s.emMaxRank_, rank);
+   }
+}
+
+void
+RegionSummaryProducer::summarizeLinks(const LinkMonitorCollection& lm, RegionSummary& s)
+{
+   s.valid_ |= RegionSummary::Links;
+   s.nLinks_ = lm.size();
+   for (unsigned int i = 0; i < lm.size(); i++) {
+      if (lm[i].raw() == 15) continue;
+      s.nBadLinks_++;
+      if (i < 64) s.badLinkMask_ |= uint64_t(1) << i;
+   }
+}
+
+// ------------ method called to produce the data  ------------
+void
+RegionSummaryProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+   using namespace edm;
+   const unsigned int n = ctp7Source_L1CRCollection_.size();
+
+   // the products are read here, only the decoding runs on the workers
+   std::vector< Handle < L1CaloRegionCollection > > rgn(n);
+   std::vector< Handle < L1CaloEmCollection > > em(n);
+   std::vector< Handle < LinkMonitorCollection > > lm(n);
+   std::vector<RegionSummary*> summary(n);
+   for (unsigned int c = 0; c < n; c++) {
+      iEvent.getByToken(ctp7Source_L1CRCollection_[c],rgn[c]);
+      iEvent.getByToken(ctp7Source_L1CEMCollection_[c],em[c]);
+      iEvent.getByToken(ctp7Source_LMCollection_[c],lm[c]);
+      summary[c] = new RegionSummary;
+   }
+
+   std::function<void(unsigned int)> summarize = [&](unsigned int c) {
+      if (rgn[c].isValid()) summarizeRegions(*rgn[c], *summary[c]);
+      if (em[c].isValid()) summarizeEm(*em[c], *summary[c]);
+      if (lm[c].isValid()) summarizeLinks(*lm[c], *summary[c]);
+   };
+   if (workers_) workers_->run(n, summarize);
+   else for (unsigned int c = 0; c < n; c++) summarize(c);
+
+   if (cards_.empty()) {
+      iEvent.put(std::auto_ptr<RegionSummary>(summary[0]));
+      return;
+   }
+   iEvent.put(std::auto_ptr<RegionSummary>(new RegionSummary(*summary[0])));
+   for (unsigned int c = 0; c < n; c++) iEvent.put(std::auto_ptr<RegionSummary>(summary[c]), cards_[c]);
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+RegionSummaryProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(RegionSummaryProducer);
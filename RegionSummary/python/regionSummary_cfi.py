@@ -0,0 +1,16 @@
+#flake8: noqa
+import FWCore.ParameterSet.Config as cms
+
+'''
+Regions, EM candidates and link status of the event decoded once,
+read by L1TCTP7 and RCTL1A (their regionSummary parameter).
+With ctp7Sources, one summary per card (instance named after the
+source), decoded in parallel on cardThreads threads (0: one per card)
+'''
+
+regionSummary = cms.EDProducer(
+    "RegionSummaryProducer",
+    ctp7Source = cms.InputTag("ctp7ToDigi"),
+    #ctp7Sources = cms.untracked.VInputTag("ctp7ToDigiA", "ctp7ToDigiB"),
+    #cardThreads = cms.untracked.uint32(0),
+)
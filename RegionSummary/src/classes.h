@@ -0,0 +1,8 @@
+#include "../interface/RegionSummary.h"
+#include "DataFormats/Common/interface/Wrapper.h"
+
+namespace { struct dictionary {
+  RegionSummary dummy0;
+  edm::Wrapper<RegionSummary> dummy1;
+};
+}